@@ -0,0 +1,190 @@
+// bench/bench_cluster.cpp
+//
+// Macro-benchmark: an in-process cluster of N nodes on localhost. Signed
+// audits are streamed to every node (SubmitAudits), and the benchmark
+// waits until the leader has committed all of them. It reports end-to-end
+// audits/s and the submit-to-commit latency of each audit.
+
+#include "bench_util.h"
+#include "file_audit.grpc.pb.h"    // fileaudit::FileAuditService
+#include "latency_histogram.h"
+#include "leader_config.h"
+#include "node.h"
+
+#include <benchmark/benchmark.h>
+#include <grpcpp/grpcpp.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <thread>
+
+namespace {
+
+constexpr int64_t kAudits = 2000;                  // per run, over all nodes
+constexpr auto    kLeaderTimeout = std::chrono::seconds(10);
+constexpr auto    kCommitTimeout = std::chrono::seconds(60);
+const std::string kReqPrefix = "req-";
+
+int64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// A localhost port nothing is listening on right now
+int FreePort() {
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in sa{};
+  sa.sin_family      = AF_INET;
+  sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ::bind(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa));
+  socklen_t len = sizeof(sa);
+  ::getsockname(fd, reinterpret_cast<sockaddr*>(&sa), &len);
+  ::close(fd);
+  return ntohs(sa.sin_port);
+}
+
+// Fast heartbeats; only the node that is meant to lead runs an election
+// early, so the cluster settles on one leader without split votes.
+LeaderConfig BenchConfig(const TempDir& dir, const std::string& name,
+                         bool elects) {
+  std::string path = dir.file(name + ".json");
+  std::ofstream(path) << R"({
+    "leader_addr": "", "batch_size": 200, "batch_interval_s": 1,
+    "snapshot_interval_s": 0, "heartbeat_interval_ms": 50,
+    "heartbeat_timeout_ms": 5000, "election_interval_ms": 50,
+    "election_rpc_timeout_ms": 500, "election_initial_delay_ms": )"
+    << (elects ? 200 : 3600000) << "}";
+  return LeaderConfig(path);
+}
+
+// Stream `audits` to the node at `addr` and wait for every ack
+void Submit(const std::string& addr,
+            const std::vector<common::FileAudit>& audits,
+            std::vector<std::atomic<int64_t>>* sent_us, size_t first) {
+  auto stub = fileaudit::FileAuditService::NewStub(
+    grpc::CreateChannel(addr, grpc::InsecureChannelCredentials()));
+  grpc::ClientContext ctx;
+  auto stream = stub->SubmitAudits(&ctx);
+  std::thread writer([&]{
+    for (size_t i = 0; i < audits.size(); ++i) {
+      (*sent_us)[first + i] = NowUs();
+      if (!stream->Write(audits[i])) break;
+    }
+    stream->WritesDone();
+  });
+  fileaudit::FileAuditResponse ack;
+  while (stream->Read(&ack)) {}
+  writer.join();
+  stream->Finish();
+}
+
+}  // namespace
+
+static void BM_Cluster(benchmark::State& state) {
+  const auto nodes = static_cast<size_t>(state.range(0));
+  static const BenchKey key;
+
+  // Signing is not what is measured: do it up front
+  std::vector<common::FileAudit> audits;
+  audits.reserve(kAudits);
+  for (int64_t i = 0; i < kAudits; ++i) {
+    audits.push_back(MakeAudit(kReqPrefix, i, &key));
+  }
+
+  QuietLogs quiet;
+
+  for (auto _ : state) {
+    TempDir dir;
+    std::vector<std::string> addrs;
+    for (size_t i = 0; i < nodes; ++i) {
+      addrs.push_back("127.0.0.1:" + std::to_string(FreePort()));
+    }
+    // Votes go to the highest address, so that one runs the election
+    size_t leader =
+      std::max_element(addrs.begin(), addrs.end()) - addrs.begin();
+
+    std::vector<std::unique_ptr<Node>> cluster;
+    for (size_t i = 0; i < nodes; ++i) {
+      Node::Options opts;
+      opts.addr     = addrs[i];
+      opts.data_dir = dir.file("node" + std::to_string(i));
+      std::filesystem::create_directories(opts.data_dir);
+      for (size_t j = 0; j < nodes; ++j) {
+        if (j != i) opts.peers.push_back(addrs[j]);
+      }
+      auto cfg = BenchConfig(dir, "leader" + std::to_string(i), i == leader);
+      cluster.push_back(std::make_unique<Node>(opts, cfg));
+    }
+    for (auto& n : cluster) {
+      if (!n->start()) {
+        state.SkipWithError("node could not bind its port");
+        return;
+      }
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + kLeaderTimeout;
+    while (!cluster[leader]->isLeader()) {
+      if (std::chrono::steady_clock::now() > deadline) {
+        state.SkipWithError("no leader elected");
+        return;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // Each node gets an equal share of the audits, all at once
+    std::vector<std::atomic<int64_t>> sent_us(audits.size());
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> clients;
+    size_t share = (audits.size() + nodes - 1) / nodes;
+    for (size_t i = 0; i < nodes; ++i) {
+      size_t first = std::min(audits.size(), i * share);
+      size_t last  = std::min(audits.size(), first + share);
+      clients.emplace_back([&, i, first, last]{
+        std::vector<common::FileAudit> part(audits.begin() + first,
+                                            audits.begin() + last);
+        Submit(addrs[i], part, &sent_us, first);
+      });
+    }
+
+    // Follow the leader's chain until every audit is in a block
+    LatencyHistogram commit;
+    auto& head = *cluster[leader];
+    int64_t next_block = 0;
+    int64_t committed  = 0;
+    auto give_up = std::chrono::steady_clock::now() + kCommitTimeout;
+    blockchain::Block blk;
+    std::string err;
+    while (committed < kAudits && std::chrono::steady_clock::now() < give_up) {
+      if (next_block > head.chain().getLastID() ||
+          !head.blocks().Get(next_block, &blk, &err)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        continue;
+      }
+      int64_t now = NowUs();
+      for (auto& a : blk.audits()) {
+        size_t i = std::stoul(a.req_id().substr(kReqPrefix.size()));
+        commit.Record(std::chrono::microseconds(now - sent_us[i]));
+        ++committed;
+      }
+      ++next_block;
+    }
+    auto elapsed = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - t0).count();
+    for (auto& c : clients) c.join();
+    for (auto& n : cluster) n->stop();
+
+    if (committed < kAudits) {
+      state.SkipWithError("not every audit was committed in time");
+      break;
+    }
+    state.SetIterationTime(elapsed);
+    state.counters["audits_per_s"]  = committed / elapsed;
+    state.counters["blocks"]        = static_cast<double>(next_block);
+    state.counters["commit_p50_ms"] = commit.PercentileUs(50) / 1000.0;
+    state.counters["commit_p99_ms"] = commit.PercentileUs(99) / 1000.0;
+  }
+}
+BENCHMARK(BM_Cluster)->Arg(1)->Arg(3)->Iterations(1)->UseManualTime()
+  ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,159 @@
+// bench/bench_micro.cpp
+//
+// Micro-benchmarks of the per-audit and per-block hot paths.
+
+#include "bench_util.h"
+#include "canonical_payload.h"
+#include "chain_manager.h"
+#include "mempool_manager.h"
+#include "merkle_tree.h"
+#include "signature_verifier.h"
+
+#include <benchmark/benchmark.h>
+
+// Mempool depths the mempool benchmarks run at.
+static void MempoolDepths(benchmark::internal::Benchmark* b) {
+  b->Arg(1000)->Arg(10000)->Arg(100000);
+}
+
+static void FillMempool(MempoolManager& pool, int64_t n) {
+  for (int64_t i = 0; i < n; ++i) pool.Append(MakeAudit("fill", i));
+}
+
+// -- Hashing ------------------------------------------------------------------
+
+static void BM_SHA256Hex(benchmark::State& state) {
+  std::string data(static_cast<size_t>(state.range(0)), 'x');
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(SHA256Hex(data));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SHA256Hex)->Arg(64)->Arg(1024)->Arg(16384);
+
+static void BM_ComputeMerkleRoot(benchmark::State& state) {
+  std::vector<std::string> leaves;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    leaves.push_back(SHA256Hex(std::to_string(i)));
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ComputeMerkleRoot(leaves));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ComputeMerkleRoot)->Arg(1)->Arg(1000)->Arg(100000)
+  ->Unit(benchmark::kMicrosecond);
+
+// -- Per-audit checks ---------------------------------------------------------
+
+static void BM_CanonicalPayload(benchmark::State& state) {
+  auto a = MakeAudit("payload", 42);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(CanonicalPayload(a));
+  }
+}
+BENCHMARK(BM_CanonicalPayload);
+
+static void BM_VerifySignature(benchmark::State& state) {
+  static const BenchKey key;
+  auto a = MakeAudit("sig", 1, &key);
+  auto payload = CanonicalPayload(a);
+  for (auto _ : state) {
+    bool ok = VerifySignature(payload, a.signature(), a.public_key());
+    if (!ok) state.SkipWithError("signature did not verify");
+    benchmark::DoNotOptimize(ok);
+  }
+}
+BENCHMARK(BM_VerifySignature)->Unit(benchmark::kMicrosecond);
+
+// -- Mempool ------------------------------------------------------------------
+
+static void BM_MempoolAppend(benchmark::State& state) {
+  QuietLogs quiet;
+  TempDir dir;
+  MempoolManager pool(dir.file("mempool.dat"));
+  FillMempool(pool, state.range(0));
+  int64_t i = 0;
+  for (auto _ : state) {
+    pool.Append(MakeAudit("new", i++));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MempoolAppend)->Apply(MempoolDepths)
+  ->Unit(benchmark::kMicrosecond);
+
+static void BM_MempoolLoadAll(benchmark::State& state) {
+  QuietLogs quiet;
+  TempDir dir;
+  MempoolManager pool(dir.file("mempool.dat"));
+  FillMempool(pool, state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(pool.LoadAll());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MempoolLoadAll)->Apply(MempoolDepths)
+  ->Unit(benchmark::kMillisecond);
+
+// Removes one block's worth (100) of audits from a mempool of range(0)
+static void BM_MempoolRemoveBatch(benchmark::State& state) {
+  QuietLogs quiet;
+  constexpr int64_t kBatch = 100;
+  TempDir dir;
+  MempoolManager pool(dir.file("mempool.dat"));
+  FillMempool(pool, state.range(0));
+  int64_t next = 0;
+  std::vector<std::string> ids;
+  for (auto _ : state) {
+    state.PauseTiming();
+    ids.clear();
+    for (int64_t i = 0; i < kBatch; ++i, ++next) {
+      auto a = MakeAudit("batch", next);
+      ids.push_back(a.req_id());
+      pool.Append(a);
+    }
+    state.ResumeTiming();
+    pool.RemoveBatch(ids);
+  }
+  state.SetItemsProcessed(state.iterations() * kBatch);
+}
+BENCHMARK(BM_MempoolRemoveBatch)->Apply(MempoolDepths)
+  ->Unit(benchmark::kMicrosecond);
+
+// -- Chain --------------------------------------------------------------------
+
+static void BM_ChainAppend(benchmark::State& state) {
+  TempDir dir;
+  ChainManager chain(dir.file("chain.json"));
+  int64_t id = 0;
+  std::string prev;
+  for (auto _ : state) {
+    BlockMeta meta{id, SHA256Hex(std::to_string(id)), prev,
+                   SHA256Hex("root" + std::to_string(id))};
+    chain.append(meta);
+    prev = meta.hash;
+    ++id;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ChainAppend)->Unit(benchmark::kMicrosecond);
+
+// Loads a chain of range(0) blocks from its checkpoint and log
+static void BM_ChainReload(benchmark::State& state) {
+  TempDir dir;
+  const std::string path = dir.file("chain.json");
+  const std::string h(64, 'a');
+  {
+    ChainManager chain(path);
+    for (int64_t id = 0; id < state.range(0); ++id) {
+      chain.append(BlockMeta{id, h, h, h});
+    }
+  }
+  for (auto _ : state) {
+    ChainManager chain(path);
+    benchmark::DoNotOptimize(chain.getLastID());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ChainReload)->Arg(10000)->Arg(1000000)
+  ->Unit(benchmark::kMillisecond);
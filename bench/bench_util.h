@@ -0,0 +1,112 @@
+#pragma once
+
+#include "canonical_payload.h"   // CanonicalPayload
+#include "common.pb.h"           // common::FileAudit
+#include "logger.h"
+
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// Scratch directory under /tmp, removed with everything in it.
+class TempDir {
+public:
+  TempDir() {
+    static std::atomic<int> seq{0};
+    path_ = std::filesystem::temp_directory_path() /
+            ("audit_bench_" + std::to_string(::getpid()) + "_" +
+             std::to_string(seq++));
+    std::filesystem::create_directories(path_);
+  }
+  ~TempDir() {
+    std::error_code ec;
+    std::filesystem::remove_all(path_, ec);
+  }
+
+  TempDir(const TempDir&) = delete;
+  TempDir& operator=(const TempDir&) = delete;
+
+  std::string path() const { return path_.string(); }
+  std::string file(const std::string& name) const {
+    return (path_ / name).string();
+  }
+
+private:
+  std::filesystem::path path_;
+};
+
+/// A client RSA key pair that signs audits the way the client does.
+class BenchKey {
+public:
+  BenchKey() : pkey_(EVP_RSA_gen(2048), EVP_PKEY_free) {
+    if (!pkey_) throw std::runtime_error("RSA key generation failed");
+    BIO* bio = BIO_new(BIO_s_mem());
+    PEM_write_bio_PUBKEY(bio, pkey_.get());
+    char* data = nullptr;
+    long len = BIO_get_mem_data(bio, &data);
+    public_pem_.assign(data, static_cast<size_t>(len));
+    BIO_free(bio);
+  }
+
+  const std::string& PublicPem() const { return public_pem_; }
+
+  /// Base64 RSA/SHA-256 signature over `data`.
+  std::string Sign(const std::string& data) const {
+    EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+    EVP_DigestSignInit(ctx, nullptr, EVP_sha256(), nullptr, pkey_.get());
+    EVP_DigestSignUpdate(ctx, data.data(), data.size());
+    size_t len = 0;
+    EVP_DigestSignFinal(ctx, nullptr, &len);
+    std::vector<unsigned char> sig(len);
+    EVP_DigestSignFinal(ctx, sig.data(), &len);
+    EVP_MD_CTX_free(ctx);
+
+    std::string b64(4 * ((len + 2) / 3), '\0');
+    int n = EVP_EncodeBlock(reinterpret_cast<unsigned char*>(&b64[0]),
+                            sig.data(), static_cast<int>(len));
+    b64.resize(static_cast<size_t>(n));
+    return b64;
+  }
+
+private:
+  std::unique_ptr<EVP_PKEY, void (*)(EVP_PKEY*)> pkey_;
+  std::string                                    public_pem_;
+};
+
+/// Only errors from the code under test while in scope, so the
+/// benchmark report stays readable.
+struct QuietLogs {
+  QuietLogs()  { Logger::Shared().SetLevel(LogLevel::kError); }
+  ~QuietLogs() { Logger::Shared().SetLevel(LogLevel::kInfo); }
+};
+
+inline int64_t NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/// Audit number `i` under `prefix`; signed when `key` is given.
+inline common::FileAudit MakeAudit(const std::string& prefix, int64_t i,
+                                   const BenchKey* key = nullptr) {
+  common::FileAudit a;
+  a.set_req_id(prefix + std::to_string(i));
+  a.mutable_file_info()->set_file_id("file" + std::to_string(i % 1000));
+  a.mutable_file_info()->set_file_name("report.docx");
+  a.mutable_user_info()->set_user_id("user" + std::to_string(i % 100));
+  a.mutable_user_info()->set_user_name("bench");
+  a.set_access_type(common::READ);
+  a.set_timestamp(NowMs());
+  if (key) {
+    a.set_signature(key->Sign(CanonicalPayload(a)));
+    a.set_public_key(key->PublicPem());
+  }
+  return a;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "common.pb.h"          // common::FileAudit
+#include "heartbeat_table.h"
+#include "mempool_manager.h"
+#include "metrics.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+/// `rate` tokens per second, holding at most `burst`. Not thread-safe.
+class TokenBucket {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  TokenBucket(double rate, double burst, Clock::time_point now);
+
+  /// Take one token if there is one; otherwise set `*wait` to the time
+  /// until there will be.
+  bool Take(Clock::time_point now, std::chrono::milliseconds* wait);
+
+  /// Fraction of the bucket that is used up (0 = full bucket, 1 = empty).
+  double Used(Clock::time_point now) const;
+
+private:
+  double available(Clock::time_point now) const;
+
+  double            rate_;
+  double            burst_;
+  double            tokens_;
+  Clock::time_point last_;
+};
+
+/// Decides whether audits may enter the mempool, so a node that cannot
+/// commit fast enough sheds load early instead of growing mempool.dat
+/// until it runs out of disk and memory.
+///
+/// Clients are refused once the mempool holds client_share of max_mempool
+/// audits, above the node-wide max_ingest_rate, or above their own
+/// client_rate (one token bucket per public_key, or user_id without one).
+/// Gossip from peers is refused only at max_mempool itself: those audits
+/// were already acked to a client, and the peer retries them later.
+/// Refusals carry a retry-after hint and, when heartbeats show one, a
+/// less loaded peer to go to instead.
+class AdmissionControl {
+public:
+  struct Options {
+    size_t max_mempool     = 200000;   // 0: no limit
+    double client_share    = 0.8;      // of max_mempool, for clients
+    double max_ingest_rate = 0;        // client audits/s per node; 0: none
+    double client_rate     = 0;        // audits/s per client; 0: none
+    double client_burst    = 0;        // 0: one second of client_rate
+    std::chrono::milliseconds full_retry{1000};   // hint when full
+  };
+
+  enum class Reason { kNone, kMempoolFull, kIngestRate, kClientRate };
+
+  struct Decision {
+    Reason                    reason = Reason::kNone;
+    std::chrono::milliseconds retry_after{0};
+    std::string               redirect;    // less loaded peer, or empty
+
+    bool ok() const { return reason == Reason::kNone; }
+    std::string message() const;
+  };
+
+  /// `peers` (optional) is the heartbeat table of the other members;
+  /// `self_addr` is this node's own row in it.
+  AdmissionControl(Options opts, std::shared_ptr<MempoolManager> mempool,
+                   std::shared_ptr<HeartbeatTable> peers = nullptr,
+                   std::string self_addr = "");
+
+  AdmissionControl(const AdmissionControl&) = delete;
+  AdmissionControl& operator=(const AdmissionControl&) = delete;
+
+  /// Node-wide check for one client audit; cheap, so it runs before the
+  /// signature check.
+  Decision AdmitClient();
+
+  /// Per-client check for an audit whose signature was verified (forged
+  /// audits cannot use up someone else's budget).
+  Decision AdmitFrom(const common::FileAudit& audit);
+
+  /// Check for `n` gossiped audits.
+  Decision AdmitGossip(size_t n);
+
+  /// 0-100: how close the node is to refusing clients, by mempool depth
+  /// or ingest rate, whichever is closer. Sent with every heartbeat.
+  int Pressure() const;
+
+  /// The alive peer with the lowest advertised pressure, if that is well
+  /// below ours; empty otherwise.
+  std::string LessLoadedPeer() const;
+
+private:
+  static constexpr size_t kShards = 16;
+  // Idle clients' buckets are dropped once a shard holds this many.
+  static constexpr size_t kClientsPerShard = 4096;
+
+  struct Shard {
+    std::mutex                                mu;
+    std::unordered_map<uint64_t, TokenBucket> buckets;   // by key hash
+  };
+
+  Decision refuse(Reason reason, std::chrono::milliseconds retry_after);
+
+  Options                            opts_;
+  std::shared_ptr<MempoolManager>    mempool_;
+  std::shared_ptr<HeartbeatTable>    peers_;
+  std::string                        self_addr_;
+  size_t                             client_limit_;   // mempool depth
+  double                             client_burst_;
+
+  mutable std::mutex                 ingest_mu_;
+  std::optional<TokenBucket>         ingest_;        // max_ingest_rate
+  std::array<Shard, kShards>         clients_;
+
+  Counter*                           refused_full_;
+  Counter*                           refused_rate_;
+  Counter*                           refused_client_;
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "block_chain.pb.h"    // blockchain::Block
+#include "block_store.h"
+#include "chain_manager.h"
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// In-memory secondary index over committed audits, so "who touched file X
+/// last week" doesn't mean reading every block.
+///
+/// Every committed audit gets a sequence number in commit order and one
+/// 32-byte entry (block id, position, timestamp, interned file and user).
+/// Posting lists of sequence numbers are kept per file_id, per user_id and
+/// per timestamp bucket; all are sorted, so a query starts with a binary
+/// search on the smallest matching list, filters the entries on the other
+/// conditions, and stops after one page. Results come in commit order and
+/// a page ends with a cursor for the next one.
+///
+/// Commit paths call AddBlock() before the block reaches the chain head.
+/// Blocks that reach the chain any other way (range sync) are picked up
+/// from the block store by CatchUp(), which runs before a query whenever
+/// the chain is ahead of the index; at startup it rebuilds the whole
+/// index. Blocks the store doesn't have (below a bootstrap snapshot) are
+/// skipped.
+class AuditIndex {
+public:
+  struct Options {
+    int64_t bucket_ms = 10 * 60 * 1000;   // timestamp bucket width (10 min)
+  };
+
+  /// An empty file_id/user_id matches anything; times are inclusive (ms).
+  struct Query {
+    std::string file_id;
+    std::string user_id;
+    int64_t     from_ts = std::numeric_limits<int64_t>::min();
+    int64_t     to_ts   = std::numeric_limits<int64_t>::max();
+  };
+
+  /// Where an audit lives: blocks.Get(block_id).audits(index).
+  struct Hit {
+    int64_t  block_id;
+    uint32_t index;
+  };
+
+  AuditIndex(ChainManager& chain, std::shared_ptr<BlockStore> blocks);
+  AuditIndex(ChainManager& chain, std::shared_ptr<BlockStore> blocks,
+             Options opts);
+
+  AuditIndex(const AuditIndex&) = delete;
+  AuditIndex& operator=(const AuditIndex&) = delete;
+
+  /// Index a block that is being committed. Blocks at or below the last
+  /// indexed one are ignored; a gap is first filled from the block store.
+  void AddBlock(const blockchain::Block& blk);
+
+  /// Index the blocks between the last indexed one and the chain head
+  /// from the block store. Returns the number of audits added.
+  size_t CatchUp();
+
+  /// Up to `limit` matches, in commit order, starting at `cursor` (0 for
+  /// the first page). `*next` is the cursor of the following page, or 0
+  /// once there are no more matches.
+  std::vector<Hit> Find(const Query& q, uint64_t cursor, size_t limit,
+                        uint64_t* next);
+
+  /// Audits indexed so far.
+  size_t Size() const;
+
+  /// Highest block id indexed so far (-1 if none).
+  int64_t LastBlockId() const { return last_id_.load(); }
+
+private:
+  using Seq      = uint32_t;             // sequence number of an audit
+  using Postings = std::vector<Seq>;
+
+  struct Entry {
+    int64_t  block_id;
+    int64_t  timestamp;
+    uint32_t index;          // position in the block
+    uint32_t file;           // interned file_id
+    uint32_t user;           // interned user_id
+  };
+
+  /// Caller holds mu_ exclusively.
+  void addLocked(const blockchain::Block& blk);
+  size_t catchUpLocked(int64_t through);
+  static uint32_t intern(std::unordered_map<std::string, uint32_t>* ids,
+                         std::vector<Postings>* lists, const std::string& key);
+
+  ChainManager&               chain_;
+  std::shared_ptr<BlockStore> blocks_;
+  Options                     opts_;
+
+  mutable std::shared_mutex   mu_;
+  std::vector<Entry>          entries_;      // by sequence number
+  std::unordered_map<std::string, uint32_t> file_ids_;
+  std::unordered_map<std::string, uint32_t> user_ids_;
+  std::vector<Postings>       by_file_;
+  std::vector<Postings>       by_user_;
+  std::map<int64_t, Postings> by_time_;      // bucket -> postings
+  std::atomic<int64_t>        last_id_{-1};
+};
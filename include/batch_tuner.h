@@ -0,0 +1,82 @@
+#pragma once
+
+#include "metrics.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+/// Chooses block size and interval for BlockScheduler's adaptive mode.
+///
+/// It keeps a moving window of block rounds (ProposeBlock, CommitBlock
+/// and the local commit, including the peers' signature checks) and fits
+/// round = fixed + per_audit * audits by least squares. It also tracks
+/// the ingest rate as an exponential moving average. From these it picks
+/// the largest block that:
+///  - lets every audit commit within target_latency, counting the wait to
+///    fill the block plus the round;
+///  - keeps the predicted round under round_deadline (the peers' RPC
+///    deadline).
+/// If the ingest rate needs larger blocks to keep up, that wins over
+/// the latency target. Everything stays within the min/max bounds.
+class BatchTuner {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Options {
+    size_t                    min_batch = 1;
+    size_t                    max_batch = 10000;
+    std::chrono::milliseconds min_interval{10};
+    std::chrono::milliseconds max_interval{1000};
+    std::chrono::milliseconds target_latency{250};   // arrival to commit
+    std::chrono::milliseconds round_deadline{150};   // per block round
+    size_t                    window = 32;           // rounds in the fit
+  };
+
+  /// What the leader should do next.
+  struct Plan {
+    size_t                    batch;      // cut the block at this many
+    std::chrono::milliseconds interval;   // or after this long
+  };
+
+  explicit BatchTuner(Options opts);
+
+  /// `appended` is MempoolManager::Appended() at `now`.
+  void ObserveIngest(uint64_t appended, Clock::time_point now);
+
+  /// A block of `audits` took `round` from proposal to local commit.
+  void ObserveRound(size_t audits, std::chrono::microseconds round);
+
+  Plan Current() const;
+
+  /// Current estimates: audits/s, and the fitted round cost in seconds.
+  double IngestRate() const;
+  double FixedCost() const;
+  double PerAuditCost() const;
+
+private:
+  void fit();      // window -> fixed_, per_audit_ (mu_ held)
+  void replan();   // estimates -> plan_ and the gauges (mu_ held)
+
+  struct Round {
+    double audits;
+    double secs;
+  };
+
+  Options           opts_;
+  mutable std::mutex mu_;
+  std::deque<Round> rounds_;
+  double            fixed_;       // seconds per round
+  double            per_audit_;   // seconds per audit
+  double            rate_ = 0;    // audits/s
+  uint64_t          last_appended_ = 0;
+  Clock::time_point last_seen_{};
+  Plan              plan_;
+
+  Gauge&            batch_gauge_;
+  Gauge&            interval_gauge_;
+  Gauge&            rate_gauge_;
+  Gauge&            fixed_gauge_;
+  Gauge&            per_audit_gauge_;
+};
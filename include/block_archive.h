@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// A compressed, read-only image of one sealed block segment.
+///
+/// The segment's bytes are cut into frames at record boundaries, and each
+/// frame is compressed on its own. A frame table and footer at the end of
+/// the file map segment offsets to frames. Offsets and lengths in the
+/// segment index therefore still apply: Read() finds the one frame that
+/// holds the range and inflates only that frame. The file is mmap'd, and
+/// each reader thread keeps the last frame it inflated, so a scan of
+/// consecutive blocks inflates each frame once.
+///
+/// Frames are zstd-compressed when the build has zstd (BLOCKSTORE_HAVE_ZSTD)
+/// and zlib-compressed otherwise. The codec is recorded in the footer.
+class BlockArchive {
+public:
+  /// A run of whole records in the segment: [offset, offset + length).
+  struct Span {
+    uint64_t offset;
+    uint32_t length;
+  };
+
+  /// Compress `segment` frame by frame, one frame per span (the spans must
+  /// be in order and not overlap), and write the archive to `path`. The
+  /// file is written under a temporary name, fsynced and then renamed.
+  static bool Write(const std::string& path, const std::string& segment,
+                    const std::vector<Span>& frames);
+
+  /// Map the archive at `path`. Null if it is missing, truncated, or uses
+  /// a codec this build does not have.
+  static std::unique_ptr<BlockArchive> Open(const std::string& path);
+
+  ~BlockArchive();
+
+  BlockArchive(const BlockArchive&) = delete;
+  BlockArchive& operator=(const BlockArchive&) = delete;
+
+  /// Copy `length` segment bytes at `offset` into `out`. False if the range
+  /// is not within one frame or the frame does not inflate.
+  bool Read(uint64_t offset, uint32_t length, std::string* out) const;
+
+  /// Size of the archive file.
+  uint64_t FileBytes() const { return size_; }
+
+  /// Size of the segment it replaces.
+  uint64_t SegmentBytes() const { return segment_bytes_; }
+
+private:
+  struct Frame {
+    uint64_t offset;        // in the segment
+    uint64_t file_offset;   // in the archive
+    uint32_t length;        // in the segment
+    uint32_t packed;        // in the archive
+  };
+
+  BlockArchive();
+
+  const uint64_t     serial_;           // tells archives apart in the cache
+  const char*        base_ = nullptr;   // the mmap'd file
+  uint64_t           size_ = 0;
+  uint32_t           codec_ = 0;
+  uint64_t           segment_bytes_ = 0;
+  std::vector<Frame> frames_;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "block_chain.pb.h"    // blockchain::Block
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/// LRU cache of GetBlock replies as ready-to-send wire bytes.
+///
+/// Each entry is a serialized, successful GetBlockResponse, so a hit is
+/// answered without touching the block store or protobuf. Blocks are put
+/// in when they commit and whenever a miss is served. The cache is
+/// bounded by the total size of the cached bytes; the least recently used
+/// entries are evicted first. Entries are immutable and shared, so a reply
+/// can still be in flight after its entry has been evicted.
+class BlockCache {
+public:
+  using Bytes = std::shared_ptr<const std::string>;
+
+  struct Stats {
+    uint64_t hits      = 0;
+    uint64_t misses    = 0;
+    uint64_t evictions = 0;
+    size_t   entries   = 0;
+    size_t   bytes     = 0;
+
+    double HitRate() const {
+      uint64_t total = hits + misses;
+      return total ? static_cast<double>(hits) / total : 0.0;
+    }
+  };
+
+  explicit BlockCache(size_t capacity_bytes = 64u << 20);   // 64 MiB
+
+  BlockCache(const BlockCache&) = delete;
+  BlockCache& operator=(const BlockCache&) = delete;
+
+  /// Cached reply for block `id`, or null (counted as a hit or a miss).
+  Bytes Get(int64_t id);
+
+  /// Cache `bytes` as the reply for block `id` (replacing any entry).
+  /// Entries larger than the whole capacity are not kept.
+  void Put(int64_t id, Bytes bytes);
+
+  /// Encode `blk` and cache it; returns the encoded reply.
+  Bytes PutBlock(const blockchain::Block& blk);
+
+  /// Serialized GetBlockResponse{block = blk, status = "success"}.
+  static Bytes Encode(const blockchain::Block& blk);
+
+  Stats GetStats() const;
+
+private:
+  using Entry = std::pair<int64_t, Bytes>;
+
+  size_t                 capacity_;
+  mutable std::mutex     mu_;
+  std::list<Entry>       lru_;     // most recently used first
+  std::unordered_map<int64_t, std::list<Entry>::iterator> index_;
+  Stats                  stats_;
+};
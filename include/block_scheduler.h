@@ -2,20 +2,54 @@
 
 #include "common.grpc.pb.h"        // common::FileAudit
 #include "block_chain.grpc.pb.h"   // blockchain::Block, BlockVoteResponse, BlockCommitResponse
+#include "audit_index.h"
+#include "batch_tuner.h"
+#include "block_cache.h"
+#include "block_store.h"
 #include "chain_manager.h"
+#include "latency_histogram.h"
 #include "leader_config.h"
 #include "mempool_manager.h"
 #include "merkle_tree.h"
+#include "metrics.h"
 
 #include <grpcpp/grpcpp.h>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <thread>
+#include <unordered_set>
 #include <vector>
 
-/// Periodically triggers block proposal when thresholds are met.
+/// Cuts a block as soon as `batch_size` audits are pending, or when the
+/// batch interval expires with some pending. The thread sleeps on the
+/// mempool's condition variable in between, so an idle node uses no CPU.
+///
+/// Production is pipelined: a builder thread sorts and hashes the next
+/// batch (skipping req_ids already in flight) on top of the last built
+/// block, while a voter thread runs the previous blocks through propose
+/// and commit, in order. Up to `pipeline_depth` blocks are in flight. If a
+/// block is rejected, it and every block built on it are discarded; their
+/// audits are still in the mempool and go into the next block.
+///
+/// ProposeBlock and CommitBlock go to all peers at once (gRPC callback
+/// API); each round returns as soon as the configured quorum has answered
+/// (the leader counts as one vote), so a slow peer no longer delays the
+/// block. Per-peer RPC latencies are kept in histograms and logged
+/// periodically.
+///
+/// With proposal_mode "compact" (the default), proposals carry req_ids
+/// instead of audits and commits only the block's id and hash. A peer that
+/// lacks audits, or a commit's proposal, gets them resent to it alone.
+///
+/// With batch_mode "adaptive", a BatchTuner replaces the fixed batch size
+/// and interval. It is fed the ingest rate and the time of each block round,
+/// and blocks are also capped at its batch size.
 class BlockScheduler {
 public:
   using StubList =
@@ -24,9 +58,13 @@ public:
   BlockScheduler(
     std::shared_ptr<MempoolManager> mempool,
     ChainManager&                    chain,
+    std::shared_ptr<BlockStore>      blocks,
     StubList&                        stubs,
+    const std::vector<std::string>&  peers,
     const LeaderConfig&              cfg,
-    std::function<bool()>            isLeaderFn
+    std::function<bool()>            isLeaderFn,
+    std::shared_ptr<BlockCache>      cache = nullptr,
+    std::shared_ptr<AuditIndex>      index = nullptr
   );
 
   ~BlockScheduler();
@@ -37,16 +75,75 @@ public:
   /// Stops the scheduler (and joins the thread).
   void stop();
 
+  /// Re-check isLeaderFn now instead of at the next batch interval: a new
+  /// leader starts cutting blocks at once, a deposed one stops proposing.
+  void leadershipChanged();
+
 private:
-  void loop();
-  void createAndBroadcastBlock(std::vector<common::FileAudit> pending);
+  /// RPC latencies and failures towards one peer (same order as the
+  /// stubs); owned by the metrics registry.
+  struct PeerLatency {
+    std::string       addr;
+    LatencyHistogram* propose        = nullptr;
+    LatencyHistogram* commit         = nullptr;
+    Counter*          propose_errors = nullptr;
+    Counter*          commit_errors  = nullptr;
+  };
+  using PeerStats = std::vector<PeerLatency>;
+
+  /// A built block waiting for, or going through, the vote.
+  struct InFlight {
+    std::shared_ptr<blockchain::Block> block;
+    std::shared_ptr<blockchain::Block> proposal;   // compact form, or block
+    std::vector<std::string>           req_ids;
+  };
+
+  void buildLoop();
+  void voteLoop();
+  /// Sleep until `until` or stop(), whichever comes first.
+  void pause(std::chrono::steady_clock::time_point until);
+  /// Sort `pending` and build block `id` on top of `prev_hash` from the
+  /// oldest `max_audits` of them.
+  InFlight buildBlock(std::vector<PendingAudit> pending, int64_t id,
+                      const std::string& prev_hash, size_t max_audits) const;
+  /// Batch size and interval for the next block.
+  BatchTuner::Plan plan() const;
+  /// Returns true once the block is committed locally.
+  bool proposeAndCommit(const InFlight& f);
+  /// Drop every queued block after `f` was rejected (voter thread).
+  void rollback(const InFlight& f);
+  void logPeerLatencies() const;
 
   std::shared_ptr<MempoolManager> mempool_;
   ChainManager&                   chain_;
+  std::shared_ptr<BlockStore>     blocks_;
+  std::shared_ptr<BlockCache>     cache_;      // may be null
+  std::shared_ptr<AuditIndex>     index_;      // may be null
   StubList&                       stubs_;
   const LeaderConfig&             cfg_;
   std::function<bool()>           isLeaderFn_;
+  size_t                          quorum_;     // peer acks needed per round
+  std::unique_ptr<BatchTuner>     tuner_;      // adaptive mode only
+
+  // Shared with in-flight callbacks, which may finish after a round returns
+  std::shared_ptr<PeerStats>      stats_;
+  uint64_t                        committed_ = 0;
+
+  const size_t                    depth_;      // max blocks in flight
+
+  // Pipeline state, guarded by pipe_mu_
+  std::mutex                      pipe_mu_;
+  std::condition_variable         pipe_cv_;
+  std::deque<InFlight>            queue_;          // built, not yet voted on
+  size_t                          inflight_ = 0;   // queue_ + the one in the vote
+  std::unordered_set<std::string> inflight_ids_;   // their req_ids
+  int64_t                         tip_id_ = -1;    // last built block
+  std::string                     tip_hash_;
+  uint64_t                        epoch_ = 0;      // bumped by rollback()
+  // Bumped when blocks leave the pipeline, to re-arm the builder's wait
+  std::atomic<uint64_t>           released_{0};
 
-  std::thread                     thr_;
+  std::thread                     builder_;
+  std::thread                     voter_;
   std::atomic<bool>               running_{false};
 };
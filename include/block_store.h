@@ -0,0 +1,136 @@
+#pragma once
+
+#include "block_archive.h"
+#include "block_chain.pb.h"    // blockchain::Block
+#include "key_registry.h"
+#include "metrics.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/// Append-only block storage in rolling segment files.
+///
+/// Blocks are appended as serialized protobuf records to
+/// `<dir>/segment_<n>.dat`; a new segment starts once the current one
+/// passes `segment_bytes`. An offset index (block id -> segment, offset,
+/// length) is kept in memory and mirrored in a fixed-width
+/// `<dir>/index.dat`, so startup never scans the segments except for a
+/// short tail after a crash. Reads use pread() on the segment fds.
+///
+/// Writes return once the data is in the page cache; a background thread
+/// fsyncs the segment and index in groups (every `sync_interval_ms`, or
+/// sooner once `sync_every` writes are pending). Use Sync() to force it.
+///
+/// Cold segments are tiered out: a background thread compresses each
+/// sealed segment not written for `archive_after_s` into
+/// `<dir>/segment_<n>.arc` (see BlockArchive), then deletes the segment.
+/// The index is unchanged, so reads of those blocks inflate one frame of
+/// the mmap'd archive instead of calling pread().
+///
+/// Blocks missing from the index fall back to legacy block_<id>.{pb,json}
+/// files in `dir`, so existing data keeps being served.
+///
+/// With a KeyRegistry, stored audits name their key by key_id and Get()
+/// puts the PEM back, so readers always see complete audits.
+class BlockStore {
+public:
+  struct Options {
+    uint64_t segment_bytes    = 64ull << 20;  // 64 MiB
+    int      sync_interval_ms = 50;
+    int      sync_every       = 64;
+    // Archive sealed segments idle for this long (0 disables tiering)
+    int      archive_after_s     = 0;
+    int      archive_interval_ms = 60000;       // between archiver passes
+    uint32_t archive_frame_bytes = 128u << 10;  // segment bytes per frame
+  };
+
+  explicit BlockStore(std::string dir);
+  BlockStore(std::string dir, Options opts,
+             std::shared_ptr<KeyRegistry> keys = nullptr);
+
+  /// Flushes pending writes and closes all segments.
+  ~BlockStore();
+
+  BlockStore(const BlockStore&) = delete;
+  BlockStore& operator=(const BlockStore&) = delete;
+
+  /// Append a block (a later Put of the same id replaces it).
+  bool Put(const blockchain::Block& blk);
+
+  /// Read block `id`. On failure returns false and fills `err`.
+  bool Get(int64_t id, blockchain::Block* blk, std::string* err) const;
+
+  /// Read the serialized bytes of block `id` from the segments only, as
+  /// stored (audits may name their key by key_id only).
+  bool GetSerialized(int64_t id, std::string* bytes) const;
+
+  /// True if block `id` is in the segment index.
+  bool Contains(int64_t id) const;
+
+  /// Number of blocks in the segment index.
+  size_t Size() const;
+
+  /// fsync everything written so far.
+  void Sync();
+
+  /// Archive every sealed segment last written more than `older_than` ago
+  /// and return how many were archived. The archiver thread calls this
+  /// with archive_after_s.
+  size_t ArchiveCold(std::chrono::seconds older_than);
+
+private:
+  struct Location {
+    uint32_t segment;
+    uint64_t offset;   // start of the block bytes within the segment
+    uint32_t length;   // length of the block bytes
+  };
+
+  void openOrRecover();
+  void recoverSegmentTail(uint32_t seg, uint64_t from);
+  bool openSegment(uint32_t seg);
+  bool appendIndex(int64_t id, const Location& loc);
+  std::string segmentPath(uint32_t seg) const;
+  std::string archivePath(uint32_t seg) const;
+  bool isArchived(uint32_t seg) const;
+  bool archiveSegment(uint32_t seg);
+  void archiverLoop();
+  void syncLocked(std::unique_lock<std::mutex>& lk);
+  void flusherLoop();
+
+  std::string dir_;
+  Options     opts_;
+  std::shared_ptr<KeyRegistry> keys_;   // may be null
+
+  mutable std::mutex                    mu_;
+  std::unordered_map<int64_t, Location> index_;
+  std::vector<int>                      seg_fds_;   // by segment number
+  std::vector<std::shared_ptr<const BlockArchive>> archives_;  // likewise
+  uint32_t                              active_seg_ = 0;
+  uint64_t                              active_size_ = 0;
+  int                                   index_fd_ = -1;
+  uint64_t                              index_bytes_ = 0;   // whole entries
+
+  // Group fsync state
+  int                     unsynced_ = 0;
+  bool                    syncing_ = false;
+  std::condition_variable sync_cv_;
+  bool                    stopping_ = false;
+  std::thread             flusher_;
+
+  // Tiering: readers hold retire_mu_ shared (taken before mu_) so an
+  // archived segment's fd is not closed under a pread()
+  mutable std::shared_mutex retire_mu_;
+  std::mutex                archive_mu_;   // one ArchiveCold() at a time
+  std::condition_variable   archive_cv_;
+  std::thread               archiver_;
+  Gauge&                    archived_gauge_;
+  Gauge&                    archive_bytes_gauge_;
+};
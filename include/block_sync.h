@@ -0,0 +1,63 @@
+#pragma once
+
+#include "block_chain.grpc.pb.h"   // blockchain::Block, BlockChainService
+#include "block_store.h"
+#include "chain_manager.h"
+#include "mempool_manager.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Catches the local chain up with peers that are ahead of it.
+///
+/// The missing ids are split into fixed-size ranges. Every source peer
+/// pulls ranges over the GetBlocks stream in parallel, each taking the
+/// lowest range it has not fetched yet that lies within its own height.
+/// Ranges are committed strictly in order: each block must extend the one
+/// before it (consecutive id, matching previous_hash), the blocks go to
+/// the block store, their metadata goes into the chain with one
+/// ChainManager::appendBatch() per range, and their audits leave the
+/// mempool. A range that fails on one peer is retried on another; the
+/// first range that no peer can supply ends the run, and the next
+/// heartbeat starts from there.
+class BlockSync {
+public:
+  struct Source {
+    std::string                              addr;
+    blockchain::BlockChainService::Stub*     stub;
+    int64_t                                  latest_id;
+  };
+
+  struct Options {
+    int64_t range_blocks     = 512;     // blocks per GetBlocks call
+    size_t  window           = 8;       // ranges fetched ahead of the commit
+    int     range_timeout_ms = 30000;   // deadline of one GetBlocks call
+  };
+
+  /// `mempool` (may be null) loses the audits of every block committed.
+  BlockSync(ChainManager& chain, std::shared_ptr<BlockStore> blocks,
+            std::shared_ptr<MempoolManager> mempool);
+  BlockSync(ChainManager& chain, std::shared_ptr<BlockStore> blocks,
+            std::shared_ptr<MempoolManager> mempool, Options opts);
+
+  /// Fetch and commit blocks up to the highest `latest_id` among `sources`.
+  /// Returns the number of blocks committed.
+  int64_t Run(const std::vector<Source>& sources);
+
+private:
+  /// Stream [start, end] from one peer, checking ids and internal links.
+  bool fetchRange(const Source& src, int64_t start, int64_t end,
+                  std::vector<blockchain::Block>* out,
+                  std::string* err) const;
+
+  /// Link `range` to the chain head, store it and append its metadata.
+  bool commitRange(const std::vector<blockchain::Block>& range,
+                   std::string* err);
+
+  ChainManager&               chain_;
+  std::shared_ptr<BlockStore> blocks_;
+  std::shared_ptr<MempoolManager> mempool_;
+  Options                     opts_;
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "common.pb.h"   // common::FileAudit
+#include <string>
+
+/// The canonical JSON form of a FileAudit: the bytes clients sign, the
+/// Merkle leaves hash and block hashes concatenate.
+///
+/// Output is byte-identical to building an nlohmann::ordered_json with the
+/// keys access_type, file_info{file_id,file_name}, req_id, timestamp,
+/// user_info{user_id,user_name} and calling dump(), but is written
+/// straight into `out` without building a JSON document. Strings are
+/// escaped the way dump() does (", \, \b \f \n \r \t, other control
+/// characters as \u00xx); UTF-8 passes through unchanged. Like dump(),
+/// invalid UTF-8 throws (std::invalid_argument here, type_error 316 there).
+void AppendCanonicalPayload(const common::FileAudit& audit, std::string* out);
+
+/// Convenience wrapper returning a fresh string.
+std::string CanonicalPayload(const common::FileAudit& audit);
+
+/// SHA-256 hex of the canonical payload (the audit's Merkle leaf).
+std::string CanonicalLeafHash(const common::FileAudit& audit);
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cstdint>
+#include <fstream>
+#include <memory>
 #include <string>
 #include <vector>
 #include <mutex>
@@ -13,13 +15,27 @@ struct BlockMeta {
   std::string merkle_root;
 };
 
-/// Manages chain.json on disk + in-memory view.
+/// Manages chain metadata on disk + in-memory view.
+///
+/// On disk, `path` (chain.json) is a checkpoint: a JSON array of every
+/// block up to some id. Blocks appended after it go to `path + ".log"`,
+/// one JSON object per line. append() writes only the new line; once the
+/// log grows past a fraction of the checkpoint, a new checkpoint is written
+/// (temp file + rename) and the log restarts. Startup loads the checkpoint
+/// and replays the log tail.
+///
+/// The chain head is also published as an immutable snapshot that is
+/// swapped atomically on every append, so getHead() and the getLast*()
+/// accessors never wait for a writer.
 class ChainManager {
 public:
-  /// Construct the manager over the given file path.
+  /// Construct the manager over the given checkpoint path.
   explicit ChainManager(std::string path);
 
-  /// Latest block ID (0 if none).
+  /// Latest block (null if none); never blocks on writers.
+  std::shared_ptr<const BlockMeta> getHead() const;
+
+  /// Latest block ID (-1 if none).
   int64_t getLastID() const;
 
   /// Latest block hash ("" if none).
@@ -28,17 +44,35 @@ public:
   /// Latest block merkle_root ("" if none).
   std::string getLastMerkleRoot() const;
 
-  /// All blocks in chain order.
+  /// All blocks in chain order (a full copy; prefer getRange()).
   std::vector<BlockMeta> getAll() const;
 
-  /// Append a new block (and rewrite file).
+  /// Blocks with from <= id <= to, in chain order.
+  std::vector<BlockMeta> getRange(int64_t from, int64_t to) const;
+
+  /// Append a new block (one log record; checkpoints now and then).
   void append(const BlockMeta& meta);
 
+  /// Append consecutive blocks with a single log write and flush.
+  void appendBatch(const std::vector<BlockMeta>& metas);
+
 private:
   void loadFromDisk();
-  void writeToDisk() const;
+  void replayLog();
+  void writeLogRecords(const std::string& lines);
+  void maybeCheckpoint(size_t total);
+  void writeCheckpoint();
+  void publishHead(const BlockMeta& last);
 
   std::string         path_;
+  std::string         log_path_;
   mutable std::mutex  mu_;
   std::vector<BlockMeta> blocks_;
+  // Copy of blocks_.back(); use std::atomic_load/atomic_store only
+  std::shared_ptr<const BlockMeta> head_;
+
+  // File state; io_mu_ serializes writers so readers never wait on disk.
+  std::mutex          io_mu_;
+  std::ofstream       log_;
+  size_t              checkpointed_ = 0;   // blocks covered by chain.json
 };
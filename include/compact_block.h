@@ -0,0 +1,41 @@
+#pragma once
+
+#include "block_chain.pb.h"    // blockchain::Block
+#include "mempool_manager.h"
+#include <string>
+#include <vector>
+
+/// Compact forms of a block for ProposeBlock and CommitBlock.
+///
+/// Peers normally hold a block's audits already, because they were
+/// gossiped. So the compact proposal carries the header and the req_ids
+/// in block order, without the audits, and the peer rebuilds the block
+/// from its own mempool. A peer that lacks some audits names them in
+/// BlockVoteResponse.missing_ids, and the leader proposes again with
+/// just those audits attached. The compact commit is only the block's
+/// id and hash, and the peer matches it against the proposal it
+/// accepted.
+
+/// Header and req_ids of `full`, without the audits.
+blockchain::Block CompactProposal(const blockchain::Block& full);
+
+/// Only the id and hash of `full`.
+blockchain::Block CompactCommit(const blockchain::Block& full);
+
+/// A compact commit has no audits and no req_ids.
+inline bool IsCompactCommit(const blockchain::Block& blk) {
+  return blk.audits_size() == 0 && blk.audit_ids_size() == 0;
+}
+
+/// `compact` with the audits of `full` whose req_ids are in `ids`.
+blockchain::Block WithAudits(
+    const blockchain::Block& compact, const blockchain::Block& full,
+    const google::protobuf::RepeatedPtrField<std::string>& ids);
+
+/// Rebuild the full block from a compact proposal. Each audit comes from
+/// the proposal if it carries one, else from `mempool`. Returns false if
+/// some audits are in neither; their req_ids are then in `missing`.
+bool ExpandProposal(const blockchain::Block& compact,
+                    const MempoolManager& mempool,
+                    blockchain::Block* full,
+                    std::vector<std::string>* missing);
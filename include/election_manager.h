@@ -7,14 +7,28 @@
 #include "block_chain.grpc.pb.h"
 #include <grpcpp/grpcpp.h>
 #include <thread>
+#include <condition_variable>
+#include <mutex>
 #include <atomic>
 #include <vector>
 #include <string>
 #include <chrono>
 
 /// Periodically checks heartbeats & triggers elections.
+///
+/// TriggerElection goes to all peers at once. The election is won as soon
+/// as a majority of the cluster (this node included) has voted yes, and
+/// lost as soon as that can no longer happen, so dead peers only cost
+/// time when the outcome depends on them. The winner then announces
+/// itself to all peers with NotifyLeadership, without waiting for them.
 class ElectionManager {
 public:
+  struct Options {
+    std::chrono::milliseconds interval{2000};        // between leader checks
+    std::chrono::milliseconds initial_delay{30000};  // before the first check
+    std::chrono::milliseconds rpc_timeout{1000};     // per TriggerElection
+  };
+
   ElectionManager(
     const std::vector<std::string>& peers,
     const std::string& self_addr,
@@ -23,6 +37,15 @@ public:
     std::shared_ptr<MempoolManager> mempool,
     ChainManager&                   chain
   );
+  ElectionManager(
+    const std::vector<std::string>& peers,
+    const std::string& self_addr,
+    std::shared_ptr<HeartbeatTable> hb_table,
+    ElectionState&                 state,
+    std::shared_ptr<MempoolManager> mempool,
+    ChainManager&                   chain,
+    Options                         opts
+  );
   ~ElectionManager();
 
   /// Launch background election thread.
@@ -33,6 +56,10 @@ public:
 
 private:
   void loop();
+  /// Collect votes from all peers; true once a majority said yes.
+  bool runElection();
+  /// Sleep for `d`, or until stop().
+  void sleepFor(std::chrono::milliseconds d);
 
   std::vector<std::unique_ptr<blockchain::BlockChainService::Stub>> stubs_;
   std::vector<std::string> peer_addrs_;
@@ -42,7 +69,10 @@ private:
   std::shared_ptr<MempoolManager> mempool_;
   ChainManager&            chain_;
 
+  Options                  opts_;
+
   std::atomic<bool>        running_{false};
+  std::mutex               mu_;
+  std::condition_variable  cv_;      // wakes sleepFor() on stop()
   std::thread              thr_;
-  std::chrono::seconds     interval_{2};
 };
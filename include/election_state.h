@@ -1,25 +1,78 @@
 #pragma once
+#include <atomic>
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 /// Holds the current election term, which peer we've voted for, and who the leader is.
-struct ElectionState {
-  // The current term number; starts at 0.
-  int64_t       current_term    = 0;
+///
+/// Shared by the gRPC handlers, the heartbeat and election managers and
+/// the block scheduler. The three fields are published together as an
+/// immutable snapshot: readers take it with an atomic load and never
+/// block, writers copy, modify and swap it under a mutex. Whether this
+/// node is the leader is also kept as a plain atomic flag, since the
+/// scheduler asks that on every block.
+class ElectionState {
+public:
+  struct Snapshot {
+    // The current term number; starts at 0.
+    int64_t     term = 0;
+    // The address (host:port) of the peer we voted for in this term. Empty = none.
+    std::string voted_for;
+    // The address of the current leader as we know it. Empty = unknown.
+    std::string leader;
+  };
 
-  // The address (host:port) of the peer we voted for in this term. Empty = none.
-  std::string   voted_for       = "";
+  /// Called after the term or the leader changes, with the state before
+  /// and after. Runs on the thread that made the change, outside the lock,
+  /// so two changes racing may be reported out of order; look at
+  /// snapshot() or isLeader() for the latest state.
+  using Listener = std::function<void(const Snapshot& before,
+                                      const Snapshot& after)>;
 
-  // The address of the current leader as we know it. Empty = unknown.
-  std::string   current_leader  = "";
+  /// `self_addr` is this node's address, used by isLeader().
+  explicit ElectionState(std::string self_addr = "");
+
+  ElectionState(const ElectionState&) = delete;
+  ElectionState& operator=(const ElectionState&) = delete;
+
+  /// Consistent view of all three fields (lock-free).
+  std::shared_ptr<const Snapshot> snapshot() const;
+
+  /// Whether the known leader is this node (a single atomic load).
+  bool isLeader() const { return is_leader_.load(std::memory_order_acquire); }
 
   // Getters / setters
-  void       setTerm(int64_t term)                { current_term    = term; }
-  int64_t    getTerm() const                       { return current_term; }
+  void        setTerm(int64_t term);
+  int64_t     getTerm() const       { return snapshot()->term; }
+
+  void        setVotedFor(const std::string& addr);
+  std::string getVotedFor() const   { return snapshot()->voted_for; }
+
+  void        setLeader(const std::string& addr);
+  std::string getLeader() const     { return snapshot()->leader; }
+
+  /// Set the leader only if none is known yet; returns true if it was set.
+  bool        setLeaderIfUnknown(const std::string& addr);
+
+  /// Register a listener for term and leader changes.
+  void        subscribe(Listener fn);
+
+private:
+  /// Apply `change` to a copy of the current snapshot and publish it.
+  /// `change` returns false to leave the state untouched.
+  bool update(const std::function<bool(Snapshot&)>& change);
+
+  const std::string self_addr_;
 
-  void       setVotedFor(const std::string& addr)  { voted_for       = addr; }
-  const std::string& getVotedFor() const            { return voted_for; }
+  // Use std::atomic_load/atomic_store only
+  std::shared_ptr<const Snapshot> snap_;
+  std::atomic<bool>               is_leader_{false};
 
-  void       setLeader(const std::string& addr)    { current_leader  = addr; }
-  const std::string& getLeader() const              { return current_leader; }
+  std::mutex                      write_mu_;   // serializes update()
+  std::mutex                      listen_mu_;
+  std::vector<Listener>           listeners_;
 };
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "common.grpc.pb.h"         // common::FileAudit
+#include "block_chain.grpc.pb.h"    // blockchain::BlockChainService, AuditBatch
+#include "key_registry.h"
+#include "metrics.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+/// Background gossip of accepted audits to every peer.
+///
+/// Enqueue() never blocks on the network: each peer has a bounded queue
+/// and a worker thread that coalesces queued audits into one
+/// WhisperAuditBatch call (up to `max_batch`, waiting at most `linger_ms`
+/// for more to arrive). When a peer's queue is full the oldest audit is
+/// dropped; the leader still sees it through its own mempool. A peer that
+/// fails gets its batch back at the head of the queue and is retried with
+/// exponential backoff. Peers without WhisperAuditBatch (UNIMPLEMENTED)
+/// are served one WhisperAuditRequest per audit instead.
+///
+/// With a KeyRegistry, an audit goes to a peer by key_id alone once that
+/// peer has acknowledged the key: it accepted a batch carrying the PEM and
+/// said it interns keys. Audits whose key_id the peer cannot resolve are
+/// sent again at once with the PEM.
+class GossipPipeline {
+public:
+  using Stub = blockchain::BlockChainService::Stub;
+
+  struct Options {
+    size_t queue_limit = 10000;   // audits buffered per peer
+    size_t max_batch   = 256;     // audits per WhisperAuditBatch
+    int    linger_ms   = 5;       // wait for a batch to fill
+    int    timeout_ms  = 200;     // per-RPC deadline
+    int    backoff_min_ms = 100;
+    int    backoff_max_ms = 5000;
+  };
+
+  /// `stubs[i]` talks to `peers[i]`; the stubs must outlive the pipeline.
+  GossipPipeline(const std::vector<std::string>& peers,
+                 const std::vector<std::unique_ptr<Stub>>& stubs);
+  GossipPipeline(const std::vector<std::string>& peers,
+                 const std::vector<std::unique_ptr<Stub>>& stubs,
+                 Options opts,
+                 std::shared_ptr<KeyRegistry> keys = nullptr);
+
+  /// Stops the workers; audits still queued are discarded.
+  ~GossipPipeline();
+
+  GossipPipeline(const GossipPipeline&) = delete;
+  GossipPipeline& operator=(const GossipPipeline&) = delete;
+
+  /// Queue `audit` for every peer.
+  void Enqueue(const common::FileAudit& audit);
+
+  /// Audits currently queued across all peers.
+  size_t Pending() const;
+
+private:
+  struct Peer {
+    std::string                   addr;
+    Stub*                         stub;
+    mutable std::mutex            mu;
+    std::condition_variable       cv;
+    std::deque<common::FileAudit> queue;
+    uint64_t                      dropped = 0;
+    bool                          batch_rpc = true;   // false after UNIMPLEMENTED
+    // key_ids the peer holds (worker thread only)
+    std::unordered_set<std::string> known_keys;
+    Counter*                      errors = nullptr;   // failed deliveries
+    std::thread                   worker;
+  };
+
+  void workerLoop(Peer& peer);
+  bool sendBatch(Peer& peer, const std::vector<common::FileAudit>& batch);
+
+  Options                            opts_;
+  std::shared_ptr<KeyRegistry>       keys_;   // may be null
+  std::vector<std::unique_ptr<Peer>> peers_;
+  std::atomic<bool>                  stopping_{false};
+};
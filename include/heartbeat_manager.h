@@ -3,22 +3,46 @@
 #include "mempool_manager.h"
 #include "chain_manager.h"
 #include "election_state.h"
+#include "block_store.h"
 #include <grpcpp/grpcpp.h>
 #include "block_chain.grpc.pb.h"
 #include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 #include <thread>
 #include <chrono>
 
 /// Sends heartbeats periodically to peers.
+///
+/// Each round goes to all peers at once without waiting for the replies,
+/// so a dead peer doesn't delay the heartbeats to the others. A peer whose
+/// previous heartbeat is still outstanding is skipped for that round.
 class HeartbeatManager {
 public:
+  struct Options {
+    std::chrono::milliseconds interval{10000};    // between rounds
+    std::chrono::milliseconds rpc_timeout{1000};  // per SendHeartbeat
+    std::function<int()>      pressure;           // ingest pressure to send
+  };
+
+  HeartbeatManager(
+    const std::vector<std::string>& peers,
+    const std::string&              self_addr,
+    ElectionState&                  state,
+    std::shared_ptr<MempoolManager> mempool,
+    ChainManager&                   chain,
+    std::shared_ptr<HeartbeatTable> table,
+    std::shared_ptr<BlockStore>     blocks);
   HeartbeatManager(
     const std::vector<std::string>& peers,
     const std::string&              self_addr,
     ElectionState&                  state,
     std::shared_ptr<MempoolManager> mempool,
     ChainManager&                   chain,
-    std::shared_ptr<HeartbeatTable> table);
+    std::shared_ptr<HeartbeatTable> table,
+    std::shared_ptr<BlockStore>     blocks,
+    Options                         opts);
 
   ~HeartbeatManager();
   void start();
@@ -27,10 +51,10 @@ public:
 
 private:
   void loop();
+  /// Send `req` to every peer that isn't still busy with the last one.
+  void sendHeartbeats(const blockchain::HeartbeatRequest& req);
+  /// Pull missing blocks from every alive peer that is ahead (BlockSync).
   void syncMissingBlocks();
-  void fetchBlocksFromPeer(const std::string& peer,
-                           int64_t startId,
-                           int64_t endId);
 
   std::vector<std::unique_ptr<blockchain::BlockChainService::Stub>> stubs_;
   std::vector<std::string> peer_addrs_;
@@ -39,8 +63,14 @@ private:
   std::shared_ptr<MempoolManager> mempool_;
   ChainManager&                   chain_;
   std::shared_ptr<HeartbeatTable> table_;
+  std::shared_ptr<BlockStore>     blocks_;
+
+  Options                  opts_;
+  // Per peer: a heartbeat is in flight (shared with its callback)
+  std::shared_ptr<std::vector<std::atomic<bool>>> busy_;
 
   std::atomic<bool>        running_{false};
+  std::mutex               mu_;
+  std::condition_variable  cv_;      // wakes the loop on stop()
   std::thread              thr_;
-  std::chrono::seconds interval_{10};
 };
@@ -1,10 +1,10 @@
 #pragma once
+#include "logger.h"
 #include <string>
 #include <mutex>
 #include <unordered_map>
 #include <chrono>
 #include <vector>
-#include <iostream>
 
 /// One row in the heartbeat table.
 struct HeartbeatEntry {
@@ -12,6 +12,7 @@ struct HeartbeatEntry {
   std::string leader_address;
   int64_t     latest_block_id;
   int64_t     mem_pool_size;
+  int         pressure = 0;        // 0-100, see AdmissionControl::Pressure
   std::chrono::steady_clock::time_point last_seen;
   bool        alive = true;
 };
@@ -22,18 +23,22 @@ public:
   /// timeout_sec: how long before we mark a peer dead.
   explicit HeartbeatTable(int timeout_sec)
     : timeout_(std::chrono::seconds(timeout_sec)) {}
+  explicit HeartbeatTable(std::chrono::milliseconds timeout)
+    : timeout_(timeout) {}
 
   /// Called whenever we get a heartbeat from `from`.  
   void update(const std::string& from,
               const std::string& leader,
               int64_t latest_block_id,
-              int64_t mem_pool_size) {
+              int64_t mem_pool_size,
+              int pressure = 0) {
     std::lock_guard<std::mutex> lk(mu_);
     auto& e = table_[from];
     e.from_address     = from;
     e.leader_address   = leader;
     e.latest_block_id  = latest_block_id;
     e.mem_pool_size    = mem_pool_size;
+    e.pressure         = pressure;
     e.last_seen        = std::chrono::steady_clock::now();
     e.alive            = true;
   }
@@ -41,14 +46,20 @@ public:
   /// Remove peers that have not been heard from in `timeout_`.
   void sweep() {
     auto now = std::chrono::steady_clock::now();
-    std::lock_guard<std::mutex> lk(mu_);
-    for (auto& [k,e] : table_) {
-      if (now - e.last_seen > timeout_ && e.alive) {
-        std::cout << "[HeartbeatTable] marking " << k
-                  << " as dead (timeout)\n";
-        e.alive = false;
+    std::vector<std::string> dead;
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      for (auto& [k,e] : table_) {
+        if (now - e.last_seen > timeout_ && e.alive) {
+          dead.push_back(k);
+          e.alive = false;
+        }
       }
     }
+    // Logged after the lock is released, so heartbeats aren't held up
+    for (auto& k : dead) {
+      LOG_INFO("HeartbeatTable") << "marking " << k << " as dead (timeout)";
+    }
   }
 
   /// Snapshot of all entries.
@@ -65,5 +76,5 @@ public:
 private:
   mutable std::mutex mu_;
   std::unordered_map<std::string,HeartbeatEntry> table_;
-  std::chrono::seconds timeout_;
+  std::chrono::milliseconds timeout_;
 };
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "common.pb.h"    // common::FileAudit
+#include "metrics.h"
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/// Every distinct client public key this node has stored, by key_id
+/// (KeyFingerprint of the PEM).
+///
+/// Audits are kept in memory with their PEM. Strip() swaps the PEM for
+/// the key_id where audits are written out: the mempool log, the block
+/// store and gossip to peers that intern keys too. Resolve() puts the PEM
+/// back when they are read in. The canonical payload does not cover
+/// public_key, so leaf and block hashes are the same in either form.
+///
+/// Keys are appended to the file at `path` as length-prefixed records,
+/// and fsynced before Intern() returns, so a key is on disk before any
+/// record that names it. The file is replayed at construction. There is
+/// no removal. Past `capacity` keys, new keys are not interned, and
+/// audits signed with them keep their PEM inline.
+class KeyRegistry {
+public:
+  explicit KeyRegistry(std::string path, size_t capacity = 1 << 16);
+  ~KeyRegistry();
+
+  KeyRegistry(const KeyRegistry&) = delete;
+  KeyRegistry& operator=(const KeyRegistry&) = delete;
+
+  /// key_id for `pem`, registering the key first if it is new. Empty if
+  /// the registry is full or the key could not be written.
+  std::string Intern(const std::string& pem);
+
+  /// The PEM registered under `key_id`, or false if there is none.
+  bool Lookup(const std::string& key_id, std::string* pem) const;
+
+  /// Replace the audit's PEM with its key_id. Returns false, leaving the
+  /// audit as it was, if the key cannot be interned.
+  bool Strip(common::FileAudit* audit);
+
+  /// Swap the key_id of an audit that has only a key_id for its PEM, the
+  /// inverse of Strip(). Returns false if the key_id is unknown; an audit
+  /// that has its PEM is left alone.
+  bool Resolve(common::FileAudit* audit) const;
+
+  size_t Size() const;
+
+private:
+  void load();
+  bool append(const std::string& pem);
+
+  std::string        path_;
+  size_t             capacity_;
+  int                fd_ = -1;
+  mutable std::mutex mu_;
+  std::unordered_map<std::string, std::string> by_id_;    // key_id -> PEM
+  std::unordered_map<std::string, std::string> by_pem_;   // PEM -> key_id
+  Gauge&             size_gauge_;
+};
+
+/// An audit that names its key by key_id alone.
+inline bool NeedsKey(const common::FileAudit& audit) {
+  return audit.public_key().empty() && !audit.key_id().empty();
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+/// Lock-free latency histogram with log-linear microsecond buckets.
+///
+/// Like an HDR histogram with two significant bits: every power-of-two
+/// range [2^k, 2^(k+1)) us is split into four equal buckets, so a bucket
+/// is at most 25% wide (values below 4 us are exact). Percentiles are
+/// reported as the upper bound of their bucket. Safe to Record() from gRPC
+/// callback threads while another thread logs Summary() or renders it.
+class LatencyHistogram {
+public:
+  static constexpr size_t kSubBuckets = 4;
+  static constexpr size_t kBuckets    = 124;   // up to 2^32 us (~70 minutes)
+
+  void Record(std::chrono::microseconds d) {
+    uint64_t us = d.count() > 0 ? static_cast<uint64_t>(d.count()) : 0;
+    buckets_[BucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_us_.fetch_add(us, std::memory_order_relaxed);
+  }
+
+  uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+
+  /// Sum of all recorded samples, in microseconds.
+  uint64_t SumUs() const { return sum_us_.load(std::memory_order_relaxed); }
+
+  /// Samples in bucket `b`.
+  uint64_t BucketCount(size_t b) const {
+    return buckets_[b].load(std::memory_order_relaxed);
+  }
+
+  /// Exclusive upper bound (us) of bucket `b`.
+  static uint64_t UpperBoundUs(size_t b) {
+    if (b < kSubBuckets) return b + 1;
+    uint64_t octave = b / kSubBuckets + 1;        // msb of the values
+    uint64_t sub    = b % kSubBuckets;
+    return (kSubBuckets + sub + 1) << (octave - 2);
+  }
+
+  /// Upper bound (us) of the bucket holding the p-th percentile (0 < p <= 100).
+  uint64_t PercentileUs(double p) const {
+    uint64_t total = Count();
+    if (total == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(total * p / 100.0 + 0.5);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < kBuckets; ++b) {
+      seen += BucketCount(b);
+      if (seen >= rank) return UpperBoundUs(b);
+    }
+    return UpperBoundUs(kBuckets - 1);
+  }
+
+  /// "n=<count> p50=<us>us p99=<us>us max<=<us>us"
+  std::string Summary() const {
+    std::ostringstream os;
+    os << "n=" << Count()
+       << " p50=" << PercentileUs(50) << "us"
+       << " p99=" << PercentileUs(99) << "us"
+       << " max<=" << PercentileUs(100) << "us";
+    return os.str();
+  }
+
+private:
+  static size_t BucketOf(uint64_t us) {
+    if (us < kSubBuckets) return static_cast<size_t>(us);
+    size_t msb = 63 - static_cast<size_t>(__builtin_clzll(us));
+    size_t sub = static_cast<size_t>(us >> (msb - 2)) & (kSubBuckets - 1);
+    size_t b   = (msb - 1) * kSubBuckets + sub;
+    return b < kBuckets ? b : kBuckets - 1;
+  }
+
+  std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+  std::atomic<uint64_t>                       count_{0};
+  std::atomic<uint64_t>                       sum_us_{0};
+};
@@ -1,8 +1,19 @@
 #pragma once
 
+#include "logger.h"
+#include "storage_format.h"
 #include <string>
 
-/// Loads leader.json { leader_addr, batch_size, batch_interval_s }.
+/// Loads leader.json { leader_addr, batch_size, batch_interval_s }
+/// plus the optional { storage_format, quorum, pipeline_depth,
+/// snapshot_interval_s, heartbeat_interval_ms, heartbeat_timeout_ms,
+/// election_interval_ms, election_initial_delay_ms,
+/// election_rpc_timeout_ms, metrics_port, log_level, rpc_control_threads,
+/// rpc_consensus_threads, rpc_ingest_threads, rpc_sync_threads,
+/// rpc_queue_limit, rpc_max_message_mb, rpc_keepalive_ms, max_mempool,
+/// max_ingest_rate, client_rate, client_burst, batch_mode, batch_min,
+/// batch_max, batch_interval_min_ms, batch_interval_max_ms,
+/// target_commit_ms, proposal_mode, intern_keys, archive_after_s }.
 class LeaderConfig {
 public:
   /// Throws std::runtime_error on parse error or missing fields.
@@ -17,8 +28,147 @@ public:
   /// Seconds to wait before forcing a block.
   int getBatchIntervalSec() const { return batch_interval_s_; }
 
+  /// Encoding for mempool.dat ("binary" unless overridden).
+  StorageFormat getStorageFormat() const { return storage_format_; }
+
+  /// Cluster members (leader included) that must accept a block before it
+  /// is committed; 0 (the default) means a simple majority.
+  int getQuorum() const { return quorum_; }
+
+  /// Blocks the leader may have built but not yet committed (>= 1; 1 means
+  /// no pipelining). Defaults to 2: the next block is built during the vote.
+  int getPipelineDepth() const { return pipeline_depth_; }
+
+  /// Seconds between snapshots for bootstrapping new nodes (0 disables).
+  int getSnapshotIntervalSec() const { return snapshot_interval_s_; }
+
+  /// Milliseconds between heartbeat rounds (default 10000).
+  int getHeartbeatIntervalMs() const { return heartbeat_interval_ms_; }
+
+  /// Milliseconds without a heartbeat before a peer counts as dead
+  /// (default 15000).
+  int getHeartbeatTimeoutMs() const { return heartbeat_timeout_ms_; }
+
+  /// Milliseconds between checks whether the leader is still alive
+  /// (default 2000).
+  int getElectionIntervalMs() const { return election_interval_ms_; }
+
+  /// Milliseconds after startup before the first check (default 30000),
+  /// so the heartbeat table can fill up first.
+  int getElectionInitialDelayMs() const { return election_initial_delay_ms_; }
+
+  /// Deadline of each heartbeat and election RPC (default 1000).
+  int getElectionRpcTimeoutMs() const { return election_rpc_timeout_ms_; }
+
+  /// HTTP port serving GET /metrics (0, the default, disables it).
+  int getMetricsPort() const { return metrics_port_; }
+
+  /// Least severe level that is logged: "debug", "info" (default), "warn"
+  /// or "error". Debug lines also need a build with AUDIT_LOG_MIN_LEVEL=0.
+  LogLevel getLogLevel() const { return log_level_; }
+
+  /// Threads of the priority lane: heartbeats and election votes
+  /// (default 1).
+  int getRpcControlThreads() const { return rpc_control_threads_; }
+
+  /// Threads serving ProposeBlock and CommitBlock (default 2).
+  int getRpcConsensusThreads() const { return rpc_consensus_threads_; }
+
+  /// Threads serving SubmitAudit and gossip (default 2).
+  int getRpcIngestThreads() const { return rpc_ingest_threads_; }
+
+  /// Most threads of gRPC's sync pool, which serves the streams and
+  /// queries (default 8).
+  int getRpcSyncThreads() const { return rpc_sync_threads_; }
+
+  /// Calls each lane method accepts ahead of its threads (default 64).
+  int getRpcQueueLimit() const { return rpc_queue_limit_; }
+
+  /// Largest message the server sends or receives, in MiB (default 16).
+  int getRpcMaxMessageMb() const { return rpc_max_message_mb_; }
+
+  /// Milliseconds between keepalive pings on idle connections (default
+  /// 20000; 0 disables them).
+  int getRpcKeepaliveMs() const { return rpc_keepalive_ms_; }
+
+  /// Mempool depth at which gossip is refused; clients are refused from
+  /// 80% of it (default 200000; 0 means no limit).
+  int getMaxMempool() const { return max_mempool_; }
+
+  /// Client audits per second the node accepts (default 0: no limit).
+  int getMaxIngestRate() const { return max_ingest_rate_; }
+
+  /// Audits per second per client key (default 0: no limit).
+  int getClientRate() const { return client_rate_; }
+
+  /// Audits a client may send at once above its rate (default 0: one
+  /// second's worth).
+  int getClientBurst() const { return client_burst_; }
+
+  /// batch_mode "adaptive": BlockScheduler tunes block size and interval
+  /// from the observed load (BatchTuner) instead of using batch_size and
+  /// batch_interval_s. Default "fixed".
+  bool getAdaptiveBatching() const { return adaptive_batching_; }
+
+  /// Bounds on the adaptive block size (default 1 to 10000 audits).
+  int getBatchMin() const { return batch_min_; }
+  int getBatchMax() const { return batch_max_; }
+
+  /// Bounds on the adaptive block interval, in milliseconds (default 10
+  /// to batch_interval_s).
+  int getBatchIntervalMinMs() const { return batch_interval_min_ms_; }
+  int getBatchIntervalMaxMs() const { return batch_interval_max_ms_; }
+
+  /// Adaptive mode's target from an audit's arrival to its block's commit
+  /// (default 250 ms).
+  int getTargetCommitMs() const { return target_commit_ms_; }
+
+  /// proposal_mode "compact" (default): ProposeBlock sends req_ids and
+  /// CommitBlock only the id and hash (compact_block.h). "full" sends the
+  /// whole block both times.
+  bool getCompactProposals() const { return compact_proposals_; }
+
+  /// Store and gossip audits with their key's key_id instead of the PEM,
+  /// using the node's KeyRegistry (keys.dat). Default true.
+  bool getInternKeys() const { return intern_keys_; }
+
+  /// Seconds a sealed block segment goes unwritten before it is compressed
+  /// into an archive (default 86400; 0 disables archiving).
+  int getArchiveAfterSec() const { return archive_after_s_; }
+
 private:
   std::string leader_addr_;
   int         batch_size_;
   int         batch_interval_s_;
+  StorageFormat storage_format_ = StorageFormat::kBinary;
+  int         quorum_ = 0;
+  int         pipeline_depth_ = 2;
+  int         snapshot_interval_s_ = 60;
+  int         heartbeat_interval_ms_ = 10000;
+  int         heartbeat_timeout_ms_ = 15000;
+  int         election_interval_ms_ = 2000;
+  int         election_initial_delay_ms_ = 30000;
+  int         election_rpc_timeout_ms_ = 1000;
+  int         metrics_port_ = 0;
+  LogLevel    log_level_ = LogLevel::kInfo;
+  int         rpc_control_threads_ = 1;
+  int         rpc_consensus_threads_ = 2;
+  int         rpc_ingest_threads_ = 2;
+  int         rpc_sync_threads_ = 8;
+  int         rpc_queue_limit_ = 64;
+  int         rpc_max_message_mb_ = 16;
+  int         rpc_keepalive_ms_ = 20000;
+  int         max_mempool_ = 200000;
+  int         max_ingest_rate_ = 0;
+  int         client_rate_ = 0;
+  int         client_burst_ = 0;
+  bool        adaptive_batching_ = false;
+  int         batch_min_ = 1;
+  int         batch_max_ = 10000;
+  int         batch_interval_min_ms_ = 10;
+  int         batch_interval_max_ms_ = 0;   // 0: batch_interval_s
+  int         target_commit_ms_ = 250;
+  bool        compact_proposals_ = true;
+  bool        intern_keys_ = true;
+  int         archive_after_s_ = 86400;
 };
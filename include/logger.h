@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+enum class LogLevel : int { kDebug = 0, kInfo = 1, kWarn = 2, kError = 3 };
+
+// Lines below this level are compiled out (0 = debug ... 3 = error); set
+// with -DAUDIT_LOG_MIN_LEVEL=<n>
+#ifndef AUDIT_LOG_MIN_LEVEL
+#define AUDIT_LOG_MIN_LEVEL 1
+#endif
+inline constexpr LogLevel kMinLogLevel =
+  static_cast<LogLevel>(AUDIT_LOG_MIN_LEVEL);
+
+/// Parses "debug", "info", "warn" or "error"; false for anything else.
+bool ParseLogLevel(const std::string& name, LogLevel* out);
+
+/// Asynchronous line logger.
+///
+/// Writers format a line on their own thread and push it into a bounded
+/// lock-free ring; one background thread drains the ring into the sink,
+/// so request threads never wait on stdout. Debug and info lines go to
+/// stdout, warnings and errors to stderr. When the ring is full the line
+/// is dropped and counted instead of blocking; the count is reported with
+/// the next line written.
+///
+/// Use the LOG_* macros below rather than calling Write() directly.
+class Logger {
+public:
+  using Sink = std::function<void(LogLevel, const std::string&)>;
+
+  struct Options {
+    size_t capacity = 8192;   // lines buffered (rounded up to a power of 2)
+    Sink   sink;              // default: stdout/stderr
+  };
+
+  Logger();
+  explicit Logger(Options opts);
+  ~Logger();   // writes what is still queued
+
+  Logger(const Logger&) = delete;
+  Logger& operator=(const Logger&) = delete;
+
+  static Logger& Shared();
+
+  /// Runtime threshold on top of AUDIT_LOG_MIN_LEVEL (default info).
+  void SetLevel(LogLevel level) { level_.store(level, std::memory_order_relaxed); }
+  bool Enabled(LogLevel level) const {
+    return level >= level_.load(std::memory_order_relaxed);
+  }
+
+  /// Queue one line (without the trailing newline); never blocks.
+  void Write(LogLevel level, std::string line);
+
+  /// Block until every line queued before the call has been written.
+  void Flush();
+
+  /// Lines dropped because the ring was full.
+  uint64_t Dropped() const { return dropped_.load(); }
+
+private:
+  struct Slot {
+    std::atomic<uint64_t> seq;
+    LogLevel              level;
+    std::string           line;
+  };
+
+  void drainLoop();
+  /// Write everything queued; returns the number of lines (drain thread).
+  size_t drain();
+
+  Options                  opts_;
+  std::atomic<LogLevel>    level_{LogLevel::kInfo};
+  std::unique_ptr<Slot[]>  slots_;
+  uint64_t                 mask_;
+  std::atomic<uint64_t>    tail_{0};       // next slot to claim
+  uint64_t                 head_ = 0;      // next slot to drain
+  std::atomic<uint64_t>    written_{0};    // lines drained so far
+  std::atomic<uint64_t>    dropped_{0};
+  uint64_t                 reported_ = 0;  // drops already reported
+
+  std::mutex               mu_;
+  std::condition_variable  cv_;            // wakes the drain thread
+  std::condition_variable  flushed_cv_;
+  std::atomic<bool>        idle_{false};   // drain thread is waiting
+  std::atomic<bool>        stopping_{false};
+  std::thread              thr_;
+};
+
+/// One log line, queued when the temporary goes out of scope.
+class LogLine {
+public:
+  LogLine(Logger& logger, LogLevel level, const char* tag,
+          uint64_t suppressed = 0);
+  ~LogLine();
+
+  template <typename T>
+  LogLine& operator<<(const T& v) {
+    os_ << v;
+    return *this;
+  }
+
+private:
+  Logger&            logger_;
+  LogLevel           level_;
+  uint64_t           suppressed_;
+  std::ostringstream os_;
+};
+
+/// Lets one line through per interval; for messages that can repeat on
+/// every request (e.g. a peer that is down).
+class LogRateLimit {
+public:
+  explicit LogRateLimit(std::chrono::milliseconds every) : every_(every) {}
+
+  /// True if a line may be written now; `*suppressed` is set to the number
+  /// of lines held back since the last one.
+  bool Allow(uint64_t* suppressed);
+
+private:
+  std::chrono::milliseconds every_;
+  std::atomic<int64_t>      next_ns_{0};
+  std::atomic<uint64_t>     suppressed_{0};
+};
+
+// LOG_INFO("Tag") << "text " << value;  prints "[Tag] text <value>".
+// The operands are not evaluated when the level is disabled.
+#define AUDIT_LOG(level, tag)                                              \
+  if (!((level) >= kMinLogLevel && Logger::Shared().Enabled(level))) {}   \
+  else LogLine(Logger::Shared(), (level), (tag))
+
+#define LOG_DEBUG(tag) AUDIT_LOG(LogLevel::kDebug, tag)
+#define LOG_INFO(tag)  AUDIT_LOG(LogLevel::kInfo,  tag)
+#define LOG_WARN(tag)  AUDIT_LOG(LogLevel::kWarn,  tag)
+#define LOG_ERROR(tag) AUDIT_LOG(LogLevel::kError, tag)
+
+// At most one line per `ms` from this call site; the next line that gets
+// through says how many were suppressed.
+#define LOG_EVERY_MS(level, tag, ms)                                       \
+  if (static LogRateLimit audit_log_limit_{std::chrono::milliseconds(ms)}; \
+      !((level) >= kMinLogLevel && Logger::Shared().Enabled(level))) {}   \
+  else if (uint64_t audit_log_skipped_ = 0;                                \
+           !audit_log_limit_.Allow(&audit_log_skipped_)) {}               \
+  else LogLine(Logger::Shared(), (level), (tag), audit_log_skipped_)
+
+#define LOG_WARN_EVERY_MS(tag, ms) LOG_EVERY_MS(LogLevel::kWarn, tag, ms)
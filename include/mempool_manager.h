@@ -1,28 +1,133 @@
 #pragma once
 
-#include "common.pb.h"     
+#include "common.pb.h"
+#include "key_registry.h"
+#include "storage_format.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <list>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
-#include <google/protobuf/util/json_util.h> 
+#include <google/protobuf/util/json_util.h>
 
-/// Thread-safe manager for the mempool file.
+/// A pending audit and its Merkle leaf hash (SHA-256 hex of the canonical
+/// payload), computed once when the audit enters the mempool.
+struct PendingAudit {
+  common::FileAudit audit;
+  std::string       leaf_hash;
+};
+
+/// Thread-safe in-memory mempool, indexed by req_id.
+///
+/// The file at `path` is an append-only write-ahead log: it is replayed
+/// once at construction, and afterwards only ever written to. Removals are
+/// logged as tombstone records; a background compactor rewrites the log
+/// (temp file + rename) once the share of dead records gets too high.
+///
+/// The log is written in `format`. Replay detects the on-disk format, and a
+/// log found in the other format is rewritten in `format` straight away.
+///
+/// With a KeyRegistry, log records name the audit's key by key_id instead
+/// of carrying the PEM; audits in memory always have their PEM.
 class MempoolManager {
 public:
-  /// Construct with the file path (e.g. "../mempool.dat").
-  explicit MempoolManager(std::string path);
+  /// Construct with the log path (e.g. "../mempool.dat") and replay it.
+  explicit MempoolManager(std::string path,
+                          StorageFormat format = StorageFormat::kBinary,
+                          std::shared_ptr<KeyRegistry> keys = nullptr);
 
-  /// Append one audit (writes “req_id,file_id\n”) under lock.
-  void Append(const common::FileAudit& audit);
+  /// Stops the compactor thread.
+  ~MempoolManager();
 
-  /// Load *all* previously appended audits from disk.
-  /// If the file doesn’t exist or is empty, returns an empty vector.
+  /// Append one audit (one log record) under lock. `leaf_hash` may be
+  /// passed in if the caller already has it; otherwise it is computed.
+  /// Returns false if an audit with the same req_id is already pending.
+  bool Append(const common::FileAudit& audit, std::string leaf_hash = {});
+
+  /// Snapshot of all pending audits, in arrival order.
   std::vector<common::FileAudit> LoadAll() const;
 
-  /// Remove every audit whose req_id is in `ids`, rewriting the file.
+  /// Same snapshot, with each audit's cached leaf hash.
+  std::vector<PendingAudit> LoadPending() const;
+
+  /// The pending audits with the given req_ids, in the same order (one
+  /// lock for all of them). An id that is not pending gets an entry with
+  /// an empty leaf_hash.
+  std::vector<PendingAudit> Find(const std::vector<std::string>& ids) const;
+
+  /// Number of pending audits (O(1), does not take the lock).
+  size_t Size() const { return size_.load(std::memory_order_relaxed); }
+
+  /// Audits Append() has accepted since construction (O(1)); its rate of
+  /// change is the ingest rate.
+  uint64_t Appended() const {
+    return appended_.load(std::memory_order_relaxed);
+  }
+
+  /// Remove every audit whose req_id is in `ids` (one tombstone each).
   void RemoveBatch(const std::vector<std::string>& ids);
 
+  /// Block until at least `n` audits are pending, `deadline` passes, or
+  /// `cancelled()` returns true (re-checked on WakeWaiters()). Returns true
+  /// if `n` audits are pending. Append() only signals when the waited-for
+  /// threshold is reached, so a waiter wakes once per batch, not per audit.
+  bool WaitForSize(size_t n, std::chrono::steady_clock::time_point deadline,
+                   const std::function<bool()>& cancelled = {});
+
+  /// Make WaitForSize() callers re-check their `cancelled` predicate.
+  void WakeWaiters();
+
+  /// Rewrite the log now if the dead-record ratio is over the threshold.
+  /// Returns true if a compaction ran. Normally called by the compactor.
+  bool MaybeCompact();
+
 private:
+  using Entries = std::list<PendingAudit>;
+
+  void replayLog();
+  bool replayJson(std::istream& in);
+  bool replayBinary(std::istream& in);
+  void applyAudit(common::FileAudit a);
+  void applyTombstone(const std::string& req_id);
+  void compactorLoop();
+  bool needsCompaction() const;
+  bool compact(bool force);
+  std::string encodeAudit(const common::FileAudit& audit) const;
+  std::string encodeTombstone(const std::string& req_id) const;
+  void writeRecord(std::string record);
+
   mutable std::mutex mu_;
   std::string        path_;
+  StorageFormat      format_;
+  std::shared_ptr<KeyRegistry> keys_;   // may be null
+  std::ofstream      log_;
+
+  Entries                                          entries_;
+  std::unordered_map<std::string, Entries::iterator> index_;
+  std::atomic<size_t>                              size_{0};
+  std::atomic<uint64_t>                            appended_{0};
+
+  // Records currently in the log (live audits + dead audits + tombstones).
+  size_t                   records_ = 0;
+  // While a compaction is writing its snapshot, new records are mirrored
+  // here so they can be carried over into the rewritten log.
+  bool                     compacting_ = false;
+  std::vector<std::string> compact_tail_;
+
+  // WaitForSize(): pending count to signal at (SIZE_MAX when nobody waits)
+  std::condition_variable  size_cv_;
+  size_t                   wait_threshold_ = SIZE_MAX;
+
+  std::condition_variable  compact_cv_;
+  bool                     stopping_ = false;
+  std::thread              compactor_;
 };
@@ -1,4 +1,7 @@
 #pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <google/protobuf/message.h>
@@ -13,4 +16,60 @@ std::string DeterministicSerialize(const google::protobuf::Message& msg);
 
 /// Given a list of leaf hashes (hex strings), build the Merkle tree
 /// (duplicating the last leaf if odd) and return the root (hex).
-std::string ComputeMerkleRoot(const std::vector<std::string>& leaf_hashes);
\ No newline at end of file
+std::string ComputeMerkleRoot(const std::vector<std::string>& leaf_hashes);
+
+/// Merkle tree over 32-byte SHA-256 digests, stored level by level in one
+/// flat array (leaves first, root last).
+///
+/// An odd node at the end of a level is paired with itself. In kHexCompat
+/// mode (the chain's format) a parent is SHA-256 of the two children's
+/// lowercase hex strings concatenated, exactly like ComputeMerkleRoot; in
+/// kBinary mode it is SHA-256 of the two raw 32-byte digests.
+class MerkleTree {
+public:
+  using Digest = std::array<uint8_t, 32>;
+
+  enum class Mode { kHexCompat, kBinary };
+
+  /// One step of an inclusion proof, from the leaf upwards.
+  struct ProofStep {
+    Digest sibling;
+    bool   sibling_is_left;   // sibling comes first in the parent's input
+  };
+
+  explicit MerkleTree(std::vector<Digest> leaves,
+                      Mode mode = Mode::kHexCompat);
+
+  /// Build from hex leaf hashes; returns false if one is not 64 hex chars.
+  static bool FromHex(const std::vector<std::string>& hex_leaves, Mode mode,
+                      MerkleTree* out);
+
+  size_t LeafCount() const { return leaf_count_; }
+  Mode   mode() const { return mode_; }
+
+  /// Root digest (all zero for an empty tree).
+  Digest Root() const;
+
+  /// Root as lowercase hex ("" for an empty tree).
+  std::string RootHex() const;
+
+  /// Sibling path for leaf `index` (empty if out of range or single leaf).
+  std::vector<ProofStep> GetProof(size_t index) const;
+
+  /// True if `leaf` hashed up along `proof` gives `root`.
+  static bool VerifyProof(const Digest& leaf,
+                          const std::vector<ProofStep>& proof,
+                          const Digest& root, Mode mode);
+
+  static std::string ToHex(const Digest& d);
+  static bool ParseHex(const std::string& hex, Digest* out);
+
+private:
+  MerkleTree() = default;
+  void build();
+
+  Mode                mode_ = Mode::kHexCompat;
+  size_t              leaf_count_ = 0;
+  std::vector<Digest> nodes_;           // every level, leaves first
+  std::vector<size_t> level_offsets_;   // start of each level in nodes_
+};
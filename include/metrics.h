@@ -0,0 +1,105 @@
+#pragma once
+
+#include "latency_histogram.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// Monotonic event count.
+class Counter {
+public:
+  void     Inc(uint64_t n = 1) { v_.fetch_add(n, std::memory_order_relaxed); }
+  uint64_t Value() const       { return v_.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<uint64_t> v_{0};
+};
+
+/// Value that goes up and down.
+class Gauge {
+public:
+  void    Set(int64_t v) { v_.store(v, std::memory_order_relaxed); }
+  void    Add(int64_t d) { v_.fetch_add(d, std::memory_order_relaxed); }
+  int64_t Value() const  { return v_.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<int64_t> v_{0};
+};
+
+/// Process-wide registry of named metrics, rendered in the Prometheus text
+/// format by MetricsServer.
+///
+/// Registration takes a lock and returns a reference that stays valid for
+/// the life of the process; hot paths look a metric up once (e.g. into a
+/// function-local static) and then only touch its atomics. Asking again
+/// for the same name and labels returns the same metric. Histograms are
+/// LatencyHistograms and are exported in seconds.
+class MetricsRegistry {
+public:
+  using Labels = std::vector<std::pair<std::string, std::string>>;
+
+  static MetricsRegistry& Shared();
+
+  Counter& GetCounter(const std::string& name, const std::string& help,
+                      const Labels& labels = {});
+  Gauge& GetGauge(const std::string& name, const std::string& help,
+                  const Labels& labels = {});
+  LatencyHistogram& GetHistogram(const std::string& name,
+                                 const std::string& help,
+                                 const Labels& labels = {});
+
+  /// Gauge whose value is read from `fn` at scrape time (e.g. a queue
+  /// length owned by another component). A later call replaces `fn`.
+  void SetGaugeFn(const std::string& name, const std::string& help,
+                  std::function<double()> fn, const Labels& labels = {});
+
+  /// Every metric in the Prometheus text exposition format (0.0.4).
+  std::string Render() const;
+
+private:
+  enum class Type { kCounter, kGauge, kHistogram };
+
+  struct Series {
+    std::unique_ptr<Counter>          counter;
+    std::unique_ptr<Gauge>            gauge;
+    std::unique_ptr<LatencyHistogram> histogram;
+    std::function<double()>           fn;
+  };
+  struct Family {
+    Type        type;
+    std::string help;
+    std::map<std::string, Series> series;   // by rendered label set
+  };
+
+  Series& series(const std::string& name, const std::string& help,
+                 Type type, const Labels& labels);
+
+  mutable std::mutex            mu_;
+  std::map<std::string, Family> families_;
+};
+
+/// Records the time from construction to destruction into a histogram.
+class ScopedLatency {
+public:
+  explicit ScopedLatency(LatencyHistogram& h)
+    : h_(h), start_(std::chrono::steady_clock::now()) {}
+  ~ScopedLatency() {
+    h_.Record(std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start_));
+  }
+
+  ScopedLatency(const ScopedLatency&) = delete;
+  ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+  LatencyHistogram&                     h_;
+  std::chrono::steady_clock::time_point start_;
+};
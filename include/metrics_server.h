@@ -0,0 +1,35 @@
+#pragma once
+
+#include "metrics.h"
+#include <atomic>
+#include <thread>
+
+/// Minimal HTTP server for Prometheus scrapes: GET /metrics returns
+/// MetricsRegistry::Render(), anything else is a 404.
+///
+/// One thread serves one connection at a time, which is plenty for a
+/// scraper every few seconds. Connections are closed after each reply.
+class MetricsServer {
+public:
+  MetricsServer(int port, MetricsRegistry& registry);
+  ~MetricsServer();
+
+  MetricsServer(const MetricsServer&) = delete;
+  MetricsServer& operator=(const MetricsServer&) = delete;
+
+  /// Bind 0.0.0.0:<port> and start serving; false if the port is taken.
+  bool start();
+
+  /// Stop serving and close the socket.
+  void stop();
+
+private:
+  void loop();
+  void serve(int fd);
+
+  int                port_;
+  MetricsRegistry&   registry_;
+  int                listen_fd_ = -1;
+  std::atomic<bool>  running_{false};
+  std::thread        thr_;
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "admission_control.h"
+#include "audit_index.h"
+#include "block_cache.h"
+#include "block_scheduler.h"
+#include "block_store.h"
+#include "chain_manager.h"
+#include "election_manager.h"
+#include "election_state.h"
+#include "heartbeat_manager.h"
+#include "heartbeat_table.h"
+#include "key_registry.h"
+#include "leader_config.h"
+#include "mempool_manager.h"
+#include "metrics.h"
+#include "metrics_server.h"
+#include "rpc_lanes.h"
+#include "server.h"
+#include "snapshot_manager.h"
+
+#include <grpcpp/grpcpp.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// One audit node: storage, gRPC services, block scheduler, heartbeats and
+/// elections wired together.
+///
+/// main() runs a single node; the cluster benchmark runs several in one
+/// process, each with its own port and data directory.
+class Node {
+public:
+  struct Options {
+    std::string              addr;               // host:port to serve on
+    std::vector<std::string> peers;              // the other members
+    std::string              data_dir = "..";    // mempool.dat, chain.json, blocks/, snapshot.dat
+  };
+
+  /// Opens (and recovers) the node's storage; a fresh node bootstraps from
+  /// a peer's snapshot. Nothing is served until start().
+  Node(Options opts, const LeaderConfig& cfg);
+  ~Node();
+
+  Node(const Node&) = delete;
+  Node& operator=(const Node&) = delete;
+
+  /// Serve on addr and start the background threads; false if the port
+  /// could not be bound.
+  bool start();
+
+  /// Block until the server shuts down.
+  void wait();
+
+  /// Stop the background threads, then the server (idempotent).
+  void stop();
+
+  /// Export this node's queue and cache sizes as gauges (one node per
+  /// registry: the gauges are not labelled).
+  void exportGauges(MetricsRegistry& metrics);
+
+  const std::string& addr() const { return opts_.addr; }
+  bool isLeader() const { return election_state_.isLeader(); }
+
+  ChainManager&   chain()   { return chain_; }
+  MempoolManager& mempool() { return *mempool_; }
+  BlockStore&     blocks()  { return *blocks_; }
+
+private:
+  std::string path(const std::string& name) const;
+
+  Options                                opts_;
+  LeaderConfig                           cfg_;
+  std::shared_ptr<KeyRegistry>           keys_;      // null: keys inline
+  std::shared_ptr<MempoolManager>        mempool_;
+  ChainManager                           chain_;
+  std::shared_ptr<BlockStore>            blocks_;
+  std::shared_ptr<SnapshotManager>       snapshots_;
+  std::shared_ptr<HeartbeatTable>        hb_table_;
+  ElectionState                          election_state_;
+  std::shared_ptr<BlockCache>            block_cache_;
+  std::shared_ptr<AuditIndex>            audit_index_;
+  std::shared_ptr<VerifiedAuditSet>      verified_;
+  std::shared_ptr<AdmissionControl>      admission_;
+
+  // Created by start(); the services outlive the server that uses them
+  std::unique_ptr<FileAuditServiceImpl>  file_svc_;
+  std::unique_ptr<BlockChainServiceImpl> block_svc_;
+  std::unique_ptr<RpcLane>               control_lane_;
+  std::unique_ptr<RpcLane>               consensus_lane_;
+  std::unique_ptr<RpcLane>               ingest_lane_;
+  std::unique_ptr<grpc::Server>          server_;
+  std::unique_ptr<MetricsServer>         metrics_server_;
+  std::unique_ptr<BlockScheduler>        scheduler_;
+  std::unique_ptr<HeartbeatManager>      hb_mgr_;
+  std::unique_ptr<ElectionManager>       election_mgr_;
+  bool                                   stopped_ = false;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <grpcpp/grpcpp.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace fanout_detail {
+
+// Vote count for one fan-out round, shared with its callbacks.
+struct Tally {
+  std::mutex              mu;
+  std::condition_variable cv;
+  size_t                  acks  = 0;
+  size_t                  nacks = 0;
+};
+
+// One outstanding RPC; kept alive by its completion callback.
+template <typename Response>
+struct PeerCall {
+  grpc::ClientContext                   ctx;
+  Response                              resp;
+  std::chrono::steady_clock::time_point start;
+};
+
+}  // namespace fanout_detail
+
+/// Start `issue(i, ctx, resp, done)` towards every peer at once, each with
+/// a deadline of `timeout`, and block until `needed` replies pass
+/// `accept(i, status, resp, latency)`, or until too many have failed for
+/// that to happen. Returns whether `needed` were accepted; `needed` = 0
+/// returns at once (fire and forget).
+///
+/// Replies arriving after the decision are still handed to `accept` (for
+/// logging and latency stats), so `issue` and `accept` must not capture
+/// anything that dies with the caller's frame: requests go in shared_ptrs
+/// held by the `done` callback.
+template <typename Response, typename Issue, typename Accept>
+bool FanOut(size_t peers, size_t needed, std::chrono::milliseconds timeout,
+            Issue issue, Accept accept) {
+  using namespace std::chrono;
+  auto tally = std::make_shared<fanout_detail::Tally>();
+  for (size_t i = 0; i < peers; ++i) {
+    auto call = std::make_shared<fanout_detail::PeerCall<Response>>();
+    call->ctx.set_deadline(system_clock::now() + timeout);
+    call->start = steady_clock::now();
+    issue(i, &call->ctx, &call->resp,
+      [i, call, tally, accept](grpc::Status status) {
+        auto latency = duration_cast<microseconds>(
+          steady_clock::now() - call->start);
+        bool ok = accept(i, status, call->resp, latency);
+        {
+          std::lock_guard<std::mutex> lk(tally->mu);
+          ++(ok ? tally->acks : tally->nacks);
+        }
+        tally->cv.notify_all();
+      });
+  }
+
+  std::unique_lock<std::mutex> lk(tally->mu);
+  tally->cv.wait(lk, [&]{
+    return tally->acks >= needed || peers - tally->nacks < needed;
+  });
+  return tally->acks >= needed;
+}
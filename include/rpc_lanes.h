@@ -0,0 +1,141 @@
+#pragma once
+
+#include <grpcpp/grpcpp.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// A server completion queue of its own plus the threads that serve it.
+///
+/// serve() moves a unary method onto the lane: the service must derive
+/// from the generated WithAsyncMethod_<Method> for it, and its existing
+/// synchronous handler then runs on the lane's threads instead of gRPC's
+/// shared sync pool. Calls on one lane never wait for threads that are
+/// busy with another lane's traffic.
+///
+/// Per method, queue_limit calls are accepted ahead of the threads; more
+/// calls wait inside gRPC until one of those is picked up.
+///
+/// As on the sync path, a handler that throws fails its call with UNKNOWN
+/// instead of taking the lane (and the process) down.
+class RpcLane {
+public:
+  struct Options {
+    std::string name;               // for logs
+    int         threads     = 1;
+    int         queue_limit = 64;   // accepted, not yet handled, per method
+  };
+
+  /// Adds the lane's completion queue to `builder` (before BuildAndStart).
+  RpcLane(grpc::ServerBuilder& builder, Options opts);
+  ~RpcLane();
+
+  RpcLane(const RpcLane&) = delete;
+  RpcLane& operator=(const RpcLane&) = delete;
+
+  /// Serve calls requested with `request` by `handle`; call before start():
+  ///   lane.serve(svc, &Impl::RequestSendHeartbeat, &Impl::SendHeartbeat);
+  template <class Svc, class A, class B, class Req, class Resp>
+  void serve(Svc* svc,
+             void (A::*request)(grpc::ServerContext*, Req*,
+                                grpc::ServerAsyncResponseWriter<Resp>*,
+                                grpc::CompletionQueue*,
+                                grpc::ServerCompletionQueue*, void*),
+             grpc::Status (B::*handle)(grpc::ServerContext*, const Req*,
+                                       Resp*));
+
+  /// Accept the first calls and start the threads (after BuildAndStart).
+  void start();
+
+  /// Stop the threads (idempotent). The server must be shut down first.
+  void stop();
+
+  const std::string& name() const { return opts_.name; }
+
+private:
+  /// A call in progress; its address is the completion-queue tag.
+  class Call {
+  public:
+    virtual ~Call() = default;
+    virtual void proceed(bool ok) = 0;
+  };
+  template <class Req, class Resp> class UnaryCall;
+
+  /// Request the next call of method `m` (unless shutting down).
+  void arm(size_t m);
+  /// Log a handler exception; returns the status to fail the call with.
+  grpc::Status handlerThrew(const char* what) const;
+  void loop();
+
+  Options                                       opts_;
+  std::unique_ptr<grpc::ServerCompletionQueue>  cq_;
+  std::vector<std::function<void()>>            request_next_;   // by method
+  std::mutex                                    mu_;             // shutdown_ vs arm()
+  bool                                          shutdown_ = false;
+  std::vector<std::thread>                      threads_;
+};
+
+template <class Req, class Resp>
+class RpcLane::UnaryCall final : public RpcLane::Call {
+public:
+  using Handle =
+    std::function<grpc::Status(grpc::ServerContext*, const Req*, Resp*)>;
+
+  UnaryCall(RpcLane* lane, size_t method, const Handle* handle)
+    : writer_(&ctx_), lane_(lane), method_(method), handle_(handle) {}
+
+  // Filled in by the service's Request<Method>()
+  grpc::ServerContext                   ctx_;
+  Req                                   req_;
+  grpc::ServerAsyncResponseWriter<Resp> writer_;
+
+  void proceed(bool ok) override {
+    if (!ok || finishing_) {   // server shutting down, or call done
+      delete this;
+      return;
+    }
+    lane_->arm(method_);       // keep queue_limit slots open
+    grpc::Status status;
+    try {
+      status = (*handle_)(&ctx_, &req_, &resp_);
+    } catch (const std::exception& e) {
+      status = lane_->handlerThrew(e.what());
+    } catch (...) {
+      status = lane_->handlerThrew("unknown exception");
+    }
+    finishing_ = true;
+    writer_.Finish(resp_, status, this);
+  }
+
+private:
+  RpcLane*      lane_;
+  size_t        method_;
+  const Handle* handle_;
+  Resp          resp_;
+  bool          finishing_ = false;
+};
+
+template <class Svc, class A, class B, class Req, class Resp>
+void RpcLane::serve(
+    Svc* svc,
+    void (A::*request)(grpc::ServerContext*, Req*,
+                       grpc::ServerAsyncResponseWriter<Resp>*,
+                       grpc::CompletionQueue*,
+                       grpc::ServerCompletionQueue*, void*),
+    grpc::Status (B::*handle)(grpc::ServerContext*, const Req*, Resp*)) {
+  using Unary = UnaryCall<Req, Resp>;
+  auto fn = std::make_shared<typename Unary::Handle>(
+    [svc, handle](grpc::ServerContext* ctx, const Req* req, Resp* resp) {
+      return (svc->*handle)(ctx, req, resp);
+    });
+  size_t m = request_next_.size();
+  request_next_.push_back([this, svc, request, fn, m] {
+    auto* call = new Unary(this, m, fn.get());
+    (svc->*request)(&call->ctx_, &call->req_, &call->writer_,
+                    cq_.get(), cq_.get(), call);
+  });
+}
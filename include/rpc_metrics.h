@@ -0,0 +1,42 @@
+#pragma once
+
+#include "metrics.h"
+#include <grpcpp/support/server_interceptor.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+/// Server interceptor that times every RPC of every registered service.
+///
+/// Per method it keeps a latency histogram, rpc_server_handling_seconds,
+/// and per status code a counter, rpc_server_handled_total; the time runs
+/// from the call's start until its status is sent. Install it with
+/// ServerBuilder::experimental().SetInterceptorCreators().
+class RpcMetricsInterceptorFactory
+  : public grpc::experimental::ServerInterceptorFactoryInterface {
+public:
+  explicit RpcMetricsInterceptorFactory(MetricsRegistry& registry);
+
+  grpc::experimental::Interceptor* CreateServerInterceptor(
+      grpc::experimental::ServerRpcInfo* info) override;
+
+  /// Metrics of one method, created on its first call.
+  struct Method {
+    std::string                          name;
+    LatencyHistogram*                    latency = nullptr;
+    std::array<std::atomic<Counter*>, 17> by_code{};   // grpc::StatusCode
+  };
+
+  /// Count one finished call with status `code`.
+  void Handled(Method& m, grpc::StatusCode code);
+
+private:
+  Method& method(const char* full_name);
+
+  MetricsRegistry&                                         registry_;
+  std::shared_mutex                                        mu_;
+  std::unordered_map<std::string, std::unique_ptr<Method>> methods_;
+};
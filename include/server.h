@@ -6,48 +6,120 @@
 #include "mempool_manager.h"
 #include "chain_manager.h"
 #include "heartbeat_table.h"
+#include "key_registry.h"
+#include "admission_control.h"
+#include "audit_index.h"
 #include "election_state.h"
+#include "block_cache.h"
+#include "block_store.h"
+#include "gossip_pipeline.h"
+#include "snapshot_manager.h"
+#include "verification_pool.h"
 #include <grpcpp/grpcpp.h>
+#include <atomic>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
-/// Handles client submissions and gossips them out.
+/// Handles client submissions and gossips them out (in the background).
+///
+/// SubmitAudit is async so it can be served on the ingest RpcLane;
+/// SubmitAudits streams stay on the sync pool.
 class FileAuditServiceImpl final
-    : public fileaudit::FileAuditService::Service {
+    : public fileaudit::FileAuditService::WithAsyncMethod_SubmitAudit<
+        fileaudit::FileAuditService::Service> {
 public:
   FileAuditServiceImpl(
     const std::vector<std::string>& peers,
-    std::shared_ptr<MempoolManager> mempool);
+    std::shared_ptr<MempoolManager> mempool,
+    std::shared_ptr<VerifiedAuditSet> verified,
+    std::shared_ptr<AdmissionControl> admission = nullptr,
+    std::shared_ptr<KeyRegistry> keys = nullptr);
 
   std::vector<std::unique_ptr<blockchain::BlockChainService::Stub>>& getGossipStubs();
 
+  /// Audits queued for gossip, over all peers.
+  size_t gossipPending() const { return gossip_->Pending(); }
+
   // Note: response is in the fileaudit namespace now
   grpc::Status SubmitAudit(
       grpc::ServerContext* context,
       const common::FileAudit* request,
       fileaudit::FileAuditResponse* response) override;
 
+  /// Stream of audits in, one ack per audit out (same order).
+  grpc::Status SubmitAudits(
+      grpc::ServerContext* context,
+      grpc::ServerReaderWriter<fileaudit::FileAuditResponse,
+                               common::FileAudit>* stream) override;
+
 private:
+  /// OK, INVALID_ARGUMENT (bad signature), FAILED_PRECONDITION (unknown
+  /// key_id) or RESOURCE_EXHAUSTED (refused by admission control;
+  /// `refused` then says why).
+  grpc::StatusCode ingest(const common::FileAudit& audit,
+                          fileaudit::FileAuditResponse* response,
+                          AdmissionControl::Decision* refused = nullptr);
+
   std::vector<std::unique_ptr<blockchain::BlockChainService::Stub>> gossip_stubs_;
   std::shared_ptr<MempoolManager> mempool_;
+  std::shared_ptr<VerifiedAuditSet> verified_;
+  std::shared_ptr<AdmissionControl> admission_;   // may be null
+  std::shared_ptr<KeyRegistry> keys_;             // may be null
+  std::unique_ptr<GossipPipeline> gossip_;   // after the stubs it uses
 };
 
+/// The generated service with the RpcLane methods made async: heartbeats
+/// and votes (control lane), proposals and commits (consensus lane) and
+/// gossip (ingest lane). The streams and queries stay on the sync pool.
+using BlockChainServiceBase =
+  blockchain::BlockChainService::WithAsyncMethod_SendHeartbeat<
+  blockchain::BlockChainService::WithAsyncMethod_TriggerElection<
+  blockchain::BlockChainService::WithAsyncMethod_NotifyLeadership<
+  blockchain::BlockChainService::WithAsyncMethod_ProposeBlock<
+  blockchain::BlockChainService::WithAsyncMethod_CommitBlock<
+  blockchain::BlockChainService::WithAsyncMethod_WhisperAuditRequest<
+  blockchain::BlockChainService::WithAsyncMethod_WhisperAuditBatch<
+  blockchain::BlockChainService::WithRawCallbackMethod_GetBlock<
+    blockchain::BlockChainService::Service>>>>>>>>;
+
 /// Handles incoming gossip & block proposals.
-class BlockChainServiceImpl final : public blockchain::BlockChainService::Service {
+///
+/// GetBlock is served on the callback API with raw wire bytes, so replies
+/// can come straight out of the BlockCache.
+///
+/// ProposeBlock and CommitBlock also take the compact forms from
+/// compact_block.h; a compact proposal this node votes for is kept until
+/// its commit arrives.
+class BlockChainServiceImpl final : public BlockChainServiceBase {
 public:
   BlockChainServiceImpl(
       std::shared_ptr<MempoolManager> mempool,
       ChainManager& chain,
       std::shared_ptr<HeartbeatTable> hb_table,
       ElectionState& election_state,
-      std::string self_addr);
+      std::string self_addr,
+      std::shared_ptr<BlockStore> blocks,
+      std::shared_ptr<VerifiedAuditSet> verified,
+      std::shared_ptr<SnapshotManager> snapshots = nullptr,
+      std::shared_ptr<BlockCache> cache = nullptr,
+      std::shared_ptr<AuditIndex> index = nullptr,
+      std::shared_ptr<AdmissionControl> admission = nullptr,
+      std::shared_ptr<KeyRegistry> keys = nullptr);
 
   grpc::Status WhisperAuditRequest(
       grpc::ServerContext* context,
       const common::FileAudit* request,
       blockchain::WhisperResponse* response) override;
 
+  grpc::Status WhisperAuditBatch(
+      grpc::ServerContext* context,
+      const blockchain::AuditBatch* request,
+      blockchain::WhisperBatchResponse* response) override;
+
   grpc::Status ProposeBlock(
       grpc::ServerContext* context,
       const blockchain::Block* request,
@@ -58,10 +130,37 @@ public:
       const blockchain::Block* request,
       blockchain::BlockCommitResponse* response) override;
 
-  grpc::Status GetBlock(
+  grpc::ServerUnaryReactor* GetBlock(
+      grpc::CallbackServerContext* context,
+      const grpc::ByteBuffer* request,
+      grpc::ByteBuffer* response) override;
+
+  grpc::Status GetBlocks(
+      grpc::ServerContext* context,
+      const blockchain::GetBlocksRequest* request,
+      grpc::ServerWriter<blockchain::Block>* writer) override;
+
+  grpc::Status GetSnapshot(
       grpc::ServerContext* context,
-      const blockchain::GetBlockRequest* request,
-      blockchain::GetBlockResponse* response) override;
+      const blockchain::GetSnapshotRequest* request,
+      grpc::ServerWriter<blockchain::SnapshotChunk>* writer) override;
+
+  grpc::Status GetAuditProof(
+      grpc::ServerContext* context,
+      const blockchain::AuditProofRequest* request,
+      blockchain::AuditProofResponse* response) override;
+
+  /// One page of committed audits matching the query (AuditIndex).
+  grpc::Status QueryAudits(
+      grpc::ServerContext* context,
+      const blockchain::AuditQuery* request,
+      blockchain::AuditQueryResponse* response) override;
+
+  /// Every committed audit matching the query, page by page.
+  grpc::Status StreamAudits(
+      grpc::ServerContext* context,
+      const blockchain::AuditQuery* request,
+      grpc::ServerWriter<blockchain::IndexedAudit>* writer) override;
 
   grpc::Status SendHeartbeat(
       grpc::ServerContext* context,
@@ -89,4 +188,24 @@ private:
   std::shared_ptr<HeartbeatTable> hb_table_;
   ElectionState&                  state_;
   std::string                     self_addr_;
+  std::shared_ptr<BlockStore>     blocks_;
+  std::shared_ptr<VerifiedAuditSet> verified_;   // shared with FileAuditServiceImpl
+  std::shared_ptr<SnapshotManager>  snapshots_;  // may be null
+  std::shared_ptr<BlockCache>       cache_;      // may be null
+  std::shared_ptr<AuditIndex>       index_;      // may be null
+  std::shared_ptr<AdmissionControl> admission_;  // may be null
+  std::shared_ptr<KeyRegistry>      keys_;       // may be null
+  std::atomic<uint64_t>             block_reads_{0};
+
+  // Compact proposals this node voted for, rebuilt in full, by block id
+  std::mutex                        proposals_mu_;
+  std::map<int64_t, std::shared_ptr<const blockchain::Block>> proposals_;
+
+  /// Serialized GetBlockResponse for block `id` (from the cache if possible).
+  BlockCache::Bytes blockReply(int64_t id);
+
+  /// Look up `hits` in the block store, reading each block once.
+  bool loadAudits(const std::vector<AuditIndex::Hit>& hits,
+                  const std::function<bool(blockchain::IndexedAudit&)>& emit,
+                  std::string* err) const;
 };
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <openssl/evp.h>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/// Decode standard (RFC 4648) Base64, ignoring line breaks.
+/// Returns false on any other character outside the alphabet.
+bool Base64Decode(const std::string& b64, std::string* out);
+
+/// Identity of a public key: SHA-256 hex of its PEM text. This is the
+/// key_id of an interned key (KeyRegistry).
+std::string KeyFingerprint(const std::string& pem);
+
+/// Bounded, thread-safe LRU cache of parsed PEM public keys.
+///
+/// Keys are looked up by KeyFingerprint(), so the handful of client keys
+/// that sign most audits are parsed once. Entries are shared_ptrs: a key
+/// evicted while another thread is verifying with it stays alive until
+/// that thread is done.
+class PublicKeyCache {
+public:
+  using Key = std::shared_ptr<EVP_PKEY>;
+
+  explicit PublicKeyCache(size_t capacity = 1024) : capacity_(capacity) {}
+
+  /// Parsed key for `pem`, or nullptr if it does not parse (not cached).
+  /// `key_id`, if given, must be KeyFingerprint(pem); it saves hashing
+  /// the PEM.
+  Key Get(const std::string& pem, const std::string& key_id = {});
+
+  size_t Size() const;
+
+  /// Process-wide cache used by VerifySignature().
+  static PublicKeyCache& Shared();
+
+private:
+  using Lru = std::list<std::pair<std::string, Key>>;   // front = newest
+
+  size_t                                        capacity_;
+  mutable std::mutex                            mu_;
+  Lru                                           lru_;
+  std::unordered_map<std::string, Lru::iterator> index_;
+};
+
+/// Verify a Base64 RSA/SHA-256 signature over `data` with a PEM public key.
+/// Uses the shared key cache and a per-thread digest context. `key_id`
+/// is as for PublicKeyCache::Get().
+bool VerifySignature(const std::string& data,
+                     const std::string& signature_b64,
+                     const std::string& pubkey_pem,
+                     const std::string& key_id = {});
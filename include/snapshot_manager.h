@@ -0,0 +1,81 @@
+#pragma once
+
+#include "block_chain.grpc.pb.h"   // blockchain::SnapshotChunk, BlockChainService
+#include "block_store.h"
+#include "chain_manager.h"
+#include "mempool_manager.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/// Periodic snapshots of chain metadata plus the mempool, for bootstrap.
+///
+/// Every `interval` (when the chain head has moved) the node writes every
+/// BlockMeta and the pending audits to `path` as length-delimited
+/// SnapshotChunk records (temp file + rename). Peers stream the latest
+/// file with GetSnapshot. A node that starts with an empty chain installs
+/// a peer's snapshot with Bootstrap() and then only syncs the blocks
+/// committed after it. Block bodies from before the snapshot are not
+/// downloaded, so such a node serves GetBlock from the snapshot on only.
+class SnapshotManager {
+public:
+  struct Options {
+    std::chrono::seconds interval{60};
+    size_t               chunk_items = 4096;   // headers or audits per chunk
+  };
+
+  SnapshotManager(std::string                     path,
+                  ChainManager&                   chain,
+                  std::shared_ptr<MempoolManager> mempool,
+                  std::shared_ptr<BlockStore>     blocks);
+  SnapshotManager(std::string                     path,
+                  ChainManager&                   chain,
+                  std::shared_ptr<MempoolManager> mempool,
+                  std::shared_ptr<BlockStore>     blocks,
+                  Options                         opts);
+
+  /// Stops the writer thread.
+  ~SnapshotManager();
+
+  /// Launches the periodic writer (no-op if the interval is zero).
+  void start();
+  void stop();
+
+  /// Write a snapshot now. Returns false on I/O error.
+  bool WriteNow();
+
+  /// Hand each chunk of the latest snapshot to `emit` until it returns
+  /// false. Returns false if there is no snapshot or it is unreadable.
+  bool ForEachChunk(
+    const std::function<bool(const blockchain::SnapshotChunk&)>& emit) const;
+
+  /// Fetch a snapshot from `stub` and install it into an empty `chain`
+  /// and `mempool`. Header links are checked and audit signatures are
+  /// verified before anything is installed.
+  static bool Bootstrap(blockchain::BlockChainService::Stub* stub,
+                        ChainManager& chain, MempoolManager& mempool,
+                        std::string* err);
+
+private:
+  void loop();
+
+  std::string                     path_;
+  ChainManager&                   chain_;
+  std::shared_ptr<MempoolManager> mempool_;
+  std::shared_ptr<BlockStore>     blocks_;
+  Options                         opts_;
+
+  std::mutex                      write_mu_;      // one writer at a time
+  int64_t                         written_id_ = -2;   // head of the last snapshot
+
+  std::mutex                      mu_;
+  std::condition_variable         cv_;
+  bool                            stopping_ = false;
+  std::thread                     thr_;
+};
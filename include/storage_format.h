@@ -0,0 +1,42 @@
+#pragma once
+
+#include "block_chain.pb.h"    // blockchain::Block
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+
+/// On-disk encoding for the mempool log and block files.
+///   kJson:   one MessageToJsonString document per record (debug/export).
+///   kBinary: length-prefixed, deterministically serialized protobuf.
+enum class StorageFormat { kJson, kBinary };
+
+/// "json" / "binary"; throws std::runtime_error on anything else.
+StorageFormat ParseStorageFormat(const std::string& name);
+
+/// Inverse of ParseStorageFormat.
+const char* StorageFormatName(StorageFormat format);
+
+/// Append `bytes` to `out` prefixed with its length as a varint32.
+void AppendDelimited(const std::string& bytes, std::string* out);
+
+/// Read one varint32 length-prefixed record. Returns false at a clean EOF
+/// or on a truncated record.
+bool ReadDelimited(std::istream& in, std::string* bytes);
+
+/// Durably move a fully written `tmp` over `path`: fsync `tmp`, rename it,
+/// then fsync the directory so the rename survives a crash. Returns false
+/// if any step fails; `tmp` is removed if it was not renamed.
+bool ReplaceFile(const std::string& tmp, const std::string& path);
+
+/// Write `blk` to `<dir>/block_<id>.json` or `<dir>/block_<id>.pb`.
+bool WriteBlockFile(const std::string& dir,
+                    const blockchain::Block& blk,
+                    StorageFormat format);
+
+/// Read block `id` from `dir`, whichever format it was stored in.
+/// On failure returns false and fills `err`.
+bool ReadBlockFile(const std::string& dir,
+                   int64_t id,
+                   blockchain::Block* blk,
+                   std::string* err);
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "common.grpc.pb.h"   // common::FileAudit
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/// Worker pool for checking many audit signatures at once.
+///
+/// VerifyAll() spreads a batch over the workers and the calling thread.
+/// After the first bad signature the remaining items are skipped, so a
+/// rejected block costs little more than the time to find the bad audit.
+class VerificationPool {
+public:
+  struct Item {
+    const std::string* payload;      // canonical JSON that was signed
+    const std::string* signature;    // Base64
+    const std::string* public_key;   // PEM
+    const std::string* key_id = nullptr;   // its fingerprint, if known
+  };
+
+  explicit VerificationPool(size_t threads);
+  ~VerificationPool();
+
+  VerificationPool(const VerificationPool&) = delete;
+  VerificationPool& operator=(const VerificationPool&) = delete;
+
+  /// Index of a failing item, or -1 if every signature verifies.
+  long VerifyAll(const std::vector<Item>& items);
+
+  /// Process-wide pool with one worker per core.
+  static VerificationPool& Shared();
+
+private:
+  struct Job {
+    const std::vector<Item>* items;   // valid until done == size
+    size_t                   size;
+    std::atomic<size_t>      next{0};
+    std::atomic<size_t>      done{0};
+    std::atomic<long>        failed{-1};
+    std::mutex               mu;
+    std::condition_variable  cv;
+  };
+
+  void workerLoop();
+  static void work(Job& job);
+
+  std::mutex                       mu_;
+  std::condition_variable          cv_;
+  std::deque<std::shared_ptr<Job>> jobs_;
+  bool                             stopping_ = false;
+  std::vector<std::thread>         workers_;
+};
+
+/// req_ids whose signatures this node has already checked.
+///
+/// Each entry remembers a digest of the signed payload, signature and key,
+/// so an audit is only skipped if it is byte-for-byte the one that was
+/// verified. Entries are dropped when their block commits; the oldest are
+/// evicted beyond `capacity`.
+class VerifiedAuditSet {
+public:
+  explicit VerifiedAuditSet(size_t capacity = 1 << 20) : capacity_(capacity) {}
+
+  /// Digest identifying one signed audit.
+  static std::string Digest(const std::string& payload,
+                            const common::FileAudit& audit);
+
+  bool Contains(const std::string& req_id, const std::string& digest) const;
+  void Add(const std::string& req_id, std::string digest);
+  void Remove(const std::vector<std::string>& req_ids);
+  size_t Size() const;
+
+private:
+  struct Entry {
+    std::string                      digest;
+    std::list<std::string>::iterator pos;   // in order_
+  };
+
+  size_t                                 capacity_;
+  mutable std::mutex                     mu_;
+  std::unordered_map<std::string, Entry> digests_;   // by req_id
+  std::list<std::string>                 order_;     // oldest first
+};
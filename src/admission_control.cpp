@@ -0,0 +1,170 @@
+// src/admission_control.cpp
+
+#include "admission_control.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+using Clock = TokenBucket::Clock;
+
+// A refused client is only sent to a peer this much less loaded (0-100).
+static constexpr int kRedirectMargin = 20;
+
+// -- TokenBucket --------------------------------------------------------------
+
+TokenBucket::TokenBucket(double rate, double burst, Clock::time_point now)
+  : rate_(rate), burst_(std::max(1.0, burst)), tokens_(burst_), last_(now) {}
+
+double TokenBucket::available(Clock::time_point now) const {
+  double secs = std::chrono::duration<double>(now - last_).count();
+  return std::min(burst_, tokens_ + std::max(0.0, secs) * rate_);
+}
+
+bool TokenBucket::Take(Clock::time_point now, std::chrono::milliseconds* wait) {
+  tokens_ = available(now);
+  last_   = now;
+  if (tokens_ >= 1.0) {
+    tokens_ -= 1.0;
+    return true;
+  }
+  *wait = std::chrono::milliseconds(
+    static_cast<int64_t>(std::ceil((1.0 - tokens_) / rate_ * 1000.0)));
+  return false;
+}
+
+double TokenBucket::Used(Clock::time_point now) const {
+  return 1.0 - available(now) / burst_;
+}
+
+// -- AdmissionControl ---------------------------------------------------------
+
+std::string AdmissionControl::Decision::message() const {
+  switch (reason) {
+    case Reason::kNone:        return "";
+    case Reason::kMempoolFull: return "mempool full";
+    case Reason::kIngestRate:  return "node ingest rate exceeded";
+    case Reason::kClientRate:  return "client rate limit exceeded";
+  }
+  return "";
+}
+
+AdmissionControl::AdmissionControl(Options opts,
+                                   std::shared_ptr<MempoolManager> mempool,
+                                   std::shared_ptr<HeartbeatTable> peers,
+                                   std::string self_addr)
+  : opts_(opts)
+  , mempool_(std::move(mempool))
+  , peers_(std::move(peers))
+  , self_addr_(std::move(self_addr))
+  , client_limit_(static_cast<size_t>(opts_.max_mempool * opts_.client_share))
+  , client_burst_(opts_.client_burst > 0 ? opts_.client_burst
+                                         : opts_.client_rate)
+{
+  if (opts_.max_ingest_rate > 0) {
+    ingest_.emplace(opts_.max_ingest_rate, opts_.max_ingest_rate,
+                    Clock::now());
+  }
+  auto& m = MetricsRegistry::Shared();
+  const char* help = "Audits refused by admission control";
+  refused_full_   = &m.GetCounter("admission_refused_total", help,
+                                  {{"reason", "mempool_full"}});
+  refused_rate_   = &m.GetCounter("admission_refused_total", help,
+                                  {{"reason", "ingest_rate"}});
+  refused_client_ = &m.GetCounter("admission_refused_total", help,
+                                  {{"reason", "client_rate"}});
+}
+
+AdmissionControl::Decision AdmissionControl::refuse(
+    Reason reason, std::chrono::milliseconds retry_after) {
+  switch (reason) {
+    case Reason::kMempoolFull: refused_full_->Inc();   break;
+    case Reason::kIngestRate:  refused_rate_->Inc();   break;
+    case Reason::kClientRate:  refused_client_->Inc(); break;
+    case Reason::kNone:                                 break;
+  }
+  Decision d;
+  d.reason      = reason;
+  d.retry_after = retry_after;
+  // Another client's budget is not ours to hand out
+  if (reason != Reason::kClientRate) d.redirect = LessLoadedPeer();
+  return d;
+}
+
+AdmissionControl::Decision AdmissionControl::AdmitClient() {
+  if (opts_.max_mempool > 0 && mempool_->Size() >= client_limit_) {
+    return refuse(Reason::kMempoolFull, opts_.full_retry);
+  }
+  if (ingest_) {
+    std::chrono::milliseconds wait{0};
+    std::unique_lock<std::mutex> lk(ingest_mu_);
+    if (!ingest_->Take(Clock::now(), &wait)) {
+      lk.unlock();
+      return refuse(Reason::kIngestRate, wait);
+    }
+  }
+  return {};
+}
+
+AdmissionControl::Decision AdmissionControl::AdmitFrom(
+    const common::FileAudit& audit) {
+  if (opts_.client_rate <= 0) return {};
+  uint64_t key = audit.public_key().empty()
+    ? std::hash<std::string>()("user:" + audit.user_info().user_id())
+    : std::hash<std::string>()(audit.public_key());
+  auto& shard = clients_[key % kShards];
+  auto now = Clock::now();
+  std::chrono::milliseconds wait{0};
+  {
+    std::lock_guard<std::mutex> lk(shard.mu);
+    auto it = shard.buckets.find(key);
+    if (it == shard.buckets.end()) {
+      if (shard.buckets.size() >= kClientsPerShard) {
+        // Forget clients whose buckets have refilled; they start full anyway
+        for (auto b = shard.buckets.begin(); b != shard.buckets.end();) {
+          b = b->second.Used(now) <= 0 ? shard.buckets.erase(b) : std::next(b);
+        }
+        if (shard.buckets.size() >= kClientsPerShard) {
+          shard.buckets.erase(shard.buckets.begin());
+        }
+      }
+      it = shard.buckets.emplace(
+        key, TokenBucket(opts_.client_rate, client_burst_, now)).first;
+    }
+    if (it->second.Take(now, &wait)) return {};
+  }
+  return refuse(Reason::kClientRate, wait);
+}
+
+AdmissionControl::Decision AdmissionControl::AdmitGossip(size_t n) {
+  if (opts_.max_mempool > 0 && mempool_->Size() + n > opts_.max_mempool) {
+    return refuse(Reason::kMempoolFull, opts_.full_retry);
+  }
+  return {};
+}
+
+int AdmissionControl::Pressure() const {
+  double p = 0;
+  if (opts_.max_mempool > 0) {
+    p = static_cast<double>(mempool_->Size()) /
+        std::max<size_t>(1, client_limit_);
+  }
+  if (ingest_) {
+    std::lock_guard<std::mutex> lk(ingest_mu_);
+    p = std::max(p, ingest_->Used(Clock::now()));
+  }
+  return static_cast<int>(std::clamp(p, 0.0, 1.0) * 100);
+}
+
+std::string AdmissionControl::LessLoadedPeer() const {
+  if (!peers_) return "";
+  int best = Pressure() - kRedirectMargin;
+  std::string addr;
+  for (auto& e : peers_->all()) {
+    if (!e.alive || e.from_address == self_addr_) continue;
+    if (e.pressure <= best) {
+      best = e.pressure;
+      addr = e.from_address;
+    }
+  }
+  return addr;
+}
@@ -0,0 +1,198 @@
+// src/audit_index.cpp
+
+#include "audit_index.h"
+#include "logger.h"
+#include <algorithm>
+
+namespace {
+
+constexpr uint32_t kAnyKey = std::numeric_limits<uint32_t>::max();
+
+// Floor division, so negative timestamps land in the right bucket.
+int64_t BucketOf(int64_t ts, int64_t width) {
+  int64_t b = ts / width;
+  if (ts % width < 0) --b;
+  return b;
+}
+
+}  // namespace
+
+AuditIndex::AuditIndex(ChainManager& chain, std::shared_ptr<BlockStore> blocks)
+  : AuditIndex(chain, std::move(blocks), Options{}) {}
+
+AuditIndex::AuditIndex(ChainManager& chain, std::shared_ptr<BlockStore> blocks,
+                       Options opts)
+  : chain_(chain)
+  , blocks_(std::move(blocks))
+  , opts_(opts)
+{
+  opts_.bucket_ms = std::max<int64_t>(1, opts_.bucket_ms);
+}
+
+void AuditIndex::AddBlock(const blockchain::Block& blk) {
+  std::unique_lock<std::shared_mutex> lk(mu_);
+  int64_t last = last_id_.load();
+  if (blk.id() <= last) return;
+  if (blk.id() > last + 1) catchUpLocked(blk.id() - 1);
+  addLocked(blk);
+}
+
+size_t AuditIndex::CatchUp() {
+  int64_t head = chain_.getLastID();
+  if (head <= last_id_.load()) return 0;
+  std::unique_lock<std::shared_mutex> lk(mu_);
+  return catchUpLocked(head);
+}
+
+size_t AuditIndex::catchUpLocked(int64_t through) {
+  size_t before = entries_.size();
+  blockchain::Block blk;
+  std::string err;
+  for (int64_t id = last_id_.load() + 1; id <= through; ++id) {
+    if (blocks_->Get(id, &blk, &err)) addLocked(blk);
+  }
+  if (through > last_id_.load()) last_id_ = through;
+  return entries_.size() - before;
+}
+
+uint32_t AuditIndex::intern(std::unordered_map<std::string, uint32_t>* ids,
+                            std::vector<Postings>* lists,
+                            const std::string& key)
+{
+  auto it = ids->find(key);
+  if (it != ids->end()) return it->second;
+  auto id = static_cast<uint32_t>(lists->size());
+  ids->emplace(key, id);
+  lists->emplace_back();
+  return id;
+}
+
+void AuditIndex::addLocked(const blockchain::Block& blk) {
+  for (int i = 0; i < blk.audits_size(); ++i) {
+    if (entries_.size() >= std::numeric_limits<Seq>::max()) {
+      LOG_WARN("AuditIndex") << "index full, block " << blk.id()
+                             << " is not indexed";
+      break;
+    }
+    const auto& a = blk.audits(i);
+    auto seq  = static_cast<Seq>(entries_.size());
+    auto file = intern(&file_ids_, &by_file_, a.file_info().file_id());
+    auto user = intern(&user_ids_, &by_user_, a.user_info().user_id());
+    entries_.push_back({blk.id(), a.timestamp(), static_cast<uint32_t>(i),
+                        file, user});
+    by_file_[file].push_back(seq);
+    by_user_[user].push_back(seq);
+    by_time_[BucketOf(a.timestamp(), opts_.bucket_ms)].push_back(seq);
+  }
+  last_id_ = blk.id();
+}
+
+std::vector<AuditIndex::Hit> AuditIndex::Find(const Query& q, uint64_t cursor,
+                                              size_t limit, uint64_t* next)
+{
+  *next = 0;
+  std::vector<Hit> hits;
+  if (limit == 0 || q.from_ts > q.to_ts) return hits;
+  if (chain_.getLastID() > last_id_.load()) CatchUp();
+
+  std::shared_lock<std::shared_mutex> lk(mu_);
+  if (cursor >= entries_.size()) return hits;
+  auto start = static_cast<Seq>(cursor);
+
+  // An unknown file or user matches nothing
+  uint32_t file = kAnyKey, user = kAnyKey;
+  if (!q.file_id.empty()) {
+    auto it = file_ids_.find(q.file_id);
+    if (it == file_ids_.end()) return hits;
+    file = it->second;
+  }
+  if (!q.user_id.empty()) {
+    auto it = user_ids_.find(q.user_id);
+    if (it == user_ids_.end()) return hits;
+    user = it->second;
+  }
+
+  // Collects matches; false once the page is full and the next is known
+  auto take = [&](Seq s) {
+    const Entry& e = entries_[s];
+    if ((file != kAnyKey && e.file != file) ||
+        (user != kAnyKey && e.user != user) ||
+        e.timestamp < q.from_ts || e.timestamp > q.to_ts) {
+      return true;
+    }
+    if (hits.size() == limit) {
+      *next = s;
+      return false;
+    }
+    hits.push_back({e.block_id, e.index});
+    return true;
+  };
+  auto scan = [&](const Postings& list) {
+    for (auto it = std::lower_bound(list.begin(), list.end(), start);
+         it != list.end() && take(*it); ++it) {}
+  };
+
+  // Drive the scan from the shortest candidate list
+  const Postings* list = nullptr;
+  size_t best = entries_.size() - start;
+  if (file != kAnyKey && by_file_[file].size() < best) {
+    list = &by_file_[file];
+    best = list->size();
+  }
+  if (user != kAnyKey && by_user_[user].size() < best) {
+    list = &by_user_[user];
+    best = list->size();
+  }
+
+  // Audits in the buckets the time range touches
+  auto lo = by_time_.lower_bound(BucketOf(q.from_ts, opts_.bucket_ms));
+  auto hi = by_time_.upper_bound(BucketOf(q.to_ts, opts_.bucket_ms));
+  size_t in_range = 0;
+  for (auto it = lo; it != hi && in_range < best; ++it) {
+    in_range += it->second.size();
+  }
+
+  if (in_range < best) {
+    // Merge the buckets in the range by sequence number
+    struct Cursor {
+      const Postings* list;
+      size_t          pos;
+    };
+    std::vector<Cursor> heap;
+    for (auto it = lo; it != hi; ++it) {
+      auto pos = std::lower_bound(it->second.begin(), it->second.end(), start);
+      // The bucket holding from_ts mostly starts with earlier audits
+      while (pos != it->second.end() && entries_[*pos].timestamp < q.from_ts) {
+        ++pos;
+      }
+      if (pos != it->second.end()) {
+        heap.push_back({&it->second,
+                        static_cast<size_t>(pos - it->second.begin())});
+      }
+    }
+    auto later = [](const Cursor& a, const Cursor& b) {
+      return (*a.list)[a.pos] > (*b.list)[b.pos];
+    };
+    std::make_heap(heap.begin(), heap.end(), later);
+    while (!heap.empty()) {
+      std::pop_heap(heap.begin(), heap.end(), later);
+      auto& c = heap.back();
+      if (!take((*c.list)[c.pos])) break;
+      if (++c.pos < c.list->size()) {
+        std::push_heap(heap.begin(), heap.end(), later);
+      } else {
+        heap.pop_back();
+      }
+    }
+  } else if (list) {
+    scan(*list);
+  } else {
+    for (Seq s = start; s < entries_.size() && take(s); ++s) {}
+  }
+  return hits;
+}
+
+size_t AuditIndex::Size() const {
+  std::shared_lock<std::shared_mutex> lk(mu_);
+  return entries_.size();
+}
@@ -0,0 +1,139 @@
+// src/batch_tuner.cpp
+
+#include "batch_tuner.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Starting guesses until real rounds come in: 5 ms a round plus 20 µs an
+// audit (one RSA check on each peer).
+static constexpr double kPriorFixed    = 0.005;
+static constexpr double kPriorPerAudit = 20e-6;
+// Time constant of the ingest rate average, in seconds.
+static constexpr double kRateTau = 1.0;
+// Blocks sized to keep up with ingest get this much slack.
+static constexpr double kKeepUpHeadroom = 1.25;
+
+BatchTuner::BatchTuner(Options opts)
+  : opts_(opts)
+  , fixed_(kPriorFixed)
+  , per_audit_(kPriorPerAudit)
+  , plan_{opts.min_batch, opts.max_interval}
+  , batch_gauge_(MetricsRegistry::Shared().GetGauge(
+      "batch_target_audits", "Audits at which the leader cuts a block"))
+  , interval_gauge_(MetricsRegistry::Shared().GetGauge(
+      "batch_target_interval_ms", "Longest wait before the leader cuts a block"))
+  , rate_gauge_(MetricsRegistry::Shared().GetGauge(
+      "batch_ingest_rate", "Audits per second entering the mempool"))
+  , fixed_gauge_(MetricsRegistry::Shared().GetGauge(
+      "batch_round_fixed_us", "Fitted per-block cost of a block round"))
+  , per_audit_gauge_(MetricsRegistry::Shared().GetGauge(
+      "batch_round_per_audit_ns", "Fitted per-audit cost of a block round"))
+{
+  opts_.min_batch = std::max<size_t>(1, opts_.min_batch);
+  opts_.max_batch = std::max(opts_.min_batch, opts_.max_batch);
+  opts_.max_interval = std::max(opts_.min_interval, opts_.max_interval);
+  opts_.window = std::max<size_t>(2, opts_.window);
+  std::lock_guard<std::mutex> lk(mu_);
+  replan();
+}
+
+void BatchTuner::ObserveIngest(uint64_t appended, Clock::time_point now) {
+  std::lock_guard<std::mutex> lk(mu_);
+  if (last_seen_ == Clock::time_point{}) {
+    last_seen_     = now;
+    last_appended_ = appended;
+    return;
+  }
+  double dt = std::chrono::duration<double>(now - last_seen_).count();
+  if (dt < 1e-3) return;
+  double sample = static_cast<double>(appended - last_appended_) / dt;
+  double alpha  = 1.0 - std::exp(-dt / kRateTau);
+  rate_ += alpha * (sample - rate_);
+  last_seen_     = now;
+  last_appended_ = appended;
+  replan();
+}
+
+void BatchTuner::ObserveRound(size_t audits, std::chrono::microseconds round) {
+  std::lock_guard<std::mutex> lk(mu_);
+  rounds_.push_back({static_cast<double>(audits), round.count() / 1e6});
+  if (rounds_.size() > opts_.window) rounds_.pop_front();
+  fit();
+  replan();
+}
+
+void BatchTuner::fit() {
+  const double k = static_cast<double>(rounds_.size());
+  double mean_n = 0, mean_t = 0;
+  for (auto& r : rounds_) {
+    mean_n += r.audits / k;
+    mean_t += r.secs / k;
+  }
+  double var = 0, cov = 0;
+  for (auto& r : rounds_) {
+    var += (r.audits - mean_n) * (r.audits - mean_n);
+    cov += (r.audits - mean_n) * (r.secs - mean_t);
+  }
+  // Blocks of (nearly) one size only pin down the total: keep the slope
+  if (var > 1e-9 && cov >= 0) per_audit_ = cov / var;
+  fixed_ = mean_t - per_audit_ * mean_n;
+  if (fixed_ < 0) {   // noise: put the whole cost on the audits instead
+    fixed_     = 0;
+    per_audit_ = mean_n > 0 ? mean_t / mean_n : per_audit_;
+  }
+  per_audit_ = std::max(per_audit_, 1e-7);
+}
+
+void BatchTuner::replan() {
+  using std::chrono::duration;
+  const double inf      = std::numeric_limits<double>::infinity();
+  const double target   = duration<double>(opts_.target_latency).count();
+  const double deadline = duration<double>(opts_.round_deadline).count();
+  const double rate     = std::max(rate_, 1e-3);
+
+  // Wait to fill n (n / rate) plus the round (fixed + per_audit * n)
+  double n_latency = (target - fixed_) / (1.0 / rate + per_audit_);
+  // Rounds must keep up with arrivals: n >= rate * round(n)
+  double n_keep_up = rate * per_audit_ < 1.0
+    ? kKeepUpHeadroom * rate * fixed_ / (1.0 - rate * per_audit_)
+    : inf;
+  double n_deadline = (deadline - fixed_) / per_audit_;
+
+  double n = std::min(std::max(n_latency, n_keep_up), n_deadline);
+  n = std::clamp(n, static_cast<double>(opts_.min_batch),
+                    static_cast<double>(opts_.max_batch));
+  plan_.batch = static_cast<size_t>(n);
+
+  // Cut after the time to fill it, or whatever is left of the target
+  double wait = std::min(n / rate, target - (fixed_ + per_audit_ * n));
+  auto interval = std::chrono::milliseconds(
+    static_cast<int64_t>(std::max(0.0, wait) * 1000.0));
+  plan_.interval = std::clamp(interval, opts_.min_interval, opts_.max_interval);
+
+  batch_gauge_.Set(static_cast<int64_t>(plan_.batch));
+  interval_gauge_.Set(plan_.interval.count());
+  rate_gauge_.Set(static_cast<int64_t>(rate_));
+  fixed_gauge_.Set(static_cast<int64_t>(fixed_ * 1e6));
+  per_audit_gauge_.Set(static_cast<int64_t>(per_audit_ * 1e9));
+}
+
+BatchTuner::Plan BatchTuner::Current() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  return plan_;
+}
+
+double BatchTuner::IngestRate() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  return rate_;
+}
+
+double BatchTuner::FixedCost() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  return fixed_;
+}
+
+double BatchTuner::PerAuditCost() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  return per_audit_;
+}
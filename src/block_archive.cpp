@@ -0,0 +1,220 @@
+// src/block_archive.cpp
+
+#include "block_archive.h"
+#include "logger.h"
+#include "storage_format.h"   // ReplaceFile
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#ifdef BLOCKSTORE_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+// Frame table entry: [u64 offset][u64 file offset][u32 length][u32 packed]
+static constexpr size_t kFrameEntry = 24;
+// Footer: [u32 frames][u32 codec][u64 segment bytes][u64 magic]
+static constexpr size_t kFooter = 24;
+static constexpr uint64_t kMagic = 0x31484352414b4c42ull;   // "BLKARCH1"
+
+static constexpr uint32_t kCodecZlib = 1;
+static constexpr uint32_t kCodecZstd = 2;
+static constexpr int kZlibLevel = 6;
+static constexpr int kZstdLevel = 9;
+
+#ifdef BLOCKSTORE_HAVE_ZSTD
+static constexpr uint32_t kCodec = kCodecZstd;
+#else
+static constexpr uint32_t kCodec = kCodecZlib;
+#endif
+
+template <typename T>
+static void Put(std::string* out, T v) {
+  out->append(reinterpret_cast<const char*>(&v), sizeof v);
+}
+
+template <typename T>
+static T Decode(const char*& p) { T v; std::memcpy(&v, p, sizeof v); p += sizeof v; return v; }
+
+static bool Compress(const char* src, size_t len, std::string* out) {
+#ifdef BLOCKSTORE_HAVE_ZSTD
+  out->resize(ZSTD_compressBound(len));
+  size_t n = ZSTD_compress(&(*out)[0], out->size(), src, len, kZstdLevel);
+  if (ZSTD_isError(n)) return false;
+#else
+  uLongf n = compressBound(static_cast<uLong>(len));
+  out->resize(n);
+  if (compress2(reinterpret_cast<Bytef*>(&(*out)[0]), &n,
+                reinterpret_cast<const Bytef*>(src), static_cast<uLong>(len),
+                kZlibLevel) != Z_OK) {
+    return false;
+  }
+#endif
+  out->resize(n);
+  return true;
+}
+
+// Inflate into `out`, which is already sized to the frame's length
+static bool Decompress(uint32_t codec, const char* src, size_t len,
+                       std::string* out) {
+  if (codec == kCodecZlib) {
+    uLongf n = static_cast<uLongf>(out->size());
+    return uncompress(reinterpret_cast<Bytef*>(&(*out)[0]), &n,
+                      reinterpret_cast<const Bytef*>(src),
+                      static_cast<uLong>(len)) == Z_OK &&
+           n == out->size();
+  }
+#ifdef BLOCKSTORE_HAVE_ZSTD
+  if (codec == kCodecZstd) {
+    size_t n = ZSTD_decompress(&(*out)[0], out->size(), src, len);
+    return !ZSTD_isError(n) && n == out->size();
+  }
+#endif
+  return false;
+}
+
+static bool WriteAll(int fd, const std::string& data) {
+  const char* p = data.data();
+  size_t left = data.size();
+  while (left > 0) {
+    ssize_t n = ::write(fd, p, left);
+    if (n <= 0) return false;
+    p += n;
+    left -= n;
+  }
+  return true;
+}
+
+bool BlockArchive::Write(const std::string& path, const std::string& segment,
+                         const std::vector<Span>& frames) {
+  std::string data, table, packed;
+  for (auto& f : frames) {
+    if (f.offset + f.length > segment.size() ||
+        !Compress(segment.data() + f.offset, f.length, &packed)) {
+      LOG_WARN("BlockArchive") << "cannot compress frame at " << f.offset
+                               << " for " << path;
+      return false;
+    }
+    Put<uint64_t>(&table, f.offset);
+    Put<uint64_t>(&table, data.size());
+    Put<uint32_t>(&table, f.length);
+    Put<uint32_t>(&table, static_cast<uint32_t>(packed.size()));
+    data += packed;
+  }
+  data += table;
+  Put<uint32_t>(&data, static_cast<uint32_t>(frames.size()));
+  Put<uint32_t>(&data, kCodec);
+  Put<uint64_t>(&data, segment.size());
+  Put<uint64_t>(&data, kMagic);
+
+  const std::string tmp = path + ".tmp";
+  int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    LOG_WARN("BlockArchive") << "cannot create " << tmp;
+    return false;
+  }
+  bool ok = WriteAll(fd, data);
+  ::close(fd);
+  // Synced and renamed durably before the caller drops the segment
+  if (!ok || !ReplaceFile(tmp, path)) {
+    LOG_WARN("BlockArchive") << "cannot write " << path;
+    std::remove(tmp.c_str());
+    return false;
+  }
+  return true;
+}
+
+std::unique_ptr<BlockArchive> BlockArchive::Open(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return nullptr;
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < kFooter) {
+    ::close(fd);
+    LOG_WARN("BlockArchive") << "truncated archive " << path;
+    return nullptr;
+  }
+  void* map = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);   // the mapping keeps the file
+  if (map == MAP_FAILED) {
+    LOG_WARN("BlockArchive") << "cannot mmap " << path;
+    return nullptr;
+  }
+
+  std::unique_ptr<BlockArchive> ar(new BlockArchive);
+  ar->base_ = static_cast<const char*>(map);
+  ar->size_ = static_cast<uint64_t>(st.st_size);
+
+  const char* p = ar->base_ + ar->size_ - kFooter;
+  uint32_t n     = Decode<uint32_t>(p);
+  ar->codec_     = Decode<uint32_t>(p);
+  ar->segment_bytes_ = Decode<uint64_t>(p);
+  uint64_t magic = Decode<uint64_t>(p);
+  uint64_t table = static_cast<uint64_t>(n) * kFrameEntry;
+  if (magic != kMagic || table > ar->size_ - kFooter) {
+    LOG_WARN("BlockArchive") << "bad footer in " << path;
+    return nullptr;
+  }
+  const uint64_t table_at = ar->size_ - kFooter - table;
+  p = ar->base_ + table_at;
+  ar->frames_.resize(n);
+  for (auto& f : ar->frames_) {
+    f.offset      = Decode<uint64_t>(p);
+    f.file_offset = Decode<uint64_t>(p);
+    f.length      = Decode<uint32_t>(p);
+    f.packed      = Decode<uint32_t>(p);
+    if (f.file_offset + f.packed > table_at) {
+      LOG_WARN("BlockArchive") << "bad frame table in " << path;
+      return nullptr;
+    }
+  }
+  if (ar->codec_ != kCodecZlib && ar->codec_ != kCodec) {
+    LOG_ERROR("BlockArchive") << path << " uses codec " << ar->codec_
+                              << ", which this build lacks (zstd)";
+    return nullptr;
+  }
+  return ar;
+}
+
+static std::atomic<uint64_t> g_next_serial{1};
+
+BlockArchive::BlockArchive() : serial_(g_next_serial.fetch_add(1)) {}
+
+BlockArchive::~BlockArchive() {
+  if (base_) ::munmap(const_cast<char*>(base_), size_);
+}
+
+bool BlockArchive::Read(uint64_t offset, uint32_t length,
+                        std::string* out) const {
+  // Last frame starting at or before `offset`
+  auto it = std::upper_bound(
+    frames_.begin(), frames_.end(), offset,
+    [](uint64_t off, const Frame& f) { return off < f.offset; });
+  if (it == frames_.begin()) return false;
+  --it;
+  const Frame& f = *it;
+  if (offset + length > f.offset + f.length) return false;
+  const size_t idx = static_cast<size_t>(it - frames_.begin());
+
+  // The frame this thread inflated last
+  thread_local struct {
+    uint64_t    serial = 0;
+    size_t      frame = 0;
+    std::string bytes;
+  } cache;
+  if (cache.serial != serial_ || cache.frame != idx) {
+    cache.serial = 0;
+    cache.bytes.resize(f.length);
+    if (!Decompress(codec_, base_ + f.file_offset, f.packed, &cache.bytes)) {
+      return false;
+    }
+    cache.serial = serial_;
+    cache.frame = idx;
+  }
+  out->assign(cache.bytes, offset - f.offset, length);
+  return true;
+}
@@ -0,0 +1,61 @@
+// src/block_cache.cpp
+
+#include "block_cache.h"
+#include "block_chain.grpc.pb.h"   // blockchain::GetBlockResponse
+
+BlockCache::BlockCache(size_t capacity_bytes)
+  : capacity_(capacity_bytes) {}
+
+BlockCache::Bytes BlockCache::Get(int64_t id) {
+  std::lock_guard<std::mutex> lk(mu_);
+  auto it = index_.find(id);
+  if (it == index_.end()) {
+    ++stats_.misses;
+    return nullptr;
+  }
+  ++stats_.hits;
+  lru_.splice(lru_.begin(), lru_, it->second);
+  return it->second->second;
+}
+
+void BlockCache::Put(int64_t id, Bytes bytes) {
+  if (!bytes || bytes->size() > capacity_) return;
+
+  std::lock_guard<std::mutex> lk(mu_);
+  auto it = index_.find(id);
+  if (it != index_.end()) {
+    stats_.bytes -= it->second->second->size();
+    lru_.erase(it->second);
+    index_.erase(it);
+  }
+  stats_.bytes += bytes->size();
+  lru_.emplace_front(id, std::move(bytes));
+  index_[id] = lru_.begin();
+
+  while (stats_.bytes > capacity_) {
+    auto& victim = lru_.back();
+    stats_.bytes -= victim.second->size();
+    index_.erase(victim.first);
+    lru_.pop_back();
+    ++stats_.evictions;
+  }
+  stats_.entries = lru_.size();
+}
+
+BlockCache::Bytes BlockCache::PutBlock(const blockchain::Block& blk) {
+  auto bytes = Encode(blk);
+  Put(blk.id(), bytes);
+  return bytes;
+}
+
+BlockCache::Bytes BlockCache::Encode(const blockchain::Block& blk) {
+  blockchain::GetBlockResponse resp;
+  *resp.mutable_block() = blk;
+  resp.set_status("success");
+  return std::make_shared<const std::string>(resp.SerializeAsString());
+}
+
+BlockCache::Stats BlockCache::GetStats() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  return stats_;
+}
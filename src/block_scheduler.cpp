@@ -1,32 +1,106 @@
 // src/block_scheduler.cpp
 
 #include "block_scheduler.h"
+#include "logger.h"
+#include "canonical_payload.h"              // AppendCanonicalPayload
+#include "compact_block.h"                  // CompactProposal, WithAudits
 #include "merkle_tree.h"                    // SHA256Hex, ComputeMerkleRoot
-#include <nlohmann/json.hpp>                // ordered_json
+#include "rpc_fanout.h"                     // FanOut
 #include <chrono>
-#include <filesystem>
-#include <fstream>
 #include <algorithm>
-#include <iostream>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
 
-namespace fs = std::filesystem;
-using ordered_json = nlohmann::ordered_json;
+static constexpr std::chrono::milliseconds kPeerRpcTimeout{200};
+// Wait this long before retrying after a block missed its quorum.
+static constexpr auto kRetryDelayMs = 500;
+// Log the per-peer latency histograms after this many committed blocks.
+static constexpr uint64_t kLatencyLogEvery = 10;
 
-static constexpr auto kPeerRpcTimeoutMs = 200;
+namespace {
+// A second RPC to one peer within a round, kept alive by its callback.
+struct Resend {
+  grpc::ClientContext                ctx;
+  std::shared_ptr<blockchain::Block> request;
+};
+}  // namespace
 
 BlockScheduler::BlockScheduler(
     std::shared_ptr<MempoolManager> mempool,
     ChainManager&                    chain,
+    std::shared_ptr<BlockStore>      blocks,
     StubList&                        stubs,
+    const std::vector<std::string>&  peers,
     const LeaderConfig&              cfg,
-    std::function<bool()>            isLeaderFn
+    std::function<bool()>            isLeaderFn,
+    std::shared_ptr<BlockCache>      cache,
+    std::shared_ptr<AuditIndex>      index
 )
   : mempool_(std::move(mempool))
   , chain_(chain)
+  , blocks_(std::move(blocks))
+  , cache_(std::move(cache))
+  , index_(std::move(index))
   , stubs_(stubs)
   , cfg_(cfg)
   , isLeaderFn_(std::move(isLeaderFn))
-{}
+  , stats_(std::make_shared<PeerStats>(stubs.size()))
+  , depth_(static_cast<size_t>(std::max(1, cfg.getPipelineDepth())))
+{
+  auto& metrics = MetricsRegistry::Shared();
+  for (size_t i = 0; i < stats_->size(); ++i) {
+    auto& peer = (*stats_)[i];
+    peer.addr = i < peers.size() ? peers[i] : "peer#" + std::to_string(i);
+    peer.propose = &metrics.GetHistogram("peer_rpc_seconds",
+      "Leader-to-peer RPC latency", {{"peer", peer.addr}, {"rpc", "ProposeBlock"}});
+    peer.commit = &metrics.GetHistogram("peer_rpc_seconds",
+      "Leader-to-peer RPC latency", {{"peer", peer.addr}, {"rpc", "CommitBlock"}});
+    peer.propose_errors = &metrics.GetCounter("peer_rpc_errors_total",
+      "Leader-to-peer RPCs that failed or were refused",
+      {{"peer", peer.addr}, {"rpc", "ProposeBlock"}});
+    peer.commit_errors = &metrics.GetCounter("peer_rpc_errors_total",
+      "Leader-to-peer RPCs that failed or were refused",
+      {{"peer", peer.addr}, {"rpc", "CommitBlock"}});
+  }
+
+  // Quorum counts cluster members; the leader's own vote is implicit
+  size_t members = stubs_.size() + 1;
+  size_t quorum  = cfg_.getQuorum() > 0
+                 ? static_cast<size_t>(cfg_.getQuorum())
+                 : members / 2 + 1;
+  if (quorum > members) {
+    LOG_WARN("Scheduler") << "quorum " << quorum << " exceeds cluster size "
+                          << members << ", using " << members;
+    quorum = members;
+  }
+  quorum_ = quorum - 1;
+  LOG_INFO("Scheduler") << "quorum " << quorum << " of " << members
+                        << " (" << quorum_ << " peer acks), pipeline depth "
+                        << depth_;
+
+  if (cfg_.getAdaptiveBatching()) {
+    BatchTuner::Options opts;
+    opts.min_batch      = static_cast<size_t>(cfg_.getBatchMin());
+    opts.max_batch      = static_cast<size_t>(cfg_.getBatchMax());
+    opts.min_interval   = std::chrono::milliseconds(cfg_.getBatchIntervalMinMs());
+    opts.max_interval   = std::chrono::milliseconds(cfg_.getBatchIntervalMaxMs());
+    opts.target_latency = std::chrono::milliseconds(cfg_.getTargetCommitMs());
+    opts.round_deadline = kPeerRpcTimeout * 3 / 4;   // margin under the RPCs'
+    tuner_ = std::make_unique<BatchTuner>(opts);
+    LOG_INFO("Scheduler") << "adaptive batching: " << opts.min_batch << "-"
+                          << opts.max_batch << " audits, "
+                          << opts.min_interval.count() << "-"
+                          << opts.max_interval.count() << " ms, target "
+                          << opts.target_latency.count() << " ms";
+  }
+}
+
+BatchTuner::Plan BlockScheduler::plan() const {
+  if (tuner_) return tuner_->Current();
+  return {static_cast<size_t>(cfg_.getBatchSize()),
+          std::chrono::seconds(cfg_.getBatchIntervalSec())};
+}
 
 BlockScheduler::~BlockScheduler() {
   stop();
@@ -34,194 +108,376 @@ BlockScheduler::~BlockScheduler() {
 
 void BlockScheduler::start() {
   if (running_.exchange(true)) return;  // already running
-  thr_ = std::thread(&BlockScheduler::loop, this);
+  voter_   = std::thread(&BlockScheduler::voteLoop, this);
+  builder_ = std::thread(&BlockScheduler::buildLoop, this);
 }
 
 void BlockScheduler::stop() {
   running_ = false;
-  if (thr_.joinable()) thr_.join();
+  { std::lock_guard<std::mutex> lk(pipe_mu_); }
+  pipe_cv_.notify_all();
+  mempool_->WakeWaiters();
+  if (builder_.joinable()) builder_.join();
+  if (voter_.joinable()) voter_.join();
 }
 
-void BlockScheduler::loop() {
+void BlockScheduler::leadershipChanged() {
+  { std::lock_guard<std::mutex> lk(pipe_mu_); }
+  ++released_;            // cancels the builder's mempool wait
+  pipe_cv_.notify_all();
+  mempool_->WakeWaiters();
+}
+
+void BlockScheduler::pause(std::chrono::steady_clock::time_point until) {
+  std::unique_lock<std::mutex> lk(pipe_mu_);
+  pipe_cv_.wait_until(lk, until, [&]{ return !running_; });
+}
+
+void BlockScheduler::buildLoop() {
   using namespace std::chrono;
+  auto last_cut = steady_clock::now();
   while (running_) {
-    auto t0 = steady_clock::now();
-
-    // Wait until enough audits or timeout
-    while (running_) {
-      auto audits = mempool_->LoadAll();
-      if ((int)audits.size() >= cfg_.getBatchSize()) break;
-      if (steady_clock::now() - t0 
-          >= seconds(cfg_.getBatchIntervalSec()))
-        break;
-      std::this_thread::sleep_for(milliseconds(100));
+    // 1) Wait for room in the pipeline
+    size_t busy;
+    {
+      std::unique_lock<std::mutex> lk(pipe_mu_);
+      pipe_cv_.wait(lk, [&]{ return !running_ || inflight_ < depth_; });
+      busy = inflight_ids_.size();
     }
     if (!running_) break;
+    if (tuner_) tuner_->ObserveIngest(mempool_->Appended(), steady_clock::now());
+    const BatchTuner::Plan next = plan();
+    const auto deadline = last_cut + next.interval;
 
-    auto pending = mempool_->LoadAll();
-    std::cout << "[Scheduler] woke up: " 
-              << pending.size() << " audits pending\n";
+    // 2) Sleep until a full batch beyond the in-flight audits is pending,
+    //    or the interval runs out; a block leaving the pipeline re-arms it
+    uint64_t released = released_.load();
+    bool full = mempool_->WaitForSize(busy + next.batch, deadline,
+      [&]{ return !running_ || released_.load() != released; });
+    if (!running_) break;
+    if (!full && steady_clock::now() < deadline) continue;
 
+    if (!isLeaderFn_()) {
+      // Only the leader cuts blocks; look again next interval, or as soon
+      // as leadershipChanged() says we won an election
+      {
+        std::unique_lock<std::mutex> lk(pipe_mu_);
+        pipe_cv_.wait_until(lk, deadline,
+          [&]{ return !running_ || isLeaderFn_(); });
+      }
+      if (!isLeaderFn_()) last_cut = steady_clock::now();
+      continue;
+    }
+
+    // 3) Snapshot the audits that are not already in a block (under the
+    //    lock, so a block committing meanwhile can't slip back in)
+    std::vector<PendingAudit> pending;
+    int64_t     id;
+    std::string prev_hash;
+    uint64_t    epoch;
+    {
+      std::lock_guard<std::mutex> lk(pipe_mu_);
+      pending = mempool_->LoadPending();
+      pending.erase(std::remove_if(pending.begin(), pending.end(),
+        [&](const PendingAudit& p) {
+          return inflight_ids_.count(p.audit.req_id()) > 0;
+        }), pending.end());
+      if (inflight_ == 0) {
+        tip_id_   = chain_.getLastID();
+        tip_hash_ = chain_.getLastHash();
+      }
+      id        = tip_id_ + 1;
+      prev_hash = tip_hash_;
+      epoch     = epoch_;
+    }
     if (pending.empty()) {
-      std::cout << "[Scheduler] no audits pending, skipping block creation\n";
+      last_cut = steady_clock::now();
       continue;
     }
 
-    if (isLeaderFn_()) {
-      std::cout << "[Scheduler] I am leader, creating block\n";
-      createAndBroadcastBlock(std::move(pending));
+    // 4) Sort and hash outside the lock, while the voter works
+    InFlight f;
+    {
+      static auto& latency = MetricsRegistry::Shared().GetHistogram(
+        "block_build_seconds", "Sorting, Merkle root and hash of a new block");
+      ScopedLatency timer(latency);
+      f = buildBlock(std::move(pending), id, prev_hash,
+                     tuner_ ? next.batch : SIZE_MAX);
+    }
+    last_cut = steady_clock::now();
+    {
+      std::lock_guard<std::mutex> lk(pipe_mu_);
+      if (epoch != epoch_) continue;   // built on a rolled-back block
+      inflight_ids_.insert(f.req_ids.begin(), f.req_ids.end());
+      ++inflight_;
+      tip_id_   = id;
+      tip_hash_ = f.block->hash();
+      queue_.push_back(std::move(f));
+    }
+    pipe_cv_.notify_all();
+  }
+}
+
+void BlockScheduler::voteLoop() {
+  using namespace std::chrono;
+  while (true) {
+    InFlight f;
+    {
+      std::unique_lock<std::mutex> lk(pipe_mu_);
+      pipe_cv_.wait(lk, [&]{ return !running_ || !queue_.empty(); });
+      if (!running_) break;
+      f = std::move(queue_.front());
+      queue_.pop_front();
+    }
+
+    LOG_DEBUG("Scheduler") << "proposing block " << f.block->id() << " ("
+                           << f.req_ids.size() << " audits)";
+    auto t0 = steady_clock::now();
+    bool ok = isLeaderFn_() && proposeAndCommit(f);
+    if (ok && tuner_) {
+      tuner_->ObserveRound(f.req_ids.size(),
+        duration_cast<microseconds>(steady_clock::now() - t0));
+    }
+    static auto& committed = MetricsRegistry::Shared().GetCounter(
+      "blocks_committed_total", "Blocks this leader committed");
+    static auto& rejected = MetricsRegistry::Shared().GetCounter(
+      "blocks_rejected_total", "Blocks that missed the quorum and were rolled back");
+    (ok ? committed : rejected).Inc();
+    if (ok) {
+      std::lock_guard<std::mutex> lk(pipe_mu_);
+      for (auto& rid : f.req_ids) inflight_ids_.erase(rid);
+      --inflight_;
     } else {
-      std::cout << "[Scheduler] not leader, skipping\n";
+      rollback(f);
     }
-    std::this_thread::sleep_for(milliseconds(2000));
+    ++released_;
+    pipe_cv_.notify_all();
+    mempool_->WakeWaiters();
+
+    // Don't spin on a full mempool while the quorum is unreachable
+    if (!ok) pause(steady_clock::now() + milliseconds(kRetryDelayMs));
   }
 }
 
-void BlockScheduler::createAndBroadcastBlock(
-    std::vector<common::FileAudit> pending
-) {
-  // 1) Sort pending by (timestamp, req_id)
-   std::sort(pending.begin(), pending.end(),
-     [](auto& a, auto& b){
-       if (a.timestamp() != b.timestamp())
-         return a.timestamp() < b.timestamp();
-       return a.req_id() < b.req_id();
-     }
-   );
-
-  // 2) Build Merkle root
+void BlockScheduler::rollback(const InFlight& f) {
+  std::lock_guard<std::mutex> lk(pipe_mu_);
+  LOG_WARN("Scheduler")
+    << "block " << f.block->id() << " not committed, "
+    << "discarding " << queue_.size() << " block(s) built on it";
+  queue_.clear();
+  inflight_ids_.clear();
+  inflight_ = 0;
+  ++epoch_;
+}
+
+BlockScheduler::InFlight BlockScheduler::buildBlock(
+    std::vector<PendingAudit> pending, int64_t id,
+    const std::string& prev_hash, size_t max_audits) const
+{
+  // 1) Sort pending by (timestamp, req_id); past max_audits only the
+  //    oldest are sorted into place, the rest wait for a later block
+  auto older = [](auto& x, auto& y){
+    auto& a = x.audit;
+    auto& b = y.audit;
+    if (a.timestamp() != b.timestamp())
+      return a.timestamp() < b.timestamp();
+    return a.req_id() < b.req_id();
+  };
+  if (pending.size() > max_audits) {
+    std::partial_sort(pending.begin(), pending.begin() + max_audits,
+                      pending.end(), older);
+    pending.resize(max_audits);
+  } else {
+    std::sort(pending.begin(), pending.end(), older);
+  }
+
+  // 2) Build Merkle root from the leaf hashes cached at ingestion
   std::vector<std::string> leaf_hashes;
   leaf_hashes.reserve(pending.size());
-  for (auto& a : pending) {
-    ordered_json j;
-    j["access_type"] = a.access_type();
-    j["file_info"]   = {
-      {"file_id",   a.file_info().file_id()},
-      {"file_name", a.file_info().file_name()}
-    };
-    j["req_id"]      = a.req_id();
-    j["timestamp"]   = a.timestamp();
-    j["user_info"]   = {
-      {"user_id",   a.user_info().user_id()},
-      {"user_name", a.user_info().user_name()}
-    };
-    leaf_hashes.push_back(SHA256Hex(j.dump()));
-   }
-  
-  auto merkle = ComputeMerkleRoot(leaf_hashes);
+  for (auto& p : pending) leaf_hashes.push_back(p.leaf_hash);
+
+  std::string merkle;
+  {
+    static auto& latency = MetricsRegistry::Shared().GetHistogram(
+      "block_merkle_seconds", "Merkle root over a new block's leaf hashes");
+    ScopedLatency timer(latency);
+    merkle = ComputeMerkleRoot(leaf_hashes);
+  }
 
   // 3) Fill Block proto
-  blockchain::Block block;
-  int64_t id = chain_.getLastID() + 1;
+  InFlight f;
+  f.block = std::make_shared<blockchain::Block>();
+  auto& block = *f.block;
   block.set_id(id);
-  block.set_previous_hash(chain_.getLastHash());
+  block.set_previous_hash(prev_hash);
   block.set_merkle_root(merkle);
 
-  for (auto& a : pending) {
-    *block.add_audits() = a;
+  f.req_ids.reserve(pending.size());
+  for (auto& p : pending) {
+    f.req_ids.push_back(p.audit.req_id());
+    *block.add_audits() = p.audit;
   }
 
-  // 4) Compute block_hash by concatenating:
-//    id + previous_hash + merkle_root + JSON(audit1)+JSON(audit2)+…
-  std::string audits_concat;
-  audits_concat.reserve(pending.size() * 128);  // pre-reserve for efficiency
-  for (auto& a : pending) {
-    ordered_json j2;
-    j2["access_type"] = a.access_type();
-    j2["file_info"]   = {
-      {"file_id",   a.file_info().file_id()},
-      {"file_name", a.file_info().file_name()}
-    };
-    j2["req_id"]      = a.req_id();
-    j2["timestamp"]   = a.timestamp();
-    j2["user_info"]   = {
-      {"user_id",   a.user_info().user_id()},
-      {"user_name", a.user_info().user_name()}
-    };
-    // exactly the same compact, sorted JSON string your Python code uses:
-    audits_concat += j2.dump();
-  }
-  // build exactly: "<id><previous_hash><merkle_root><audits_json…>"
+  // 4) Compute block_hash over exactly:
+  //    "<id><previous_hash><merkle_root><audits_json…>"
+  //    with each audit's canonical JSON written straight into the buffer
   std::string header = std::to_string(id)
                     + block.previous_hash()
-                    + merkle
-                    + audits_concat;
+                    + merkle;
+  header.reserve(header.size() + pending.size() * 160);
+  for (auto& p : pending) {
+    AppendCanonicalPayload(p.audit, &header);
+  }
   block.set_hash(SHA256Hex(header));
+  f.proposal = cfg_.getCompactProposals()
+    ? std::make_shared<blockchain::Block>(CompactProposal(block))
+    : f.block;
+  return f;
+}
 
-
-  // 6) Send ProposeBlock to all peers
-  bool all_yes = true;
-  int i = 0;
-  for (auto &stub : stubs_)
-  {
-    grpc::ClientContext ctx;
-    // enforce a deadline on this RPC
-    ctx.set_deadline(
-      std::chrono::system_clock::now() +
-      std::chrono::milliseconds(kPeerRpcTimeoutMs)
-    );
-    blockchain::BlockVoteResponse vote_resp;
-    auto status = stub->ProposeBlock(&ctx, block, &vote_resp);
-    if (!vote_resp.vote()) {
-      all_yes = false;
-      std::cerr << "[Scheduler] proposal rejected: "
-                << (status.ok() ? vote_resp.error_message() : status.error_message())
-                << "\n";
-
-      break;
-    } else {
-      std::cout << "[Scheduler] proposal accepted by " << i << "\n";
-    }
+bool BlockScheduler::proposeAndCommit(const InFlight& f) {
+  // 5) Propose to all peers concurrently; decide once the quorum is in
+  //    (a peer that lacks some of a compact block's audits gets a second
+  //    proposal with just those attached, within the same deadline)
+  static auto& resent_audits = MetricsRegistry::Shared().GetCounter(
+    "proposal_audits_resent_total",
+    "Audits sent in full to peers that lacked them for a compact proposal");
+  auto blk   = f.block;
+  auto msg   = f.proposal;
+  auto id    = blk->id();
+  auto stats = stats_;
+  auto t0    = std::chrono::steady_clock::now();
+  bool accepted = FanOut<blockchain::BlockVoteResponse>(
+    stubs_.size(), quorum_, kPeerRpcTimeout,
+    [this, blk, msg](size_t i, grpc::ClientContext* ctx,
+                     blockchain::BlockVoteResponse* resp,
+                     std::function<void(grpc::Status)> done) {
+      auto* stub = stubs_[i].get();
+      stub->async()->ProposeBlock(ctx, msg.get(), resp,
+        [stub, blk, msg, ctx, resp, done = std::move(done)](grpc::Status s) {
+          if (!s.ok() || msg == blk || resp->missing_ids_size() == 0) {
+            done(std::move(s));
+            return;
+          }
+          auto again = std::make_shared<Resend>();
+          again->request = std::make_shared<blockchain::Block>(
+            WithAudits(*msg, *blk, resp->missing_ids()));
+          again->ctx.set_deadline(ctx->deadline());
+          resent_audits.Inc(again->request->audits_size());
+          resp->Clear();
+          stub->async()->ProposeBlock(&again->ctx, again->request.get(), resp,
+            [again, done](grpc::Status s) { done(std::move(s)); });
+        });
+    },
+    [stats](size_t i, const grpc::Status& status,
+            const blockchain::BlockVoteResponse& resp,
+            std::chrono::microseconds latency) {
+      auto& peer = (*stats)[i];
+      peer.propose->Record(latency);
+      if (status.ok() && resp.vote()) return true;
+      peer.propose_errors->Inc();
+      LOG_WARN_EVERY_MS("Scheduler", 1000)
+        << "proposal rejected by " << peer.addr << ": "
+        << (status.ok() ? resp.error_message() : status.error_message());
+      return false;
+    });
+  auto propose_time = std::chrono::steady_clock::now() - t0;
+  static auto& propose_latency = MetricsRegistry::Shared().GetHistogram(
+    "block_propose_seconds", "ProposeBlock round until the quorum decided");
+  propose_latency.Record(
+    std::chrono::duration_cast<std::chrono::microseconds>(propose_time));
+  auto propose_ms =
+    std::chrono::duration_cast<std::chrono::milliseconds>(propose_time).count();
+  if (!accepted) {
+    LOG_WARN("Scheduler") << "block " << id << " did not reach quorum ("
+                          << propose_ms << " ms)";
+    return false;
   }
-  if (!all_yes) return;
-
-  //CommitBlock RPC
-  for (auto& stub : stubs_) {
-    grpc::ClientContext ctx;
-    // enforce a deadline on this RPC too
-    ctx.set_deadline(
-       std::chrono::system_clock::now() +
-      std::chrono::milliseconds(kPeerRpcTimeoutMs)
-    );
-    blockchain::BlockCommitResponse commit_resp;
-    auto status = stub->CommitBlock(&ctx, block, &commit_resp);
-    if (!status.ok() || commit_resp.status() != "success") {
-      std::cerr << "[Scheduler] commit failed: "
-                << (status.ok()
-                    ? commit_resp.error_message()
-                    : status.error_message())
-                << "\n";
-    }
+  LOG_DEBUG("Scheduler") << "block " << id << " accepted by quorum in "
+                         << propose_ms << " ms";
+
+  // CommitBlock RPC, also concurrent; stragglers finish in the background
+  static auto& commit_latency = MetricsRegistry::Shared().GetHistogram(
+    "block_commit_seconds", "CommitBlock round plus the local commit");
+  //    (a compact commit is only id and hash; a peer without the proposal
+  //    gets the full block instead)
+  static auto& resent_blocks = MetricsRegistry::Shared().GetCounter(
+    "commit_blocks_resent_total",
+    "Compact commits resent as full blocks to peers without the proposal");
+  ScopedLatency commit_timer(commit_latency);
+  auto confirm = msg == blk
+    ? blk
+    : std::make_shared<blockchain::Block>(CompactCommit(*blk));
+  bool committed = FanOut<blockchain::BlockCommitResponse>(
+    stubs_.size(), quorum_, kPeerRpcTimeout,
+    [this, blk, confirm](size_t i, grpc::ClientContext* ctx,
+                         blockchain::BlockCommitResponse* resp,
+                         std::function<void(grpc::Status)> done) {
+      auto* stub = stubs_[i].get();
+      stub->async()->CommitBlock(ctx, confirm.get(), resp,
+        [stub, blk, confirm, ctx, resp, done = std::move(done)](grpc::Status s) {
+          if (!s.ok() || confirm == blk || !resp->unknown_block()) {
+            done(std::move(s));
+            return;
+          }
+          auto again = std::make_shared<Resend>();
+          again->request = blk;
+          again->ctx.set_deadline(ctx->deadline());
+          resent_blocks.Inc();
+          resp->Clear();
+          stub->async()->CommitBlock(&again->ctx, again->request.get(), resp,
+            [again, done](grpc::Status s) { done(std::move(s)); });
+        });
+    },
+    [stats](size_t i, const grpc::Status& status,
+            const blockchain::BlockCommitResponse& resp,
+            std::chrono::microseconds latency) {
+      auto& peer = (*stats)[i];
+      peer.commit->Record(latency);
+      if (status.ok() && resp.status() == "success") return true;
+      peer.commit_errors->Inc();
+      LOG_WARN_EVERY_MS("Scheduler", 1000)
+        << "commit failed on " << peer.addr << ": "
+        << (status.ok() ? resp.error_message() : status.error_message());
+      return false;
+    });
+  if (!committed) {
+    LOG_WARN("Scheduler") << "block " << id
+                          << " committed on fewer peers than the quorum";
   }
 
-  // 7) Locally commit: update chain.json + prune mempool
+  // 6) Locally commit: update chain.json + prune mempool (the reply is
+  //    cached and indexed first, so GetBlock and QueryAudits can serve it
+  //    before the store has it)
+  if (cache_) cache_->PutBlock(*blk);
+  if (index_) index_->AddBlock(*blk);
   {
     BlockMeta meta {
       id,
-      block.hash(),
-      block.previous_hash(),
-      block.merkle_root()
+      blk->hash(),
+      blk->previous_hash(),
+      blk->merkle_root()
     };
     chain_.append(meta);
   }
-  std::vector<std::string> ids;
-  ids.reserve(pending.size());
-  for (auto& a : pending) ids.push_back(a.req_id());
-  mempool_->RemoveBatch(ids);
-
-  // 8) Dump full block JSON to file
-  fs::create_directories("../blocks");
-  std::string block_json;
-  google::protobuf::util::MessageToJsonString(block, &block_json);
-  std::ofstream bout("../blocks/block_" + std::to_string(id) + ".json");
-  if (!bout) {
-    std::cerr << "[Scheduler] failed to write block file\n";
-  } else {
-    bout << block_json;
-    std::cout << "[Scheduler] wrote ../blocks/block_"
-              << id << ".json\n";
+  mempool_->RemoveBatch(f.req_ids);
+
+  // 7) Append full block to the block store
+  if (!blocks_->Put(*blk)) {
+    LOG_WARN("Scheduler") << "failed to store block " << id;
   }
 
-  std::cout << "[Scheduler] committed block " << id
-            << " (" << pending.size() << " audits)\n";
+  LOG_INFO("Scheduler") << "committed block " << id
+                        << " (" << f.req_ids.size() << " audits)";
+
+  if (++committed_ % kLatencyLogEvery == 0) logPeerLatencies();
+  return true;
+}
+
+void BlockScheduler::logPeerLatencies() const {
+  for (auto& peer : *stats_) {
+    LOG_INFO("Scheduler") << "latency " << peer.addr
+                          << " propose{" << peer.propose->Summary() << "}"
+                          << " commit{"  << peer.commit->Summary()  << "}";
+  }
 }
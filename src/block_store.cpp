@@ -0,0 +1,499 @@
+#include "block_store.h"
+#include "logger.h"
+#include "merkle_tree.h"                    // DeterministicSerialize
+#include "storage_format.h"                 // ReadBlockFile (legacy files)
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+// Segment record: [u32 length][i64 block id][length bytes of Block]
+static constexpr size_t kRecordHeader = 12;
+// Index entry:    [i64 block id][u32 segment][u64 offset][u32 length]
+static constexpr size_t kIndexEntry = 24;
+// Sanity bound used while recovering a segment tail.
+static constexpr uint32_t kMaxBlockBytes = 1u << 30;
+
+template <typename T>
+static void Encode(char*& p, T v) { std::memcpy(p, &v, sizeof v); p += sizeof v; }
+
+template <typename T>
+static T Decode(const char*& p) { T v; std::memcpy(&v, p, sizeof v); p += sizeof v; return v; }
+
+// pread()/pwrite() until done or error
+static bool ReadFully(int fd, char* buf, size_t len, uint64_t off) {
+  while (len > 0) {
+    ssize_t n = ::pread(fd, buf, len, static_cast<off_t>(off));
+    if (n <= 0) return false;
+    buf += n; len -= n; off += n;
+  }
+  return true;
+}
+
+static bool WriteFully(int fd, const char* buf, size_t len, uint64_t off) {
+  while (len > 0) {
+    ssize_t n = ::pwrite(fd, buf, len, static_cast<off_t>(off));
+    if (n <= 0) return false;
+    buf += n; len -= n; off += n;
+  }
+  return true;
+}
+
+static uint64_t FileSize(int fd) {
+  struct stat st;
+  return ::fstat(fd, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+}
+
+BlockStore::BlockStore(std::string dir)
+  : BlockStore(std::move(dir), Options{})
+{}
+
+BlockStore::BlockStore(std::string dir, Options opts,
+                       std::shared_ptr<KeyRegistry> keys)
+  : dir_(std::move(dir))
+  , opts_(opts)
+  , keys_(std::move(keys))
+  , archived_gauge_(MetricsRegistry::Shared().GetGauge(
+      "block_store_archived_segments", "Block segments moved to archives"))
+  , archive_bytes_gauge_(MetricsRegistry::Shared().GetGauge(
+      "block_store_archive_bytes", "Bytes of block archives on disk"))
+{
+  openOrRecover();
+  flusher_ = std::thread(&BlockStore::flusherLoop, this);
+  if (opts_.archive_after_s > 0) {
+    archiver_ = std::thread(&BlockStore::archiverLoop, this);
+  }
+}
+
+BlockStore::~BlockStore() {
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    stopping_ = true;
+  }
+  sync_cv_.notify_all();
+  archive_cv_.notify_all();
+  if (flusher_.joinable()) flusher_.join();
+  if (archiver_.joinable()) archiver_.join();
+  Sync();
+  for (int fd : seg_fds_) if (fd >= 0) ::close(fd);
+  for (auto& ar : archives_) {
+    if (!ar) continue;
+    archived_gauge_.Add(-1);
+    archive_bytes_gauge_.Add(-static_cast<int64_t>(ar->FileBytes()));
+  }
+  if (index_fd_ >= 0) ::close(index_fd_);
+}
+
+std::string BlockStore::segmentPath(uint32_t seg) const {
+  char name[32];
+  std::snprintf(name, sizeof name, "segment_%06u.dat", seg);
+  return dir_ + "/" + name;
+}
+
+std::string BlockStore::archivePath(uint32_t seg) const {
+  char name[32];
+  std::snprintf(name, sizeof name, "segment_%06u.arc", seg);
+  return dir_ + "/" + name;
+}
+
+// (Caller holds mu_.)
+bool BlockStore::isArchived(uint32_t seg) const {
+  return seg < archives_.size() && archives_[seg] != nullptr;
+}
+
+bool BlockStore::openSegment(uint32_t seg) {
+  int fd = ::open(segmentPath(seg).c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    LOG_WARN("BlockStore") << "cannot open " << segmentPath(seg);
+    return false;
+  }
+  if (seg_fds_.size() <= seg) seg_fds_.resize(seg + 1, -1);
+  seg_fds_[seg] = fd;
+  return true;
+}
+
+void BlockStore::openOrRecover() {
+  std::lock_guard<std::mutex> lk(mu_);
+  fs::create_directories(dir_);
+
+  // 1) Open every existing segment and map every archive
+  for (auto& entry : fs::directory_iterator(dir_)) {
+    unsigned seg;
+    auto name = entry.path().filename().string();
+    auto ext  = entry.path().extension().string();
+    if (std::sscanf(name.c_str(), "segment_%u.", &seg) != 1) continue;
+    if (ext == ".dat") {
+      if (openSegment(seg) && seg > active_seg_) active_seg_ = seg;
+    } else if (ext == ".arc") {
+      if (auto ar = BlockArchive::Open(entry.path().string())) {
+        if (archives_.size() <= seg) archives_.resize(seg + 1);
+        archive_bytes_gauge_.Add(static_cast<int64_t>(ar->FileBytes()));
+        archived_gauge_.Add(1);
+        archives_[seg] = std::move(ar);
+      }
+    } else if (ext == ".tmp") {
+      fs::remove(entry.path());   // an archive that was never finished
+    }
+  }
+  // A crash between writing an archive and deleting its segment leaves both
+  for (uint32_t seg = 0; seg < archives_.size(); ++seg) {
+    if (isArchived(seg) && seg < seg_fds_.size() && seg_fds_[seg] >= 0) {
+      ::close(seg_fds_[seg]);
+      seg_fds_[seg] = -1;
+      fs::remove(segmentPath(seg));
+    }
+  }
+  if (seg_fds_.size() <= active_seg_ || seg_fds_[active_seg_] < 0) {
+    active_seg_ = static_cast<uint32_t>(std::max(seg_fds_.size(),
+                                                 archives_.size()));
+    if (!openSegment(active_seg_)) return;
+  }
+  if (seg_fds_.size() < archives_.size()) seg_fds_.resize(archives_.size(), -1);
+  const size_t archived = static_cast<size_t>(
+    std::count_if(archives_.begin(), archives_.end(),
+                  [](const auto& ar) { return ar != nullptr; }));
+
+  // 2) Load the offset index, dropping a torn trailing entry
+  const std::string index_path = dir_ + "/index.dat";
+  index_fd_ = ::open(index_path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+  if (index_fd_ < 0) {
+    LOG_WARN("BlockStore") << "cannot open " << index_path;
+    return;
+  }
+  uint64_t index_bytes = FileSize(index_fd_);
+  uint64_t entries = index_bytes / kIndexEntry;
+  if (entries * kIndexEntry != index_bytes &&
+      ::ftruncate(index_fd_, static_cast<off_t>(entries * kIndexEntry)) != 0) {
+    LOG_WARN("BlockStore") << "cannot truncate " << index_path;
+  }
+  index_bytes_ = entries * kIndexEntry;
+  std::vector<uint64_t> indexed_end(seg_fds_.size(), 0);
+  std::string buf(entries * kIndexEntry, '\0');
+  if (!buf.empty() && !ReadFully(index_fd_, &buf[0], buf.size(), 0)) {
+    LOG_WARN("BlockStore") << "cannot read " << index_path;
+    return;
+  }
+  for (const char* p = buf.data(); p < buf.data() + buf.size(); ) {
+    int64_t  id = Decode<int64_t>(p);
+    Location loc;
+    loc.segment = Decode<uint32_t>(p);
+    loc.offset  = Decode<uint64_t>(p);
+    loc.length  = Decode<uint32_t>(p);
+    if (loc.segment >= seg_fds_.size() ||
+        (seg_fds_[loc.segment] < 0 && !isArchived(loc.segment))) {
+      continue;
+    }
+    index_[id] = loc;
+    indexed_end[loc.segment] =
+      std::max(indexed_end[loc.segment], loc.offset + loc.length);
+  }
+
+  // 3) Pick up records written after the last index entry (crash recovery)
+  for (uint32_t seg = 0; seg < seg_fds_.size(); ++seg) {
+    if (seg_fds_[seg] >= 0 && FileSize(seg_fds_[seg]) > indexed_end[seg]) {
+      recoverSegmentTail(seg, indexed_end[seg]);
+    }
+  }
+  active_size_ = FileSize(seg_fds_[active_seg_]);
+  LOG_INFO("BlockStore") << index_.size() << " blocks in "
+                         << (active_seg_ + 1) << " segment(s) under " << dir_
+                         << " (" << archived << " archived)";
+}
+
+// Scan whole records from `from` onwards, indexing each one; the active
+// segment is truncated after the last whole record. (Caller holds mu_.)
+void BlockStore::recoverSegmentTail(uint32_t seg, uint64_t from) {
+  int fd = seg_fds_[seg];
+  uint64_t size = FileSize(fd);
+  uint64_t off = from;
+  size_t recovered = 0;
+  while (off + kRecordHeader <= size) {
+    char hdr[kRecordHeader];
+    if (!ReadFully(fd, hdr, sizeof hdr, off)) break;
+    const char* p = hdr;
+    uint32_t len = Decode<uint32_t>(p);
+    int64_t  id  = Decode<int64_t>(p);
+    if (len > kMaxBlockBytes || off + kRecordHeader + len > size) break;
+
+    std::string bytes(len, '\0');
+    blockchain::Block blk;
+    if ((len && !ReadFully(fd, &bytes[0], len, off + kRecordHeader)) ||
+        !blk.ParseFromString(bytes) || blk.id() != id) {
+      break;
+    }
+    Location loc{seg, off + kRecordHeader, len};
+    index_[id] = loc;
+    appendIndex(id, loc);
+    off += kRecordHeader + len;
+    ++recovered;
+  }
+  if (off < size && seg == active_seg_ &&
+      ::ftruncate(fd, static_cast<off_t>(off)) != 0) {
+    LOG_WARN("BlockStore") << "cannot truncate " << segmentPath(seg);
+  }
+  LOG_INFO("BlockStore") << "recovered " << recovered
+                         << " unindexed block(s) from " << segmentPath(seg);
+}
+
+// A short write is cut off again, so a torn entry never shifts the ones
+// appended after it. (Caller holds mu_.)
+bool BlockStore::appendIndex(int64_t id, const Location& loc) {
+  char entry[kIndexEntry];
+  char* p = entry;
+  Encode<int64_t>(p, id);
+  Encode<uint32_t>(p, loc.segment);
+  Encode<uint64_t>(p, loc.offset);
+  Encode<uint32_t>(p, loc.length);
+  if (::write(index_fd_, entry, sizeof entry) !=
+      static_cast<ssize_t>(sizeof entry)) {
+    if (::ftruncate(index_fd_, static_cast<off_t>(index_bytes_)) != 0) {
+      LOG_WARN("BlockStore") << "cannot truncate " << dir_ << "/index.dat";
+    }
+    return false;
+  }
+  index_bytes_ += kIndexEntry;
+  return true;
+}
+
+bool BlockStore::Put(const blockchain::Block& blk) {
+  std::string bytes;
+  if (keys_) {
+    blockchain::Block stripped = blk;
+    for (auto& a : *stripped.mutable_audits()) keys_->Strip(&a);
+    bytes = DeterministicSerialize(stripped);
+  } else {
+    bytes = DeterministicSerialize(blk);
+  }
+  std::string rec(kRecordHeader, '\0');
+  char* p = &rec[0];
+  Encode<uint32_t>(p, static_cast<uint32_t>(bytes.size()));
+  Encode<int64_t>(p, blk.id());
+  rec += bytes;
+
+  std::unique_lock<std::mutex> lk(mu_);
+  if (index_fd_ < 0) return false;
+
+  // Roll over to a fresh segment; the one being closed is synced first
+  if (active_size_ > 0 && active_size_ + rec.size() > opts_.segment_bytes) {
+    ::fdatasync(seg_fds_[active_seg_]);
+    if (!openSegment(active_seg_ + 1)) return false;
+    ++active_seg_;
+    active_size_ = 0;
+  }
+
+  // On failure the segment is cut back, so no unindexed record is left
+  // behind later, indexed ones (recovery only rescans past those)
+  const int seg_fd = seg_fds_[active_seg_];
+  Location loc{active_seg_, active_size_ + kRecordHeader,
+               static_cast<uint32_t>(bytes.size())};
+  bool written = WriteFully(seg_fd, rec.data(), rec.size(), active_size_);
+  if (!written || !appendIndex(blk.id(), loc)) {
+    LOG_WARN("BlockStore") << (written ? "index" : "segment")
+                           << " write failed for block " << blk.id();
+    if (::ftruncate(seg_fd, static_cast<off_t>(active_size_)) != 0) {
+      LOG_WARN("BlockStore") << "cannot truncate " << segmentPath(active_seg_);
+    }
+    return false;
+  }
+  active_size_ += rec.size();
+  index_[blk.id()] = loc;
+
+  if (++unsynced_ >= opts_.sync_every) sync_cv_.notify_all();
+  return true;
+}
+
+bool BlockStore::GetSerialized(int64_t id, std::string* bytes) const {
+  std::shared_lock<std::shared_mutex> retire(retire_mu_);
+  Location loc;
+  int fd;
+  std::shared_ptr<const BlockArchive> archive;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = index_.find(id);
+    if (it == index_.end()) return false;
+    loc = it->second;
+    fd  = seg_fds_[loc.segment];
+    if (isArchived(loc.segment)) archive = archives_[loc.segment];
+  }
+  if (archive) return archive->Read(loc.offset, loc.length, bytes);
+
+  // Segments are append-only and stay open (retire_mu_ keeps archiving
+  // from closing this one), so read without the lock
+  bytes->resize(loc.length);
+  return loc.length == 0 || ReadFully(fd, &(*bytes)[0], loc.length, loc.offset);
+}
+
+bool BlockStore::Get(int64_t id, blockchain::Block* blk, std::string* err) const {
+  std::string bytes;
+  if (GetSerialized(id, &bytes)) {
+    if (!blk->ParseFromString(bytes)) {
+      *err = "corrupt block record";
+      return false;
+    }
+  } else if (!ReadBlockFile(dir_, id, blk, err)) {
+    return false;   // not in the segments, nor a legacy per-block file
+  }
+  for (auto& a : *blk->mutable_audits()) {
+    if (NeedsKey(a) && !(keys_ && keys_->Resolve(&a))) {
+      LOG_WARN_EVERY_MS("BlockStore", 1000)
+        << "block " << id << ": unknown key_id for req_id=" << a.req_id();
+    }
+  }
+  return true;
+}
+
+bool BlockStore::Contains(int64_t id) const {
+  std::lock_guard<std::mutex> lk(mu_);
+  return index_.count(id) > 0;
+}
+
+size_t BlockStore::Size() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  return index_.size();
+}
+
+// fsync the active segment and the index outside the lock (caller holds lk)
+void BlockStore::syncLocked(std::unique_lock<std::mutex>& lk) {
+  if (unsynced_ == 0 || index_fd_ < 0) return;
+  int pending = unsynced_;
+  int seg_fd  = seg_fds_[active_seg_];
+  syncing_ = true;
+  lk.unlock();
+  ::fdatasync(seg_fd);
+  ::fdatasync(index_fd_);
+  lk.lock();
+  syncing_ = false;
+  unsynced_ -= pending;
+  sync_cv_.notify_all();
+}
+
+void BlockStore::Sync() {
+  std::unique_lock<std::mutex> lk(mu_);
+  sync_cv_.wait(lk, [&]{ return !syncing_; });
+  syncLocked(lk);
+}
+
+void BlockStore::flusherLoop() {
+  std::unique_lock<std::mutex> lk(mu_);
+  while (!stopping_) {
+    sync_cv_.wait_for(lk, std::chrono::milliseconds(opts_.sync_interval_ms),
+                      [&]{ return stopping_ || unsynced_ >= opts_.sync_every; });
+    if (stopping_) break;
+    if (!syncing_) syncLocked(lk);
+  }
+}
+
+// Compress sealed segment `seg` into its archive, check that it reads back,
+// then switch readers over and delete the segment. Only the archiver
+// (under archive_mu_) retires segments, so the fd can be read unlocked.
+bool BlockStore::archiveSegment(uint32_t seg) {
+  int fd;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (seg == active_seg_ || seg >= seg_fds_.size() || seg_fds_[seg] < 0) {
+      return false;
+    }
+    fd = seg_fds_[seg];
+  }
+  std::string data(FileSize(fd), '\0');
+  if (!data.empty() && !ReadFully(fd, &data[0], data.size(), 0)) {
+    LOG_WARN("BlockStore") << "cannot read " << segmentPath(seg);
+    return false;
+  }
+
+  // Cut frames at record boundaries; a record never spans two frames
+  std::vector<BlockArchive::Span> frames;
+  uint64_t off = 0;
+  while (off + kRecordHeader <= data.size()) {
+    const char* p = data.data() + off;
+    uint64_t rec = kRecordHeader + Decode<uint32_t>(p);
+    if (off + rec > data.size()) break;
+    if (frames.empty() ||
+        frames.back().length + rec > opts_.archive_frame_bytes) {
+      frames.push_back({off, 0});
+    }
+    frames.back().length += static_cast<uint32_t>(rec);
+    off += rec;
+  }
+  if (off != data.size()) {
+    LOG_WARN("BlockStore") << "not archiving " << segmentPath(seg)
+                           << ": torn record at " << off;
+    return false;
+  }
+
+  const std::string path = archivePath(seg);
+  std::shared_ptr<const BlockArchive> archive;
+  if (BlockArchive::Write(path, data, frames)) archive = BlockArchive::Open(path);
+  for (size_t i = 0; archive && i < frames.size(); ++i) {
+    std::string frame;
+    if (!archive->Read(frames[i].offset, frames[i].length, &frame) ||
+        data.compare(frames[i].offset, frames[i].length, frame) != 0) {
+      archive.reset();
+    }
+  }
+  if (!archive) {
+    LOG_WARN("BlockStore") << "archive of " << segmentPath(seg)
+                           << " failed, keeping the segment";
+    std::remove(path.c_str());
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (archives_.size() <= seg) archives_.resize(seg + 1);
+    archives_[seg] = archive;
+    seg_fds_[seg] = -1;
+  }
+  {
+    std::unique_lock<std::shared_mutex> retire(retire_mu_);
+    ::close(fd);
+  }
+  fs::remove(segmentPath(seg));
+  archived_gauge_.Add(1);
+  archive_bytes_gauge_.Add(static_cast<int64_t>(archive->FileBytes()));
+  LOG_INFO("BlockStore") << "archived " << segmentPath(seg) << ": "
+                         << archive->SegmentBytes() << " -> "
+                         << archive->FileBytes() << " bytes in "
+                         << frames.size() << " frame(s)";
+  return true;
+}
+
+size_t BlockStore::ArchiveCold(std::chrono::seconds older_than) {
+  std::lock_guard<std::mutex> guard(archive_mu_);
+  std::vector<uint32_t> sealed;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    for (uint32_t seg = 0; seg < seg_fds_.size(); ++seg) {
+      if (seg != active_seg_ && seg_fds_[seg] >= 0) sealed.push_back(seg);
+    }
+  }
+  const std::time_t cutoff = std::time(nullptr) - older_than.count();
+  size_t archived = 0;
+  for (uint32_t seg : sealed) {
+    struct stat st;
+    if (::stat(segmentPath(seg).c_str(), &st) != 0 || st.st_mtime > cutoff) {
+      continue;
+    }
+    if (archiveSegment(seg)) ++archived;
+  }
+  return archived;
+}
+
+void BlockStore::archiverLoop() {
+  std::unique_lock<std::mutex> lk(mu_);
+  while (!stopping_) {
+    archive_cv_.wait_for(lk, std::chrono::milliseconds(opts_.archive_interval_ms),
+                         [&]{ return stopping_; });
+    if (stopping_) break;
+    lk.unlock();
+    ArchiveCold(std::chrono::seconds(opts_.archive_after_s));
+    lk.lock();
+  }
+}
@@ -0,0 +1,252 @@
+// src/block_sync.cpp
+
+#include "block_sync.h"
+#include "logger.h"
+#include <grpcpp/grpcpp.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+enum class RangeState { kTodo, kFetching, kFetched };
+
+struct Range {
+  int64_t    start;
+  int64_t    end;
+  RangeState state = RangeState::kTodo;
+  std::string from;                          // peer that supplied it
+};
+
+// Shared by the fetch workers and the committing thread.
+struct RunState {
+  std::mutex                 mu;
+  std::condition_variable    cv;
+  std::vector<Range>         ranges;
+  std::unordered_map<size_t, std::vector<blockchain::Block>> fetched;
+  size_t                     next_commit = 0;
+  std::vector<int64_t>       heights;        // per source; -1 once retired
+  bool                       done = false;
+};
+
+}  // namespace
+
+BlockSync::BlockSync(ChainManager& chain, std::shared_ptr<BlockStore> blocks,
+                     std::shared_ptr<MempoolManager> mempool)
+  : BlockSync(chain, std::move(blocks), std::move(mempool), Options{}) {}
+
+BlockSync::BlockSync(ChainManager& chain, std::shared_ptr<BlockStore> blocks,
+                     std::shared_ptr<MempoolManager> mempool, Options opts)
+  : chain_(chain)
+  , blocks_(std::move(blocks))
+  , mempool_(std::move(mempool))
+  , opts_(opts)
+{
+  opts_.range_blocks = std::max<int64_t>(1, opts_.range_blocks);
+  opts_.window       = std::max<size_t>(1, opts_.window);
+}
+
+int64_t BlockSync::Run(const std::vector<Source>& sources) {
+  RunState st;
+  int64_t local  = chain_.getLastID();
+  int64_t target = local;
+  for (auto& s : sources) {
+    target = std::max(target, s.latest_id);
+    st.heights.push_back(s.latest_id);
+  }
+  if (target <= local) return 0;
+
+  for (int64_t start = local + 1; start <= target;
+       start += opts_.range_blocks) {
+    st.ranges.push_back({start, std::min(target, start + opts_.range_blocks - 1)});
+  }
+  LOG_INFO("Sync") << "fetching blocks " << local + 1 << "–" << target
+                   << " in " << st.ranges.size() << " ranges from "
+                   << sources.size() << " peer(s)";
+
+  // Lowest unclaimed range within the window that source `i` can serve
+  // (caller holds st.mu)
+  auto pick = [&](size_t i) -> long {
+    size_t limit = std::min(st.ranges.size(), st.next_commit + opts_.window);
+    for (size_t r = st.next_commit; r < limit; ++r) {
+      if (st.ranges[r].state == RangeState::kTodo &&
+          st.ranges[r].end <= st.heights[i]) {
+        return static_cast<long>(r);
+      }
+    }
+    return -1;
+  };
+  // Whether source `i` could still serve an open range, now or later
+  auto useful = [&](size_t i) {
+    for (size_t r = st.next_commit; r < st.ranges.size(); ++r) {
+      if (st.ranges[r].state != RangeState::kFetched &&
+          st.ranges[r].end <= st.heights[i]) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  auto worker = [&](size_t i) {
+    const Source& src = sources[i];
+    std::unique_lock<std::mutex> lk(st.mu);
+    while (true) {
+      long r = -1;
+      st.cv.wait(lk, [&]{
+        return st.done || (r = pick(i)) >= 0 || !useful(i);
+      });
+      if (st.done || r < 0) break;
+
+      Range& range = st.ranges[r];
+      range.state = RangeState::kFetching;
+      lk.unlock();
+      std::vector<blockchain::Block> blocks;
+      std::string err;
+      bool ok = fetchRange(src, range.start, range.end, &blocks, &err);
+      lk.lock();
+
+      if (!ok) {
+        // Hand the range back and stop using this peer for this run
+        LOG_WARN_EVERY_MS("Sync", 1000)
+          << "blocks " << range.start << "–" << range.end
+          << " from " << src.addr << " failed: " << err;
+        range.state = RangeState::kTodo;
+        break;
+      }
+      range.state = RangeState::kFetched;
+      range.from  = src.addr;
+      st.fetched[r] = std::move(blocks);
+      st.cv.notify_all();
+    }
+    st.heights[i] = -1;
+    st.cv.notify_all();
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < sources.size(); ++i) workers.emplace_back(worker, i);
+
+  // Commit ranges in order as they arrive
+  int64_t committed = 0;
+  std::unique_lock<std::mutex> lk(st.mu);
+  while (st.next_commit < st.ranges.size()) {
+    size_t next = st.next_commit;
+    st.cv.wait(lk, [&]{
+      if (st.fetched.count(next)) return true;
+      for (auto h : st.heights) {
+        if (h >= st.ranges[next].end) return false;   // someone may still
+      }
+      return true;
+    });
+    auto it = st.fetched.find(next);
+    if (it == st.fetched.end()) {
+      LOG_WARN("Sync") << "no peer could supply blocks "
+                       << st.ranges[next].start << "–" << st.ranges[next].end;
+      break;
+    }
+    auto range = std::move(it->second);
+    st.fetched.erase(it);
+    lk.unlock();
+
+    std::string err;
+    bool ok = commitRange(range, &err);
+    lk.lock();
+    if (!ok) {
+      LOG_WARN("Sync")
+        << "rejected blocks " << st.ranges[next].start << "–"
+        << st.ranges[next].end << " from " << st.ranges[next].from
+        << ": " << err;
+      break;
+    }
+    committed += static_cast<int64_t>(range.size());
+    ++st.next_commit;
+    st.cv.notify_all();
+  }
+  st.done = true;
+  st.cv.notify_all();
+  lk.unlock();
+  for (auto& t : workers) t.join();
+
+  LOG_INFO("Sync") << "committed " << committed << " blocks, chain head "
+                   << chain_.getLastID();
+  return committed;
+}
+
+bool BlockSync::fetchRange(const Source& src, int64_t start, int64_t end,
+                           std::vector<blockchain::Block>* out,
+                           std::string* err) const
+{
+  grpc::ClientContext ctx;
+  ctx.set_deadline(std::chrono::system_clock::now() +
+                   std::chrono::milliseconds(opts_.range_timeout_ms));
+  blockchain::GetBlocksRequest req;
+  req.set_start_id(start);
+  req.set_end_id(end);
+
+  out->clear();
+  out->reserve(static_cast<size_t>(end - start + 1));
+  auto reader = src.stub->GetBlocks(&ctx, req);
+  blockchain::Block blk;
+  bool linked = true;
+  while (reader->Read(&blk)) {
+    int64_t expected = start + static_cast<int64_t>(out->size());
+    if (blk.id() != expected ||
+        (!out->empty() && blk.previous_hash() != out->back().hash())) {
+      linked = false;
+      ctx.TryCancel();
+      break;
+    }
+    out->push_back(std::move(blk));
+  }
+  auto status = reader->Finish();
+  if (!linked) {
+    *err = "block " + std::to_string(start + out->size()) +
+           " does not follow its predecessor";
+    return false;
+  }
+  if (!status.ok()) {
+    *err = status.error_message();
+    return false;
+  }
+  if (out->size() != static_cast<size_t>(end - start + 1)) {
+    *err = "peer sent " + std::to_string(out->size()) + " of " +
+           std::to_string(end - start + 1) + " blocks";
+    return false;
+  }
+  return true;
+}
+
+bool BlockSync::commitRange(const std::vector<blockchain::Block>& range,
+                            std::string* err)
+{
+  if (range.empty()) return true;
+  const auto& first = range.front();
+  if (first.id() != chain_.getLastID() + 1) {
+    *err = "expected block " + std::to_string(chain_.getLastID() + 1) +
+           ", got " + std::to_string(first.id());
+    return false;
+  }
+  if (first.previous_hash() != chain_.getLastHash()) {
+    *err = "previous_hash of block " + std::to_string(first.id()) +
+           " does not match the chain head";
+    return false;
+  }
+
+  std::vector<BlockMeta> metas;
+  std::vector<std::string> ids;
+  metas.reserve(range.size());
+  for (auto& blk : range) {
+    if (!blocks_->Put(blk)) {
+      *err = "could not store block " + std::to_string(blk.id());
+      return false;
+    }
+    metas.push_back({blk.id(), blk.hash(), blk.previous_hash(),
+                     blk.merkle_root()});
+    for (auto& a : blk.audits()) ids.push_back(a.req_id());
+  }
+  chain_.appendBatch(metas);
+  if (mempool_) mempool_->RemoveBatch(ids);
+  return true;
+}
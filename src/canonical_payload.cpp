@@ -0,0 +1,105 @@
+// src/canonical_payload.cpp
+
+#include "canonical_payload.h"
+#include "merkle_tree.h"   // SHA256Hex
+#include <stdexcept>
+
+// Length of the well-formed UTF-8 sequence starting with byte s[i] >= 0x80,
+// or 0 if it is not one (overlong forms, surrogates and code points past
+// U+10FFFF are rejected, as dump() does)
+static size_t Utf8Length(const std::string& s, size_t i) {
+  auto in = [&](size_t k, unsigned char lo, unsigned char hi) {
+    if (k >= s.size()) return false;
+    unsigned char b = static_cast<unsigned char>(s[k]);
+    return b >= lo && b <= hi;
+  };
+  auto tail = [&](size_t n) {
+    for (size_t k = 1; k < n; ++k) if (!in(i + k, 0x80, 0xbf)) return false;
+    return true;
+  };
+  unsigned char c = static_cast<unsigned char>(s[i]);
+  if (c >= 0xc2 && c <= 0xdf) return tail(2) ? 2 : 0;
+  if (c == 0xe0) return in(i + 1, 0xa0, 0xbf) && tail(3) ? 3 : 0;
+  if (c == 0xed) return in(i + 1, 0x80, 0x9f) && tail(3) ? 3 : 0;
+  if (c >= 0xe1 && c <= 0xef) return tail(3) ? 3 : 0;
+  if (c == 0xf0) return in(i + 1, 0x90, 0xbf) && tail(4) ? 4 : 0;
+  if (c == 0xf4) return in(i + 1, 0x80, 0x8f) && tail(4) ? 4 : 0;
+  if (c >= 0xf1 && c <= 0xf3) return tail(4) ? 4 : 0;
+  return 0;
+}
+
+// Same escaping as nlohmann::json::dump() with ensure_ascii = false
+static void AppendString(const std::string& s, std::string* out) {
+  static const char* kHex = "0123456789abcdef";
+  out->push_back('"');
+  size_t run = 0;   // start of the current unescaped run
+  for (size_t i = 0; i < s.size(); ++i) {
+    unsigned char c = static_cast<unsigned char>(s[i]);
+    if (c >= 0x80) {
+      size_t n = Utf8Length(s, i);
+      if (n == 0) {
+        throw std::invalid_argument("invalid UTF-8 byte at index " +
+                                    std::to_string(i));
+      }
+      i += n - 1;
+      continue;
+    }
+    if (c >= 0x20 && c != '"' && c != '\\') continue;
+    out->append(s, run, i - run);
+    run = i + 1;
+    switch (c) {
+      case '"':  out->append("\\\""); break;
+      case '\\': out->append("\\\\"); break;
+      case '\b': out->append("\\b");  break;
+      case '\f': out->append("\\f");  break;
+      case '\n': out->append("\\n");  break;
+      case '\r': out->append("\\r");  break;
+      case '\t': out->append("\\t");  break;
+      default: {
+        char esc[6] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xf]};
+        out->append(esc, sizeof esc);
+      }
+    }
+  }
+  out->append(s, run, s.size() - run);
+  out->push_back('"');
+}
+
+// Decimal without going through a stream or std::to_string temporary
+static void AppendInt(int64_t v, std::string* out) {
+  char buf[24];
+  char* p = buf + sizeof buf;
+  uint64_t u = v < 0 ? 0 - static_cast<uint64_t>(v) : static_cast<uint64_t>(v);
+  do { *--p = static_cast<char>('0' + u % 10); u /= 10; } while (u);
+  if (v < 0) *--p = '-';
+  out->append(p, buf + sizeof buf - p);
+}
+
+void AppendCanonicalPayload(const common::FileAudit& a, std::string* out) {
+  out->append("{\"access_type\":");
+  AppendInt(a.access_type(), out);
+  out->append(",\"file_info\":{\"file_id\":");
+  AppendString(a.file_info().file_id(), out);
+  out->append(",\"file_name\":");
+  AppendString(a.file_info().file_name(), out);
+  out->append("},\"req_id\":");
+  AppendString(a.req_id(), out);
+  out->append(",\"timestamp\":");
+  AppendInt(a.timestamp(), out);
+  out->append(",\"user_info\":{\"user_id\":");
+  AppendString(a.user_info().user_id(), out);
+  out->append(",\"user_name\":");
+  AppendString(a.user_info().user_name(), out);
+  out->append("}}");
+}
+
+std::string CanonicalPayload(const common::FileAudit& audit) {
+  std::string out;
+  out.reserve(128 + audit.file_info().file_name().size());
+  AppendCanonicalPayload(audit, &out);
+  return out;
+}
+
+std::string CanonicalLeafHash(const common::FileAudit& audit) {
+  return SHA256Hex(CanonicalPayload(audit));
+}
@@ -1,75 +1,236 @@
 #include "chain_manager.h"
+#include "logger.h"
+#include "metrics.h"
+#include "storage_format.h"   // ReplaceFile
+#include <algorithm>
 #include <fstream>
-#include <iostream>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
 
+// Checkpoint once the log holds at least this many blocks...
+static constexpr size_t kMinCheckpointInterval = 4096;
+// ...and at least this fraction of what the checkpoint already covers,
+// which keeps total checkpoint I/O linear in the chain length.
+static constexpr size_t kCheckpointRatio = 4;   // log >= checkpoint / 4
+
+// Minimal JSON string escaping (quotes, backslash, control characters).
+static void AppendJsonString(std::string& out, const std::string& s) {
+  static const char* kHex = "0123456789abcdef";
+  out += '"';
+  for (unsigned char c : s) {
+    switch (c) {
+      case '"':  out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n";  break;
+      case '\r': out += "\\r";  break;
+      case '\t': out += "\\t";  break;
+      default:
+        if (c < 0x20) {
+          out += "\\u00";
+          out += kHex[c >> 4];
+          out += kHex[c & 0xf];
+        } else {
+          out += static_cast<char>(c);
+        }
+    }
+  }
+  out += '"';
+}
+
+// One compact JSON object per block, shared by checkpoint and log.
+static std::string EncodeMeta(const BlockMeta& m) {
+  std::string out = "{\"id\":" + std::to_string(m.id) + ",\"hash\":";
+  AppendJsonString(out, m.hash);
+  out += ",\"previous_hash\":";
+  AppendJsonString(out, m.previous_hash);
+  out += ",\"merkle_root\":";
+  AppendJsonString(out, m.merkle_root);
+  out += '}';
+  return out;
+}
+
+static BlockMeta DecodeMeta(const json& el) {
+  BlockMeta m;
+  m.id            = el.value("id", 0LL);
+  m.hash          = el.value("hash", std::string());
+  m.previous_hash = el.value("previous_hash", std::string());
+  m.merkle_root   = el.value("merkle_root", std::string());
+  return m;
+}
+
 ChainManager::ChainManager(std::string path)
   : path_(std::move(path))
+  , log_path_(path_ + ".log")
 {
   loadFromDisk();
+  if (!log_.is_open()) log_.open(log_path_, std::ios::app);
+  if (!log_) {
+    LOG_ERROR("ChainManager") << "cannot open " << log_path_;
+  }
 }
 
 void ChainManager::loadFromDisk() {
-  std::lock_guard<std::mutex> lk(mu_);
-  blocks_.clear();
-  std::ifstream in(path_);
-  if (!in) return;  // no file yet
-
-  json j;
-  try {
-    in >> j;
-    if (!j.is_array()) {
-      std::cerr << "[ChainManager] ERROR: chain.json not an array\n";
-      return;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    blocks_.clear();
+    std::ifstream in(path_);
+    // no file yet, or an empty one: fresh chain
+    if (in && in.peek() != std::ifstream::traits_type::eof()) {
+      json j;
+      try {
+        in >> j;
+        if (!j.is_array()) {
+          LOG_ERROR("ChainManager") << "chain.json not an array";
+        } else {
+          blocks_.reserve(j.size());
+          for (auto& el : j) blocks_.push_back(DecodeMeta(el));
+        }
+      } catch (const std::exception& e) {
+        LOG_ERROR("ChainManager") << "cannot parse chain.json: "
+                                  << e.what();
+      }
     }
-    for (auto& el : j) {
+    checkpointed_ = blocks_.size();
+  }
+  replayLog();
+  std::lock_guard<std::mutex> lk(mu_);
+  if (!blocks_.empty()) publishHead(blocks_.back());
+}
+
+// Replay the tail written since the last checkpoint
+void ChainManager::replayLog() {
+  std::ifstream in(log_path_);
+  if (!in) return;
+
+  bool torn = false;
+  size_t replayed = 0;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    std::string line;
+    while (std::getline(in, line)) {
+      if (line.find_first_not_of(" \t\r\n") == std::string::npos) continue;
       BlockMeta m;
-      m.id            = el.value("id", 0LL);
-      m.hash          = el.value("hash", std::string());
-      m.previous_hash = el.value("previous_hash", std::string());
-      m.merkle_root   = el.value("merkle_root", std::string());
+      try {
+        m = DecodeMeta(json::parse(line));
+      } catch (const std::exception& e) {
+        LOG_ERROR("ChainManager") << "cannot parse " << log_path_ << ": "
+                                  << e.what();
+        torn = true;
+        break;
+      }
+      // Skip records already covered by the checkpoint
+      if (!blocks_.empty() && m.id <= blocks_.back().id) continue;
       blocks_.push_back(std::move(m));
+      ++replayed;
     }
-  } catch (const std::exception& e) {
-    std::cerr << "[ChainManager] ERROR parsing chain.json: "
-              << e.what() << "\n";
+  }
+
+  // A torn record would corrupt the next append: fold everything into a
+  // fresh checkpoint instead of appending behind it.
+  if (torn) {
+    std::lock_guard<std::mutex> io(io_mu_);
+    writeCheckpoint();
+  }
+  if (replayed) {
+    LOG_INFO("ChainManager") << "replayed " << replayed
+                             << " blocks from " << log_path_;
   }
 }
 
-void ChainManager::writeToDisk() const {
-  std::lock_guard<std::mutex> lk(mu_);
-  json j = json::array();
-  for (auto const& m : blocks_) {
-    j.push_back({
-      {"id",             m.id},
-      {"hash",           m.hash},
-      {"previous_hash",  m.previous_hash},
-      {"merkle_root",    m.merkle_root}
-    });
+// Write newline-terminated records and flush once (caller holds io_mu_)
+void ChainManager::writeLogRecords(const std::string& lines) {
+  static auto& latency = MetricsRegistry::Shared().GetHistogram(
+    "chain_log_write_seconds", "chain.json.log appends (write + flush)");
+  ScopedLatency timer(latency);
+
+  if (!log_) {
+    LOG_ERROR("ChainManager") << "cannot write " << log_path_;
+    return;
+  }
+  log_ << lines;
+  log_.flush();
+}
+
+// Checkpoint if the log tail has grown enough (caller holds io_mu_)
+void ChainManager::maybeCheckpoint(size_t total) {
+  size_t tail = total - checkpointed_;
+  if (tail >= std::max(kMinCheckpointInterval,
+                       checkpointed_ / kCheckpointRatio)) {
+    writeCheckpoint();
   }
-  std::ofstream out(path_, std::ios::trunc);
-  if (!out) {
-    std::cerr << "[ChainManager] ERROR opening " << path_ << "\n";
+}
+
+// Rewrite chain.json with every block, then restart the log (caller holds io_mu_)
+void ChainManager::writeCheckpoint() {
+  static auto& latency = MetricsRegistry::Shared().GetHistogram(
+    "chain_checkpoint_seconds", "chain.json rewrites (checkpoint + fsync)");
+  ScopedLatency timer(latency);
+
+  std::vector<BlockMeta> snapshot;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    snapshot = blocks_;
+  }
+
+  const std::string tmp = path_ + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::trunc);
+    if (!out) {
+      LOG_ERROR("ChainManager") << "cannot open " << tmp;
+      return;
+    }
+    out << "[\n";
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+      out << "  " << EncodeMeta(snapshot[i])
+          << (i + 1 < snapshot.size() ? ",\n" : "\n");
+    }
+    out << "]\n";
+    if (!out) {
+      LOG_ERROR("ChainManager") << "cannot write " << tmp;
+      return;
+    }
+  }
+  // The log may only restart once the checkpoint is durably in place;
+  // until then replay skips whatever the checkpoint already covers.
+  if (!ReplaceFile(tmp, path_)) {
+    LOG_ERROR("ChainManager") << "cannot commit checkpoint " << path_;
     return;
   }
-  out << j.dump(2) << "\n";
+
+  // Everything in the log is now in the checkpoint
+  log_.close();
+  log_.open(log_path_, std::ios::trunc);
+  if (!log_) {
+    LOG_ERROR("ChainManager") << "cannot reopen " << log_path_;
+    return;
+  }
+  checkpointed_ = snapshot.size();
+}
+
+// Swap in a new head for readers (caller holds io_mu_, or is the constructor)
+void ChainManager::publishHead(const BlockMeta& last) {
+  std::atomic_store_explicit(&head_, std::make_shared<const BlockMeta>(last),
+                             std::memory_order_release);
+}
+
+std::shared_ptr<const BlockMeta> ChainManager::getHead() const {
+  return std::atomic_load_explicit(&head_, std::memory_order_acquire);
 }
 
 int64_t ChainManager::getLastID() const {
-  std::lock_guard<std::mutex> lk(mu_);
-  return blocks_.empty() ? -1 : blocks_.back().id;
+  auto head = getHead();
+  return head ? head->id : -1;
 }
 
 std::string ChainManager::getLastHash() const {
-  std::lock_guard<std::mutex> lk(mu_);
-  return blocks_.empty() ? "" : blocks_.back().hash;
+  auto head = getHead();
+  return head ? head->hash : "";
 }
 
 std::string ChainManager::getLastMerkleRoot() const {
-  std::lock_guard<std::mutex> lk(mu_);
-  return blocks_.empty() ? "" : blocks_.back().merkle_root;
+  auto head = getHead();
+  return head ? head->merkle_root : "";
 }
 
 std::vector<BlockMeta> ChainManager::getAll() const {
@@ -77,10 +238,41 @@ std::vector<BlockMeta> ChainManager::getAll() const {
   return blocks_;
 }
 
+std::vector<BlockMeta> ChainManager::getRange(int64_t from, int64_t to) const {
+  std::lock_guard<std::mutex> lk(mu_);
+  auto first = std::lower_bound(blocks_.begin(), blocks_.end(), from,
+    [](const BlockMeta& m, int64_t id) { return m.id < id; });
+  auto last = first;
+  while (last != blocks_.end() && last->id <= to) ++last;
+  return std::vector<BlockMeta>(first, last);
+}
+
 void ChainManager::append(const BlockMeta& meta) {
+  std::lock_guard<std::mutex> io(io_mu_);
+  size_t total;
   {
     std::lock_guard<std::mutex> lk(mu_);
     blocks_.push_back(meta);
+    total = blocks_.size();
+  }
+  publishHead(meta);
+  writeLogRecords(EncodeMeta(meta) + "\n");
+  maybeCheckpoint(total);
+}
+
+void ChainManager::appendBatch(const std::vector<BlockMeta>& metas) {
+  if (metas.empty()) return;
+  std::string lines;
+  for (auto& m : metas) lines += EncodeMeta(m) + "\n";
+
+  std::lock_guard<std::mutex> io(io_mu_);
+  size_t total;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    blocks_.insert(blocks_.end(), metas.begin(), metas.end());
+    total = blocks_.size();
   }
-  writeToDisk();
+  publishHead(metas.back());
+  writeLogRecords(lines);
+  maybeCheckpoint(total);
 }
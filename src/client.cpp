@@ -2,6 +2,7 @@
 
 #include "file_audit.grpc.pb.h"    // fileaudit::FileAuditService, FileAuditResponse
 #include "common.grpc.pb.h"        // common::FileAudit
+#include "signature_verifier.h"    // KeyFingerprint
 #include <grpcpp/grpcpp.h>
 
 #include <openssl/pem.h>
@@ -10,9 +11,16 @@
 #include <openssl/buffer.h>
 
 #include <nlohmann/json.hpp>       // for ordered_json
-#include <iostream>
-#include <fstream>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
 #include <vector>
 
 using ordered_json = nlohmann::ordered_json;
@@ -38,11 +46,8 @@ static std::string Slurp(const std::string& path) {
   return {std::istreambuf_iterator<char>(in), {}};
 }
 
-// Sign data with SHA256+RSA using a PEM private key
-static std::vector<unsigned char> SignData(
-    const std::string& data,
-    const std::string& privkey_pem_path) 
-{
+// Load a PEM private key once (exits on failure)
+static EVP_PKEY* LoadPrivateKey(const std::string& privkey_pem_path) {
   auto pem = Slurp(privkey_pem_path);
   BIO* bio = BIO_new_mem_buf(pem.data(), (int)pem.size());
   EVP_PKEY* pkey = PEM_read_bio_PrivateKey(bio, nullptr, nullptr, nullptr);
@@ -51,7 +56,14 @@ static std::vector<unsigned char> SignData(
     std::cerr << "ERROR loading private key\n";
     exit(1);
   }
+  return pkey;
+}
 
+// Sign data with SHA256+RSA
+static std::vector<unsigned char> SignData(
+    const std::string& data,
+    EVP_PKEY* pkey)
+{
   EVP_MD_CTX* ctx = EVP_MD_CTX_new();
   EVP_DigestSignInit(ctx, nullptr, EVP_sha256(), nullptr, pkey);
   EVP_DigestSignUpdate(ctx, data.data(), data.size());
@@ -62,11 +74,31 @@ static std::vector<unsigned char> SignData(
   sig.resize(sig_len);
 
   EVP_MD_CTX_free(ctx);
-  EVP_PKEY_free(pkey);
   return sig;
 }
 
-int main(int argc, char** argv) {
+// Canonical JSON with sorted keys (what the server verifies)
+static std::string CanonicalPayload(const common::FileAudit& req) {
+  ordered_json j;
+  j["access_type"]       = req.access_type();
+  j["file_info"]         = {{"file_id", req.file_info().file_id()},
+                            {"file_name", req.file_info().file_name()}};
+  j["req_id"]            = req.req_id();
+  j["timestamp"]         = req.timestamp();
+  j["user_info"]         = {{"user_id", req.user_info().user_id()},
+                            {"user_name", req.user_info().user_name()}};
+  return j.dump();
+}
+
+static int64_t NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch()
+         ).count();
+}
+
+// -- Smoke test (no flags) ---------------------------------------------------
+
+static int RunSmokeTest(const std::string& addr) {
   // 1) Build your audit
   common::FileAudit req;
   req.set_req_id("smoke1");
@@ -75,36 +107,21 @@ int main(int argc, char** argv) {
   req.mutable_user_info()->set_user_id("user42");
   req.mutable_user_info()->set_user_name("alice");
   req.set_access_type(common::READ);
-  int64_t ts = std::chrono::duration_cast<std::chrono::milliseconds>(
-                   std::chrono::system_clock::now().time_since_epoch()
-               ).count();
-  req.set_timestamp(ts);
+  req.set_timestamp(NowMs());
 
   // 2) Canonical JSON with sorted keys
-  ordered_json j;
-  j["access_type"]       = req.access_type();
-  j["file_info"]         = {{"file_id", req.file_info().file_id()},
-                            {"file_name", req.file_info().file_name()}};
-  j["req_id"]            = req.req_id();
-  j["timestamp"]         = req.timestamp();
-  j["user_info"]         = {{"user_id", req.user_info().user_id()},
-                            {"user_name", req.user_info().user_name()}};
-
-  std::string payload = j.dump(); 
+  std::string payload = CanonicalPayload(req);
   std::cout << "[client] payload = " << payload << "\n";
 
   // 3) Sign
-  auto sig = SignData(payload, "../keys/client_private.pem");
+  EVP_PKEY* pkey = LoadPrivateKey("../keys/client_private.pem");
+  auto sig = SignData(payload, pkey);
+  EVP_PKEY_free(pkey);
   req.set_signature(Base64Encode(sig.data(), sig.size()));
 
   // 4) Attach public key
   req.set_public_key(Slurp("../keys/client_public.pem"));
 
-  std::string addr = "0.0.0.0:50051";
-  if (argc > 1) {
-    addr = argv[1];
-  }
-
   // 5) Send
   auto channel = grpc::CreateChannel(
       addr, grpc::InsecureChannelCredentials());
@@ -122,3 +139,361 @@ int main(int argc, char** argv) {
             << ", status="  << resp.status()  << "\n";
   return 0;
 }
+
+// -- Load generator (--flags) ------------------------------------------------
+
+struct LoadOptions {
+  std::string addr        = "0.0.0.0:50051";
+  std::string mode        = "stream";   // "stream" (SubmitAudits) or "unary"
+  int         concurrency = 4;          // workers, one channel + stream each
+  double      rate        = 0;          // audits/s over all workers; 0 = max
+  size_t      payload     = 64;         // approx. bytes of file_name
+  int         keys        = 1000;       // distinct file/user ids
+  double      duration    = 10;         // seconds
+  int         window      = 256;        // in-flight audits per stream
+  bool        key_id      = false;      // key_id instead of PEM once accepted
+};
+
+static void Usage() {
+  std::cerr <<
+    "usage: client [addr]                      send one smoke-test audit\n"
+    "       client --addr=host:port [options]  run a load test\n"
+    "  --mode=stream|unary   SubmitAudits stream or SubmitAudit calls (stream)\n"
+    "  --concurrency=N       parallel workers (4)\n"
+    "  --rate=N              target audits/s in total, 0 = unlimited (0)\n"
+    "  --payload=BYTES       size of the file_name field (64)\n"
+    "  --keys=N              distinct file/user ids (1000)\n"
+    "  --duration=SECONDS    run time (10)\n"
+    "  --window=N            max unacked audits per stream (256)\n"
+    "  --key-id=0|1          send key_id instead of the PEM after the first\n"
+    "                        accepted audit (0)\n";
+}
+
+static bool ParseLoadOptions(int argc, char** argv, LoadOptions* o) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    auto eq = arg.find('=');
+    if (arg.rfind("--", 0) != 0 || eq == std::string::npos) return false;
+    std::string key = arg.substr(2, eq - 2), val = arg.substr(eq + 1);
+    try {
+      if      (key == "addr")        o->addr        = val;
+      else if (key == "mode")        o->mode        = val;
+      else if (key == "concurrency") o->concurrency = std::stoi(val);
+      else if (key == "rate")        o->rate        = std::stod(val);
+      else if (key == "payload")     o->payload     = std::stoul(val);
+      else if (key == "keys")        o->keys        = std::stoi(val);
+      else if (key == "duration")    o->duration    = std::stod(val);
+      else if (key == "window")      o->window      = std::stoi(val);
+      else if (key == "key-id")      o->key_id      = std::stoi(val) != 0;
+      else return false;
+    } catch (const std::exception&) {
+      return false;
+    }
+  }
+  return (o->mode == "stream" || o->mode == "unary") &&
+         o->concurrency > 0 && o->keys > 0 && o->window > 0 &&
+         o->duration > 0 && o->rate >= 0;
+}
+
+// Per-worker results; latencies in microseconds
+struct WorkerStats {
+  uint64_t              sent = 0;
+  uint64_t              ok = 0;
+  uint64_t              failed = 0;
+  uint64_t              refused = 0;   // shed by admission control
+  std::vector<uint32_t> latency_us;
+};
+
+// Builds signed audits for one worker
+class AuditFactory {
+public:
+  AuditFactory(const LoadOptions& o, int worker, EVP_PKEY* pkey,
+               const std::string& pubkey, const std::string& key_id,
+               const std::string& run_id)
+    : o_(o), pkey_(pkey), pubkey_(pubkey), key_id_(key_id)
+    , prefix_(run_id + "-" + std::to_string(worker) + "-")
+    , padding_(o.payload, 'x')
+    , rng_(std::random_device{}() + worker) {}
+
+  common::FileAudit Next() {
+    int key = static_cast<int>(rng_() % o_.keys);
+    common::FileAudit a;
+    a.set_req_id(prefix_ + std::to_string(seq_++));
+    a.mutable_file_info()->set_file_id("file" + std::to_string(key));
+    a.mutable_file_info()->set_file_name(padding_);
+    a.mutable_user_info()->set_user_id("user" + std::to_string(key));
+    a.mutable_user_info()->set_user_name("load");
+    a.set_access_type(static_cast<common::AccessType>(1 + seq_ % 4));
+    a.set_timestamp(NowMs());
+    auto sig = SignData(CanonicalPayload(a), pkey_);
+    a.set_signature(Base64Encode(sig.data(), sig.size()));
+    if (o_.key_id && key_known_.load(std::memory_order_relaxed)) {
+      a.set_key_id(key_id_);
+    } else {
+      a.set_public_key(pubkey_);
+    }
+    return a;
+  }
+
+  // The leader accepted an audit, so it has interned our key
+  void Accepted() {
+    if (!key_refused_.load(std::memory_order_relaxed)) {
+      key_known_.store(true, std::memory_order_relaxed);
+    }
+  }
+
+  // The node refused `a`'s key_id: it lost the key or does not intern
+  // keys. Attach the PEM for the resend, and from now on.
+  void KeyUnknown(common::FileAudit* a) {
+    key_refused_.store(true, std::memory_order_relaxed);
+    key_known_.store(false, std::memory_order_relaxed);
+    a->set_public_key(pubkey_);
+  }
+
+private:
+  const LoadOptions& o_;
+  EVP_PKEY*          pkey_;
+  const std::string& pubkey_;
+  const std::string& key_id_;
+  std::atomic<bool>  key_known_{false};
+  std::atomic<bool>  key_refused_{false};
+  std::string        prefix_;
+  std::string        padding_;
+  std::mt19937_64    rng_;
+  uint64_t           seq_ = 0;
+};
+
+using Clock = std::chrono::steady_clock;
+
+// Open-loop pacing: the n-th send of a worker is due at start + n * interval
+class Pacer {
+public:
+  Pacer(const LoadOptions& o, Clock::time_point start)
+    : start_(start)
+    , interval_(o.rate > 0 ? std::chrono::duration<double>(o.concurrency / o.rate)
+                           : std::chrono::duration<double>(0)) {}
+
+  void Wait() {
+    if (interval_.count() > 0) {
+      std::this_thread::sleep_until(start_ + std::chrono::duration_cast<
+        Clock::duration>(interval_ * static_cast<double>(n_)));
+    }
+    ++n_;
+  }
+
+private:
+  Clock::time_point             start_;
+  std::chrono::duration<double> interval_;
+  uint64_t                      n_ = 0;
+};
+
+static uint32_t MicrosSince(Clock::time_point t) {
+  return static_cast<uint32_t>(std::chrono::duration_cast<
+    std::chrono::microseconds>(Clock::now() - t).count());
+}
+
+static void RunUnaryWorker(const LoadOptions& o, AuditFactory& factory,
+                           Clock::time_point start, Clock::time_point end,
+                           WorkerStats* stats) {
+  auto stub = fileaudit::FileAuditService::NewStub(
+    grpc::CreateChannel(o.addr, grpc::InsecureChannelCredentials()));
+  Pacer pacer(o, start);
+  while (Clock::now() < end) {
+    pacer.Wait();
+    auto audit = factory.Next();
+    fileaudit::FileAuditResponse resp;
+    grpc::Status status;
+    auto t0 = Clock::now();
+    for (;;) {
+      grpc::ClientContext ctx;
+      status = stub->SubmitAudit(&ctx, audit, &resp);
+      if (status.error_code() != grpc::StatusCode::FAILED_PRECONDITION ||
+          !audit.public_key().empty()) {
+        break;
+      }
+      factory.KeyUnknown(&audit);   // resend with the PEM
+    }
+    stats->latency_us.push_back(MicrosSince(t0));
+    ++stats->sent;
+    if (status.error_code() == grpc::StatusCode::RESOURCE_EXHAUSTED) {
+      ++stats->refused;
+    } else {
+      bool ok = status.ok() && resp.status() == "success";
+      if (ok) factory.Accepted();
+      ++(ok ? stats->ok : stats->failed);
+    }
+  }
+}
+
+static void RunStreamWorker(const LoadOptions& o, AuditFactory& factory,
+                            Clock::time_point start, Clock::time_point end,
+                            WorkerStats* stats) {
+  auto stub = fileaudit::FileAuditService::NewStub(
+    grpc::CreateChannel(o.addr, grpc::InsecureChannelCredentials()));
+  grpc::ClientContext ctx;
+  auto stream = stub->SubmitAudits(&ctx);
+
+  // Acks arrive in send order, so the reader pops sends FIFO. An audit
+  // sent by key_id is kept, so it can be resent with its PEM if refused.
+  struct Sent {
+    Clock::time_point t0;
+    common::FileAudit by_key_id;
+  };
+  std::mutex mu;
+  std::condition_variable cv;
+  std::deque<Sent> inflight;
+  std::deque<common::FileAudit> resend;   // written before new audits
+  bool closed = false;   // the server ended or broke the stream
+
+  std::thread reader([&] {
+    fileaudit::FileAuditResponse ack;
+    while (stream->Read(&ack)) {
+      Clock::time_point t0;
+      bool resending = false;
+      {
+        std::lock_guard<std::mutex> lk(mu);
+        if (inflight.empty()) continue;
+        Sent s = std::move(inflight.front());
+        inflight.pop_front();
+        t0 = s.t0;
+        if (ack.unknown_key_id() && !s.by_key_id.key_id().empty()) {
+          factory.KeyUnknown(&s.by_key_id);
+          resend.push_back(std::move(s.by_key_id));
+          resending = true;
+        }
+      }
+      cv.notify_one();
+      if (resending) continue;   // its ack is still to come
+      stats->latency_us.push_back(MicrosSince(t0));
+      if (ack.retry_after_ms() > 0) {
+        ++stats->refused;
+      } else {
+        bool ok = ack.status() == "success";
+        if (ok) factory.Accepted();
+        ++(ok ? stats->ok : stats->failed);
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lk(mu);
+      closed = true;
+    }
+    cv.notify_all();
+  });
+
+  Pacer pacer(o, start);
+  while (Clock::now() < end) {
+    common::FileAudit audit;
+    bool retry = false;
+    {
+      std::lock_guard<std::mutex> lk(mu);
+      if (!resend.empty()) {
+        audit = std::move(resend.front());
+        resend.pop_front();
+        retry = true;
+      }
+    }
+    if (!retry) {
+      pacer.Wait();
+      audit = factory.Next();
+    }
+    {
+      std::unique_lock<std::mutex> lk(mu);
+      // A full window is only waited out until the stream closes or the
+      // run ends; no ack will come after either
+      cv.wait_until(lk, end, [&]{
+        return closed || (int)inflight.size() < o.window;
+      });
+      if (closed || (int)inflight.size() >= o.window) break;
+      inflight.push_back({Clock::now(), audit.public_key().empty()
+                                          ? audit : common::FileAudit{}});
+    }
+    if (!stream->Write(audit)) break;
+    if (!retry) ++stats->sent;   // a resend is the same audit
+  }
+  stream->WritesDone();
+  reader.join();
+  auto status = stream->Finish();
+  if (!status.ok()) {
+    std::cerr << "[client] stream failed: " << status.error_message() << "\n";
+  }
+  stats->failed += stats->sent - stats->ok - stats->failed -
+                   stats->refused;                           // never acked
+}
+
+static int RunLoadTest(const LoadOptions& o) {
+  EVP_PKEY* pkey = LoadPrivateKey("../keys/client_private.pem");
+  std::string pubkey = Slurp("../keys/client_public.pem");
+  std::string key_id = KeyFingerprint(pubkey);
+  std::string run_id = "load" + std::to_string(NowMs());
+
+  std::cout << "[client] " << o.mode << " load test against " << o.addr
+            << ": concurrency=" << o.concurrency
+            << " rate=" << (o.rate > 0 ? std::to_string((int64_t)o.rate) : "max")
+            << " payload=" << o.payload << "B keys=" << o.keys
+            << " duration=" << o.duration << "s"
+            << (o.key_id ? " key-id" : "") << "\n";
+
+  std::vector<std::unique_ptr<AuditFactory>> factories;
+  std::vector<WorkerStats> stats(o.concurrency);
+  for (int w = 0; w < o.concurrency; ++w) {
+    factories.push_back(
+      std::make_unique<AuditFactory>(o, w, pkey, pubkey, key_id, run_id));
+  }
+
+  auto start = Clock::now();
+  auto end   = start + std::chrono::duration_cast<Clock::duration>(
+                 std::chrono::duration<double>(o.duration));
+  std::vector<std::thread> workers;
+  for (int w = 0; w < o.concurrency; ++w) {
+    workers.emplace_back([&, w] {
+      if (o.mode == "unary") {
+        RunUnaryWorker(o, *factories[w], start, end, &stats[w]);
+      } else {
+        RunStreamWorker(o, *factories[w], start, end, &stats[w]);
+      }
+    });
+  }
+  for (auto& t : workers) t.join();
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+  EVP_PKEY_free(pkey);
+
+  // Merge and report
+  WorkerStats total;
+  for (auto& s : stats) {
+    total.sent += s.sent;
+    total.ok += s.ok;
+    total.failed += s.failed;
+    total.refused += s.refused;
+    total.latency_us.insert(total.latency_us.end(),
+                            s.latency_us.begin(), s.latency_us.end());
+  }
+  std::sort(total.latency_us.begin(), total.latency_us.end());
+  auto pct = [&](double p) -> double {
+    if (total.latency_us.empty()) return 0;
+    size_t i = static_cast<size_t>(p / 100.0 * (total.latency_us.size() - 1));
+    return total.latency_us[i] / 1000.0;
+  };
+
+  std::cout << std::fixed << std::setprecision(2)
+            << "[client] sent=" << total.sent << " ok=" << total.ok
+            << " failed=" << total.failed << " refused=" << total.refused
+            << " in " << elapsed << "s\n"
+            << "[client] throughput=" << total.ok / elapsed << " audits/s\n"
+            << "[client] latency ms: p50=" << pct(50) << " p99=" << pct(99)
+            << " p999=" << pct(99.9) << " max=" << pct(100) << "\n";
+  return total.failed == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+  // No flags (or just an address): the original one-audit smoke test
+  if (argc <= 2 && (argc == 1 || std::string(argv[1]).rfind("--", 0) != 0)) {
+    return RunSmokeTest(argc > 1 ? argv[1] : "0.0.0.0:50051");
+  }
+
+  LoadOptions opts;
+  if (!ParseLoadOptions(argc, argv, &opts)) {
+    Usage();
+    return 2;
+  }
+  return RunLoadTest(opts);
+}
@@ -0,0 +1,72 @@
+// src/compact_block.cpp
+
+#include "compact_block.h"
+#include <unordered_map>
+#include <unordered_set>
+
+static blockchain::Block Header(const blockchain::Block& full) {
+  blockchain::Block b;
+  b.set_id(full.id());
+  b.set_hash(full.hash());
+  b.set_previous_hash(full.previous_hash());
+  b.set_merkle_root(full.merkle_root());
+  return b;
+}
+
+blockchain::Block CompactProposal(const blockchain::Block& full) {
+  blockchain::Block b = Header(full);
+  b.mutable_audit_ids()->Reserve(full.audits_size());
+  for (auto& a : full.audits()) b.add_audit_ids(a.req_id());
+  return b;
+}
+
+blockchain::Block CompactCommit(const blockchain::Block& full) {
+  blockchain::Block b;
+  b.set_id(full.id());
+  b.set_hash(full.hash());
+  return b;
+}
+
+blockchain::Block WithAudits(
+    const blockchain::Block& compact, const blockchain::Block& full,
+    const google::protobuf::RepeatedPtrField<std::string>& ids) {
+  std::unordered_set<std::string> wanted(ids.begin(), ids.end());
+  blockchain::Block b = compact;
+  b.clear_audits();
+  for (auto& a : full.audits()) {
+    if (wanted.count(a.req_id())) *b.add_audits() = a;
+  }
+  return b;
+}
+
+bool ExpandProposal(const blockchain::Block& compact,
+                    const MempoolManager& mempool,
+                    blockchain::Block* full,
+                    std::vector<std::string>* missing) {
+  std::unordered_map<std::string, const common::FileAudit*> carried;
+  for (auto& a : compact.audits()) carried.emplace(a.req_id(), &a);
+
+  std::vector<std::string> lookup;
+  for (auto& id : compact.audit_ids()) {
+    if (!carried.count(id)) lookup.push_back(id);
+  }
+  auto pending = mempool.Find(lookup);
+
+  *full = Header(compact);
+  full->mutable_audits()->Reserve(compact.audit_ids_size());
+  size_t next = 0;
+  for (auto& id : compact.audit_ids()) {
+    auto it = carried.find(id);
+    if (it != carried.end()) {
+      *full->add_audits() = *it->second;
+      continue;
+    }
+    auto& p = pending[next++];
+    if (p.leaf_hash.empty()) {
+      missing->push_back(id);
+    } else {
+      *full->add_audits() = std::move(p.audit);
+    }
+  }
+  return missing->empty();
+}
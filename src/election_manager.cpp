@@ -1,5 +1,6 @@
 #include "election_manager.h"
-#include <iostream>
+#include "logger.h"
+#include "rpc_fanout.h"
 
 ElectionManager::ElectionManager(
     const std::vector<std::string>& peers,
@@ -8,12 +9,25 @@ ElectionManager::ElectionManager(
     ElectionState& state,
     std::shared_ptr<MempoolManager> mempool,
     ChainManager& chain
+)
+  : ElectionManager(peers, self_addr, std::move(hb_table), state,
+                    std::move(mempool), chain, Options{}) {}
+
+ElectionManager::ElectionManager(
+    const std::vector<std::string>& peers,
+    const std::string& self_addr,
+    std::shared_ptr<HeartbeatTable> hb_table,
+    ElectionState& state,
+    std::shared_ptr<MempoolManager> mempool,
+    ChainManager& chain,
+    Options opts
 )
   : self_addr_(self_addr)
   , hb_table_(std::move(hb_table))
   , state_(state)
   , mempool_(std::move(mempool))
   , chain_(chain)
+  , opts_(opts)
 {
   for (auto& addr : peers) {
     auto chan = grpc::CreateChannel(addr, grpc::InsecureChannelCredentials());
@@ -34,12 +48,21 @@ void ElectionManager::start() {
 }
 
 void ElectionManager::stop() {
-  running_ = false;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    running_ = false;
+  }
+  cv_.notify_all();
   if (thr_.joinable()) thr_.join();
 }
 
+void ElectionManager::sleepFor(std::chrono::milliseconds d) {
+  std::unique_lock<std::mutex> lk(mu_);
+  cv_.wait_for(lk, d, [&]{ return !running_; });
+}
+
 void ElectionManager::loop() {
-  std::this_thread::sleep_for(std::chrono::seconds(30));
+  sleepFor(opts_.initial_delay);
   while (running_) {
     // 1) sweep stale heartbeats
     hb_table_->sweep();
@@ -55,57 +78,93 @@ void ElectionManager::loop() {
       }();
 
     if (needElection) {
-      std::cout << "[ElectionManager] triggering election\n";
-
-      // 2) vote for self
-      int votesAccept = 1, votesReject = 0;
-
-      // 3) ask others
-      for (size_t i = 0; i < stubs_.size(); ++i) {
-        grpc::ClientContext ctx;
-        ctx.set_deadline(std::chrono::system_clock::now() +
-                         std::chrono::seconds(1));
-        blockchain::TriggerElectionRequest req;
-        req.set_term(0);  // unused
-        req.set_address(self_addr_);
-        blockchain::TriggerElectionResponse resp;
-
-        auto status = stubs_[i]->TriggerElection(&ctx, req, &resp);
-        if (resp.vote()) {
-          votesAccept++;
-          std::cout << "[ElectionManager] got vote from " << peer_addrs_[i]
-                    << "\n";
-        } else if(resp.vote() == false && status.ok()) {
-          votesReject++;
-          std::cout << "[ElectionManager] no vote from " << peer_addrs_[i]
-                    << ": " << status.error_message() << "\n";
-        }
+      // 2) collect votes
+      LOG_INFO("ElectionManager") << "triggering election";
+      auto t0 = std::chrono::steady_clock::now();
+
+      if (runElection()) {
+        state_.setLeader(self_addr_);
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - t0).count();
+        LOG_INFO("ElectionManager") << "I won election, leader=" << self_addr_
+                                    << " (" << ms << " ms)";
+
+        // 3) notify all peers; nothing to wait for
+        auto req = std::make_shared<blockchain::NotifyLeadershipRequest>();
+        req->set_address(self_addr_);
+        FanOut<blockchain::NotifyLeadershipResponse>(
+          stubs_.size(), 0, opts_.rpc_timeout,
+          [this, req](size_t i, grpc::ClientContext* ctx,
+                      blockchain::NotifyLeadershipResponse* resp,
+                      std::function<void(grpc::Status)> done) {
+            stubs_[i]->async()->NotifyLeadership(ctx, req.get(), resp,
+              [req, done = std::move(done)](grpc::Status s) {
+                done(std::move(s));
+              });
+          },
+          [](size_t, const grpc::Status&,
+             const blockchain::NotifyLeadershipResponse&,
+             std::chrono::microseconds) { return true; });
       }
+    }
 
-      std::cout << "[ElectionManager] votes: " << votesAccept
-           << " accept, " << votesReject << " reject\n";
+    sleepFor(opts_.interval);
+  }
+}
 
-      // 4) if won majority
-      if (votesAccept >= votesReject) {
-        state_.setLeader(self_addr_);
-        std::cout << "[ElectionManager] I won election, leader=" << self_addr_ << "\n";
-
-        // 5) notify all peers
-        for (size_t i = 0; i < stubs_.size(); ++i) {
-          grpc::ClientContext ctx;
-          ctx.set_deadline(std::chrono::system_clock::now() +
-                           std::chrono::seconds(1));
-          blockchain::NotifyLeadershipRequest req2;
-          req2.set_address(self_addr_);
-          blockchain::NotifyLeadershipResponse resp2;
-          stubs_[i]->NotifyLeadership(&ctx, req2, &resp2);
-        }
+bool ElectionManager::runElection() {
+  // Vote for self; a majority of the whole cluster must say yes, so
+  // members / 2 peers are needed besides our own vote
+  size_t members = stubs_.size() + 1;
+  size_t needed  = members / 2;
+
+  auto req = std::make_shared<blockchain::TriggerElectionRequest>();
+  req->set_term(0);  // unused
+  req->set_address(self_addr_);
+
+  // Counted by the callbacks, which may outlive this call
+  struct Votes {
+    std::mutex mu;
+    int        accept = 1, reject = 0;
+  };
+  auto votes = std::make_shared<Votes>();
+  auto addrs = std::make_shared<std::vector<std::string>>(peer_addrs_);
+
+  // Ask the others, all at once
+  bool won = FanOut<blockchain::TriggerElectionResponse>(
+    stubs_.size(), needed, opts_.rpc_timeout,
+    [this, req](size_t i, grpc::ClientContext* ctx,
+                blockchain::TriggerElectionResponse* resp,
+                std::function<void(grpc::Status)> done) {
+      stubs_[i]->async()->TriggerElection(ctx, req.get(), resp,
+        [req, done = std::move(done)](grpc::Status s) { done(std::move(s)); });
+    },
+    [votes, addrs](size_t i, const grpc::Status& status,
+                   const blockchain::TriggerElectionResponse& resp,
+                   std::chrono::microseconds) {
+      std::lock_guard<std::mutex> lk(votes->mu);
+      if (status.ok() && resp.vote()) {
+        votes->accept++;
+        LOG_DEBUG("ElectionManager") << "got vote from " << (*addrs)[i];
+        return true;
+      }
+      if (status.ok()) {
+        votes->reject++;
+        LOG_DEBUG("ElectionManager") << "no vote from " << (*addrs)[i];
       } else {
-        std::cout << "[ElectionManager] lost election (" << votesAccept
-                  << "/" << peer_addrs_.size() << ")\n";
+        LOG_DEBUG("ElectionManager") << (*addrs)[i] << " unreachable: "
+                                     << status.error_message();
       }
-    }
+      return false;
+    });
 
-    std::this_thread::sleep_for(interval_);
+  // Decided as soon as a majority is in (or out of reach)
+  std::lock_guard<std::mutex> lk(votes->mu);
+  LOG_DEBUG("ElectionManager") << "votes: " << votes->accept
+                               << " accept, " << votes->reject << " reject";
+  if (!won) {
+    LOG_INFO("ElectionManager") << "lost election (" << votes->accept
+                                << "/" << members << ")";
   }
+  return won;
 }
@@ -0,0 +1,74 @@
+// src/election_state.cpp
+
+#include "election_state.h"
+
+ElectionState::ElectionState(std::string self_addr)
+  : self_addr_(std::move(self_addr))
+  , snap_(std::make_shared<const Snapshot>()) {}
+
+std::shared_ptr<const ElectionState::Snapshot> ElectionState::snapshot() const {
+  return std::atomic_load_explicit(&snap_, std::memory_order_acquire);
+}
+
+void ElectionState::setTerm(int64_t term) {
+  update([&](Snapshot& s) {
+    if (s.term == term) return false;
+    s.term = term;
+    return true;
+  });
+}
+
+void ElectionState::setVotedFor(const std::string& addr) {
+  update([&](Snapshot& s) {
+    if (s.voted_for == addr) return false;
+    s.voted_for = addr;
+    return true;
+  });
+}
+
+void ElectionState::setLeader(const std::string& addr) {
+  update([&](Snapshot& s) {
+    if (s.leader == addr) return false;
+    s.leader = addr;
+    return true;
+  });
+}
+
+bool ElectionState::setLeaderIfUnknown(const std::string& addr) {
+  return update([&](Snapshot& s) {
+    if (!s.leader.empty() || addr.empty()) return false;
+    s.leader = addr;
+    return true;
+  });
+}
+
+void ElectionState::subscribe(Listener fn) {
+  std::lock_guard<std::mutex> lk(listen_mu_);
+  listeners_.push_back(std::move(fn));
+}
+
+bool ElectionState::update(const std::function<bool(Snapshot&)>& change) {
+  std::shared_ptr<const Snapshot> before, after;
+  {
+    std::lock_guard<std::mutex> lk(write_mu_);
+    before = snapshot();
+    auto next = std::make_shared<Snapshot>(*before);
+    if (!change(*next)) return false;
+    after = next;
+    std::atomic_store_explicit(&snap_, after, std::memory_order_release);
+    is_leader_.store(!self_addr_.empty() && after->leader == self_addr_,
+                     std::memory_order_release);
+  }
+
+  // Only the term and the leader are worth waking anyone up for
+  if (before->term == after->term && before->leader == after->leader) {
+    return true;
+  }
+  std::vector<Listener> listeners;
+  {
+    std::lock_guard<std::mutex> lk(listen_mu_);
+    listeners = listeners_;
+  }
+  for (auto& fn : listeners) fn(*before, *after);
+  return true;
+}
@@ -0,0 +1,214 @@
+// src/gossip_pipeline.cpp
+
+#include "gossip_pipeline.h"
+#include "logger.h"
+#include <algorithm>
+
+using namespace std::chrono;
+
+// A peer's known keys are forgotten past this many (they are relearned).
+static constexpr size_t kMaxKnownKeys = 4096;
+
+GossipPipeline::GossipPipeline(
+    const std::vector<std::string>& peers,
+    const std::vector<std::unique_ptr<Stub>>& stubs)
+  : GossipPipeline(peers, stubs, Options{})
+{}
+
+GossipPipeline::GossipPipeline(
+    const std::vector<std::string>& peers,
+    const std::vector<std::unique_ptr<Stub>>& stubs,
+    Options opts,
+    std::shared_ptr<KeyRegistry> keys)
+  : opts_(opts)
+  , keys_(std::move(keys))
+{
+  for (size_t i = 0; i < stubs.size(); ++i) {
+    auto peer  = std::make_unique<Peer>();
+    peer->addr = i < peers.size() ? peers[i] : "peer#" + std::to_string(i);
+    peer->errors = &MetricsRegistry::Shared().GetCounter("gossip_errors_total",
+      "Gossip deliveries that failed and were retried", {{"peer", peer->addr}});
+    peer->stub = stubs[i].get();
+    peers_.push_back(std::move(peer));
+  }
+  for (auto& peer : peers_) {
+    peer->worker = std::thread(&GossipPipeline::workerLoop, this,
+                               std::ref(*peer));
+  }
+}
+
+GossipPipeline::~GossipPipeline() {
+  stopping_ = true;
+  for (auto& peer : peers_) {
+    { std::lock_guard<std::mutex> lk(peer->mu); }
+    peer->cv.notify_all();
+  }
+  for (auto& peer : peers_) {
+    if (peer->worker.joinable()) peer->worker.join();
+  }
+}
+
+void GossipPipeline::Enqueue(const common::FileAudit& audit) {
+  for (auto& peer : peers_) {
+    {
+      std::lock_guard<std::mutex> lk(peer->mu);
+      if (peer->queue.size() >= opts_.queue_limit) {
+        // Backpressure: shed the oldest audit rather than block the caller
+        peer->queue.pop_front();
+        if (peer->dropped++ % opts_.queue_limit == 0) {
+          LOG_WARN("Gossip")
+            << "queue for " << peer->addr
+            << " full, dropped " << peer->dropped << " audits so far";
+        }
+      }
+      peer->queue.push_back(audit);
+    }
+    peer->cv.notify_one();
+  }
+}
+
+size_t GossipPipeline::Pending() const {
+  size_t n = 0;
+  for (auto& peer : peers_) {
+    std::lock_guard<std::mutex> lk(peer->mu);
+    n += peer->queue.size();
+  }
+  return n;
+}
+
+void GossipPipeline::workerLoop(Peer& peer) {
+  auto backoff = milliseconds(0);
+  std::vector<common::FileAudit> batch;
+
+  std::unique_lock<std::mutex> lk(peer.mu);
+  while (!stopping_) {
+    peer.cv.wait(lk, [&]{ return stopping_ || !peer.queue.empty(); });
+    if (stopping_) break;
+
+    // Give a partial batch a moment to fill up
+    if (peer.queue.size() < opts_.max_batch && opts_.linger_ms > 0) {
+      peer.cv.wait_for(lk, milliseconds(opts_.linger_ms), [&]{
+        return stopping_ || peer.queue.size() >= opts_.max_batch;
+      });
+      if (stopping_) break;
+    }
+
+    size_t n = std::min(peer.queue.size(), opts_.max_batch);
+    batch.assign(std::make_move_iterator(peer.queue.begin()),
+                 std::make_move_iterator(peer.queue.begin() + n));
+    peer.queue.erase(peer.queue.begin(), peer.queue.begin() + n);
+
+    lk.unlock();
+    bool ok = sendBatch(peer, batch);
+    lk.lock();
+    if (!ok) peer.errors->Inc();
+
+    if (ok) {
+      backoff = milliseconds(0);
+      continue;
+    }
+
+    // Put the batch back in front (newer audits win if that overflows)
+    size_t room = opts_.queue_limit > peer.queue.size()
+                ? opts_.queue_limit - peer.queue.size() : 0;
+    size_t keep = std::min(room, batch.size());
+    peer.dropped += batch.size() - keep;
+    peer.queue.insert(peer.queue.begin(),
+                      std::make_move_iterator(batch.end() - keep),
+                      std::make_move_iterator(batch.end()));
+
+    backoff = std::clamp(backoff * 2, milliseconds(opts_.backoff_min_ms),
+                         milliseconds(opts_.backoff_max_ms));
+    peer.cv.wait_for(lk, backoff, [&]{ return stopping_.load(); });
+  }
+}
+
+// Deliver one batch; false means the peer is unreachable and should be retried
+bool GossipPipeline::sendBatch(
+    Peer& peer, const std::vector<common::FileAudit>& batch)
+{
+  static auto& latency = MetricsRegistry::Shared().GetHistogram(
+    "gossip_batch_seconds", "Delivering one gossip batch to a peer");
+  ScopedLatency timer(latency);
+
+  auto deadline = [&]{
+    return system_clock::now() + milliseconds(opts_.timeout_ms);
+  };
+
+  if (peer.batch_rpc) {
+    // key_id of each audit's key, if interned
+    std::vector<std::string> key_ids(batch.size());
+    if (keys_) {
+      for (size_t i = 0; i < batch.size(); ++i) {
+        if (!batch[i].public_key().empty()) {
+          key_ids[i] = keys_->Intern(batch[i].public_key());
+        }
+      }
+    }
+    // Send the audits for which `pick` holds; keys the peer knows go by id
+    auto whisper = [&](auto pick, blockchain::WhisperBatchResponse* resp) {
+      blockchain::AuditBatch req;
+      req.mutable_audits()->Reserve(static_cast<int>(batch.size()));
+      for (size_t i = 0; i < batch.size(); ++i) {
+        if (!pick(i)) continue;
+        auto* a = req.add_audits();
+        *a = batch[i];
+        if (!key_ids[i].empty() && peer.known_keys.count(key_ids[i])) {
+          a->clear_public_key();
+          a->set_key_id(key_ids[i]);
+        }
+      }
+      grpc::ClientContext ctx;
+      ctx.set_deadline(deadline());
+      return peer.stub->WhisperAuditBatch(&ctx, req, resp);
+    };
+
+    blockchain::WhisperBatchResponse resp;
+    auto st = whisper([](size_t) { return true; }, &resp);
+    if (st.ok() && resp.unknown_key_ids_size() > 0) {
+      // The peer lost some keys: forget them and resend those audits
+      std::unordered_set<std::string> lost(resp.unknown_key_ids().begin(),
+                                           resp.unknown_key_ids().end());
+      for (auto& id : lost) peer.known_keys.erase(id);
+      st = whisper([&](size_t i) { return lost.count(key_ids[i]) > 0; },
+                   &resp);
+    }
+    if (st.ok()) {
+      if (resp.status() != "success") {
+        LOG_WARN_EVERY_MS("Gossip", 1000) << peer.addr << " rejected batch: "
+                                          << resp.error_message();
+      }
+      if (resp.interns_keys()) {
+        if (peer.known_keys.size() > kMaxKnownKeys) peer.known_keys.clear();
+        for (auto& id : key_ids) {
+          if (!id.empty()) peer.known_keys.insert(id);
+        }
+      }
+      return true;
+    }
+    if (st.error_code() != grpc::StatusCode::UNIMPLEMENTED) {
+      LOG_WARN_EVERY_MS("Gossip", 1000)
+        << "batch of " << batch.size() << " to "
+        << peer.addr << " failed: " << st.error_message();
+      return false;
+    }
+    LOG_INFO("Gossip")
+      << peer.addr
+      << " has no WhisperAuditBatch, using WhisperAuditRequest";
+    peer.batch_rpc = false;
+  }
+
+  // Older peers: one unary call per audit
+  for (auto& a : batch) {
+    grpc::ClientContext ctx;
+    ctx.set_deadline(deadline());
+    blockchain::WhisperResponse wr;
+    auto st = peer.stub->WhisperAuditRequest(&ctx, a, &wr);
+    if (!st.ok() && st.error_code() != grpc::StatusCode::INVALID_ARGUMENT) {
+      LOG_WARN_EVERY_MS("Gossip", 1000) << "to " << peer.addr << " failed: "
+                                        << st.error_message();
+      return false;
+    }
+  }
+  return true;
+}
@@ -1,11 +1,19 @@
 #include "heartbeat_manager.h"
-#include <iostream>
-#include <google/protobuf/util/json_util.h>  // MessageToJsonString
-#include <filesystem>
-#include <fstream>
+#include "logger.h"
+#include "block_sync.h"
+#include <algorithm>
 #include "block_chain.grpc.pb.h"
 
-namespace fs = std::filesystem;
+HeartbeatManager::HeartbeatManager(
+    const std::vector<std::string>& peers,
+    const std::string&              self_addr,
+    ElectionState&                  state,
+    std::shared_ptr<MempoolManager> mempool,
+    ChainManager&                   chain,
+    std::shared_ptr<HeartbeatTable> table,
+    std::shared_ptr<BlockStore>     blocks)
+  : HeartbeatManager(peers, self_addr, state, std::move(mempool), chain,
+                     std::move(table), std::move(blocks), Options{}) {}
 
 HeartbeatManager::HeartbeatManager(
     const std::vector<std::string>& peers,
@@ -13,12 +21,17 @@ HeartbeatManager::HeartbeatManager(
     ElectionState&                  state,
     std::shared_ptr<MempoolManager> mempool,
     ChainManager&                   chain,
-    std::shared_ptr<HeartbeatTable> table)
+    std::shared_ptr<HeartbeatTable> table,
+    std::shared_ptr<BlockStore>     blocks,
+    Options                         opts)
   : self_addr_(self_addr)
   , state_(state)
   , mempool_(std::move(mempool))
   , chain_(chain)
   , table_(std::move(table))
+  , blocks_(std::move(blocks))
+  , opts_(opts)
+  , busy_(std::make_shared<std::vector<std::atomic<bool>>>(peers.size()))
 {
   for (auto& addr : peers) {
     auto chan = grpc::CreateChannel(addr, grpc::InsecureChannelCredentials());
@@ -37,129 +50,97 @@ void HeartbeatManager::start() {
 }
 
 void HeartbeatManager::stop() {
-  running_ = false;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    running_ = false;
+  }
+  cv_.notify_all();
   if (thr_.joinable()) thr_.join();
 }
 
 void HeartbeatManager::loop() {
+  auto next = std::chrono::steady_clock::now();
   while (running_) {
+    next += opts_.interval;
+
     // Build request
     blockchain::HeartbeatRequest req;
     req.set_from_address(self_addr_);
     req.set_current_leader_address(state_.getLeader());
     req.set_latest_block_id(chain_.getLastID());
-    req.set_mem_pool_size((int64_t)mempool_->LoadAll().size());
+    req.set_mem_pool_size((int64_t)mempool_->Size());
+    if (opts_.pressure) req.set_ingest_pressure(opts_.pressure());
 
     // Send to each peer
-    for (size_t i = 0; i < stubs_.size(); ++i) {
-      auto& stub = stubs_[i];
-      const auto& peer = peer_addrs_[i];
-
-      grpc::ClientContext ctx;
-      ctx.set_deadline(std::chrono::system_clock::now() +
-                       std::chrono::seconds(1));  // 1s timeout
-      blockchain::HeartbeatResponse resp;
-      auto status = stub->SendHeartbeat(&ctx, req, &resp);
-      if (!status.ok()) {
-        std::cerr << "[Heartbeat] to " << peer
-                  << " failed: " << status.error_message() << "\n";
-      }
-    }
+    sendHeartbeats(req);
 
     // Also record our own heartbeat locally:
     table_->update(
       self_addr_,
-      state_.getLeader(),
-      chain_.getLastID(),
-      (int64_t)mempool_->LoadAll().size()
+      req.current_leader_address(),
+      req.latest_block_id(),
+      req.mem_pool_size(),
+      req.ingest_pressure()
     );
     table_->sweep();
 
     syncMissingBlocks();
 
-    std::this_thread::sleep_for(interval_);
+    // Fixed rate; after a long sync, send the next round right away
+    auto now = std::chrono::steady_clock::now();
+    if (next < now) next = now;
+    std::unique_lock<std::mutex> lk(mu_);
+    cv_.wait_until(lk, next, [&]{ return !running_; });
   }
 }
 
-void HeartbeatManager::syncMissingBlocks() {
-  // find the alive peer with the highest block id > ours
-  auto entries   = table_->all();
-  int64_t local  = chain_.getLastID();
-  int64_t highest = local;
-  std::cout << "[Sync] local block id: " << local << "\n";
+void HeartbeatManager::sendHeartbeats(const blockchain::HeartbeatRequest& req) {
+  auto shared = std::make_shared<const blockchain::HeartbeatRequest>(req);
+  for (size_t i = 0; i < stubs_.size(); ++i) {
+    auto busy = busy_;
+    if ((*busy)[i].exchange(true)) continue;   // last one still in flight
 
-  std::string best;
-  for (auto& e : entries) {
-    std::cout << "[Sync] peer " << e.from_address
-         << " has block id " << e.latest_block_id
-         << " (alive=" << e.alive << ")\n";
-    if (e.alive &&
-        e.from_address != self_addr_ &&
-        e.latest_block_id > highest)
-    {
-      std::cout << "[Sync] peer " << e.from_address
-                << " has the highest block id: " << e.latest_block_id << "\n";
-      highest = e.latest_block_id;
-      best    = e.from_address;
-    }
-  }
-  if (!best.empty()) {
-    fetchBlocksFromPeer(best, local+1, highest);
+    struct Call {
+      grpc::ClientContext           ctx;
+      blockchain::HeartbeatResponse resp;
+    };
+    auto call = std::make_shared<Call>();
+    call->ctx.set_deadline(std::chrono::system_clock::now() +
+                           opts_.rpc_timeout);
+    std::string peer = peer_addrs_[i];
+    stubs_[i]->async()->SendHeartbeat(&call->ctx, shared.get(), &call->resp,
+      [call, shared, busy, i, peer](grpc::Status status) {
+        if (!status.ok()) {
+          LOG_WARN_EVERY_MS("Heartbeat", 1000)
+            << "to " << peer
+            << " failed: " << status.error_message();
+        }
+        (*busy)[i] = false;
+      });
   }
 }
 
-void HeartbeatManager::fetchBlocksFromPeer(
-    const std::string& peer,
-    int64_t startId,
-    int64_t endId)
-{
-  // look up which stub corresponds to `peer`
-  auto it = std::find(peer_addrs_.begin(), peer_addrs_.end(), peer);
-  if (it == peer_addrs_.end()) return;
-  auto& stub = stubs_[std::distance(peer_addrs_.begin(), it)];
-
-  std::cout << "[Sync] fetching blocks " << startId
-            << "–" << endId << " from " << peer << "\n";
-
-  for (int64_t id = startId; id <= endId; ++id) {
-    grpc::ClientContext ctx;
-    ctx.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(1));
-
-    blockchain::GetBlockRequest  gb_req;
-    blockchain::GetBlockResponse gb_resp;
-    gb_req.set_id(id);
-
-    auto status = stub->GetBlock(&ctx, gb_req, &gb_resp);
-    if (!status.ok() || gb_resp.status() != "success") {
-      std::cerr << "[Sync] failed to get block " << id
-                << ": " << (status.ok()
-                            ? gb_resp.error_message()
-                            : status.error_message()) << "\n";
-      return;
-    } else {
-      std::cout << "[Sync] got block " << id << "\n";
-    }
+void HeartbeatManager::syncMissingBlocks() {
+  // every alive peer ahead of us is a sync source
+  auto entries  = table_->all();
+  int64_t local = chain_.getLastID();
 
-    // commit into chain.json
-    const auto& blk = gb_resp.block();
-    BlockMeta meta { blk.id(),
-                     blk.hash(),
-                     blk.previous_hash(),
-                     blk.merkle_root() };
-    chain_.append(meta);
-
-    // write full block JSON file
-    try {
-      fs::create_directories("../blocks");
-      std::string json;
-      google::protobuf::util::MessageToJsonString(blk, &json);
-      std::ofstream out("../blocks/block_" + std::to_string(id) + ".json");
-      out << json;
-      std::cout << "[Sync] committed block " << id << "\n";
-    } catch (std::exception& e) {
-      std::cerr << "[Sync] error writing block file " << id
-                << ": " << e.what() << "\n";
-      return;
+  std::vector<BlockSync::Source> sources;
+  for (auto& e : entries) {
+    if (!e.alive || e.from_address == self_addr_ ||
+        e.latest_block_id <= local) {
+      continue;
     }
+    auto it = std::find(peer_addrs_.begin(), peer_addrs_.end(),
+                        e.from_address);
+    if (it == peer_addrs_.end()) continue;
+    sources.push_back({e.from_address,
+                       stubs_[std::distance(peer_addrs_.begin(), it)].get(),
+                       e.latest_block_id});
   }
-}
\ No newline at end of file
+  if (sources.empty()) return;
+
+  LOG_INFO("Sync") << "local block id " << local << ", "
+                   << sources.size() << " peer(s) ahead";
+  BlockSync(chain_, blocks_, mempool_).Run(sources);
+}
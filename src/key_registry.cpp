@@ -0,0 +1,117 @@
+// src/key_registry.cpp
+
+#include "key_registry.h"
+#include "logger.h"
+#include "signature_verifier.h"    // KeyFingerprint
+#include "storage_format.h"        // AppendDelimited, ReadDelimited
+#include <fcntl.h>
+#include <fstream>
+#include <unistd.h>
+
+KeyRegistry::KeyRegistry(std::string path, size_t capacity)
+  : path_(std::move(path))
+  , capacity_(capacity)
+  , size_gauge_(MetricsRegistry::Shared().GetGauge(
+      "key_registry_keys", "Distinct public keys interned by this node"))
+{
+  load();
+  fd_ = ::open(path_.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+  if (fd_ < 0) {
+    LOG_WARN("KeyRegistry") << "cannot open " << path_
+                            << ", keys stay inline";
+  }
+  size_gauge_.Set(static_cast<int64_t>(by_id_.size()));
+}
+
+KeyRegistry::~KeyRegistry() {
+  if (fd_ >= 0) ::close(fd_);
+}
+
+void KeyRegistry::load() {
+  std::ifstream in(path_, std::ios::binary);
+  if (!in) return;   // no keys yet
+  std::string pem;
+  std::streamoff good = 0;
+  while (ReadDelimited(in, &pem)) {
+    good = in.tellg();
+    auto id = KeyFingerprint(pem);
+    by_pem_.emplace(pem, id);
+    by_id_.emplace(std::move(id), std::move(pem));
+  }
+  in.clear();
+  in.seekg(0, std::ios::end);
+  if (in.tellg() != good) {
+    // Torn last record: cut it off so new keys append cleanly
+    LOG_WARN("KeyRegistry") << "truncated record at end of " << path_;
+    if (::truncate(path_.c_str(), good) != 0) {
+      LOG_WARN("KeyRegistry") << "cannot truncate " << path_;
+    }
+  }
+  LOG_INFO("KeyRegistry") << "loaded " << by_id_.size() << " keys from "
+                          << path_;
+}
+
+// Write one key and fsync it (mu_ held); keys are rare, so this is too
+bool KeyRegistry::append(const std::string& pem) {
+  if (fd_ < 0) return false;
+  std::string rec;
+  AppendDelimited(pem, &rec);
+  const char* p = rec.data();
+  size_t left = rec.size();
+  while (left > 0) {
+    ssize_t n = ::write(fd_, p, left);
+    if (n <= 0) return false;
+    p += n;
+    left -= n;
+  }
+  return ::fdatasync(fd_) == 0;
+}
+
+std::string KeyRegistry::Intern(const std::string& pem) {
+  std::lock_guard<std::mutex> lk(mu_);
+  auto it = by_pem_.find(pem);
+  if (it != by_pem_.end()) return it->second;
+  if (by_id_.size() >= capacity_) {
+    LOG_WARN_EVERY_MS("KeyRegistry", 60000)
+      << "full at " << capacity_ << " keys, new keys stay inline";
+    return {};
+  }
+  if (!append(pem)) {
+    LOG_WARN_EVERY_MS("KeyRegistry", 1000) << "cannot write to " << path_;
+    return {};
+  }
+  auto id = KeyFingerprint(pem);
+  by_id_.emplace(id, pem);
+  by_pem_.emplace(pem, id);
+  size_gauge_.Set(static_cast<int64_t>(by_id_.size()));
+  return id;
+}
+
+bool KeyRegistry::Lookup(const std::string& key_id, std::string* pem) const {
+  std::lock_guard<std::mutex> lk(mu_);
+  auto it = by_id_.find(key_id);
+  if (it == by_id_.end()) return false;
+  *pem = it->second;
+  return true;
+}
+
+bool KeyRegistry::Strip(common::FileAudit* audit) {
+  if (audit->public_key().empty()) return !audit->key_id().empty();
+  auto id = Intern(audit->public_key());
+  if (id.empty()) return false;
+  audit->set_key_id(std::move(id));
+  audit->clear_public_key();
+  return true;
+}
+
+bool KeyRegistry::Resolve(common::FileAudit* audit) const {
+  if (!audit->public_key().empty()) return true;
+  if (!Lookup(audit->key_id(), audit->mutable_public_key())) return false;
+  audit->clear_key_id();
+  return true;
+}
+
+size_t KeyRegistry::Size() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  return by_id_.size();
+}
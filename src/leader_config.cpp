@@ -1,4 +1,5 @@
 #include "leader_config.h"
+#include <algorithm>
 #include <fstream>
 #include <nlohmann/json.hpp>
 #include <stdexcept>
@@ -30,4 +31,113 @@ LeaderConfig::LeaderConfig(const std::string& path) {
   leader_addr_       = j.at("leader_addr").get<std::string>();
   batch_size_        = j.at("batch_size").get<int>();
   batch_interval_s_  = j.at("batch_interval_s").get<int>();
+
+  // Optional fields
+  if (j.contains("storage_format")) {
+    storage_format_ =
+      ParseStorageFormat(j.at("storage_format").get<std::string>());
+  }
+  if (j.contains("quorum")) {
+    quorum_ = j.at("quorum").get<int>();
+    if (quorum_ < 0) {
+      throw std::runtime_error("leader.json quorum must be >= 0");
+    }
+  }
+  if (j.contains("pipeline_depth")) {
+    pipeline_depth_ = j.at("pipeline_depth").get<int>();
+    if (pipeline_depth_ < 1) {
+      throw std::runtime_error("leader.json pipeline_depth must be >= 1");
+    }
+  }
+  if (j.contains("snapshot_interval_s")) {
+    snapshot_interval_s_ = j.at("snapshot_interval_s").get<int>();
+    if (snapshot_interval_s_ < 0) {
+      throw std::runtime_error("leader.json snapshot_interval_s must be >= 0");
+    }
+  }
+  if (j.contains("archive_after_s")) {
+    archive_after_s_ = j.at("archive_after_s").get<int>();
+    if (archive_after_s_ < 0) {
+      throw std::runtime_error("leader.json archive_after_s must be >= 0");
+    }
+  }
+
+  // Heartbeat/election timings; only the initial delay may be 0
+  auto readMin = [&](const char* key, int* out, int min) {
+    if (!j.contains(key)) return;
+    *out = j.at(key).get<int>();
+    if (*out < min) {
+      throw std::runtime_error(std::string("leader.json ") + key +
+                               " must be >= " + std::to_string(min));
+    }
+  };
+  readMin("heartbeat_interval_ms",     &heartbeat_interval_ms_,     1);
+  readMin("heartbeat_timeout_ms",      &heartbeat_timeout_ms_,      1);
+  readMin("election_interval_ms",      &election_interval_ms_,      1);
+  readMin("election_initial_delay_ms", &election_initial_delay_ms_, 0);
+  readMin("election_rpc_timeout_ms",   &election_rpc_timeout_ms_,   1);
+
+  if (j.contains("metrics_port")) {
+    metrics_port_ = j.at("metrics_port").get<int>();
+    if (metrics_port_ < 0 || metrics_port_ > 65535) {
+      throw std::runtime_error("leader.json metrics_port must be 0-65535");
+    }
+  }
+
+  // Server threading: one lane per traffic class, plus the sync pool
+  readMin("rpc_control_threads",   &rpc_control_threads_,   1);
+  readMin("rpc_consensus_threads", &rpc_consensus_threads_, 1);
+  readMin("rpc_ingest_threads",    &rpc_ingest_threads_,    1);
+  readMin("rpc_sync_threads",      &rpc_sync_threads_,      2);
+  readMin("rpc_queue_limit",       &rpc_queue_limit_,       1);
+  readMin("rpc_max_message_mb",    &rpc_max_message_mb_,    1);
+  readMin("rpc_keepalive_ms",      &rpc_keepalive_ms_,      0);
+
+  // Admission control (0 turns a limit off)
+  readMin("max_mempool",     &max_mempool_,     0);
+  readMin("max_ingest_rate", &max_ingest_rate_, 0);
+  readMin("client_rate",     &client_rate_,     0);
+  readMin("client_burst",    &client_burst_,    0);
+
+  // Adaptive batching
+  if (j.contains("batch_mode")) {
+    auto mode = j.at("batch_mode").get<std::string>();
+    if (mode != "fixed" && mode != "adaptive") {
+      throw std::runtime_error(
+        "leader.json batch_mode must be fixed or adaptive");
+    }
+    adaptive_batching_ = mode == "adaptive";
+  }
+  readMin("batch_min",             &batch_min_,             1);
+  readMin("batch_max",             &batch_max_,             1);
+  readMin("batch_interval_min_ms", &batch_interval_min_ms_, 1);
+  readMin("batch_interval_max_ms", &batch_interval_max_ms_, 1);
+  readMin("target_commit_ms",      &target_commit_ms_,      1);
+  if (batch_interval_max_ms_ == 0) {
+    batch_interval_max_ms_ = std::max(1, batch_interval_s_ * 1000);
+  }
+  if (batch_min_ > batch_max_ ||
+      batch_interval_min_ms_ > batch_interval_max_ms_) {
+    throw std::runtime_error(
+      "leader.json batch_min/batch_interval_min_ms exceed their max");
+  }
+
+  if (j.contains("proposal_mode")) {
+    auto mode = j.at("proposal_mode").get<std::string>();
+    if (mode != "compact" && mode != "full") {
+      throw std::runtime_error(
+        "leader.json proposal_mode must be compact or full");
+    }
+    compact_proposals_ = mode == "compact";
+  }
+
+  if (j.contains("intern_keys")) {
+    intern_keys_ = j.at("intern_keys").get<bool>();
+  }
+
+  if (j.contains("log_level") &&
+      !ParseLogLevel(j.at("log_level").get<std::string>(), &log_level_)) {
+    throw std::runtime_error(
+      "leader.json log_level must be debug, info, warn or error");
+  }
 }
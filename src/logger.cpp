@@ -0,0 +1,168 @@
+// src/logger.cpp
+
+#include "logger.h"
+#include <cstdio>
+
+// The drain thread re-checks the ring this often even without a wakeup
+// (a writer can miss the idle flag by a hair).
+static constexpr std::chrono::milliseconds kIdleWait{20};
+
+bool ParseLogLevel(const std::string& name, LogLevel* out) {
+  if      (name == "debug") *out = LogLevel::kDebug;
+  else if (name == "info")  *out = LogLevel::kInfo;
+  else if (name == "warn")  *out = LogLevel::kWarn;
+  else if (name == "error") *out = LogLevel::kError;
+  else return false;
+  return true;
+}
+
+Logger::Logger() : Logger(Options{}) {}
+
+Logger::Logger(Options opts) : opts_(std::move(opts)) {
+  uint64_t capacity = 2;
+  while (capacity < opts_.capacity) capacity <<= 1;
+  slots_.reset(new Slot[capacity]);
+  for (uint64_t i = 0; i < capacity; ++i) slots_[i].seq.store(i);
+  mask_ = capacity - 1;
+  thr_  = std::thread(&Logger::drainLoop, this);
+}
+
+Logger::~Logger() {
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    stopping_ = true;
+  }
+  cv_.notify_one();
+  thr_.join();
+}
+
+Logger& Logger::Shared() {
+  static Logger logger;
+  return logger;
+}
+
+void Logger::Write(LogLevel level, std::string line) {
+  // Bounded MPSC ring: a slot is free for ticket t when its seq is t, and
+  // holds a line for the reader once its seq is t + 1
+  uint64_t pos = tail_.load(std::memory_order_relaxed);
+  Slot* slot;
+  while (true) {
+    slot = &slots_[pos & mask_];
+    uint64_t seq = slot->seq.load(std::memory_order_acquire);
+    auto diff = static_cast<int64_t>(seq - pos);
+    if (diff == 0) {
+      if (tail_.compare_exchange_weak(pos, pos + 1,
+                                      std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);   // full
+      return;
+    } else {
+      pos = tail_.load(std::memory_order_relaxed);
+    }
+  }
+  slot->level = level;
+  slot->line  = std::move(line);
+  slot->seq.store(pos + 1, std::memory_order_release);
+
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (idle_.load(std::memory_order_relaxed)) cv_.notify_one();
+}
+
+size_t Logger::drain() {
+  std::string out, err;
+  size_t n = 0;
+  auto emit = [&](LogLevel level, const std::string& line) {
+    if (opts_.sink) {
+      opts_.sink(level, line);
+      return;
+    }
+    auto& buf = level >= LogLevel::kWarn ? err : out;
+    buf += line;
+    buf += '\n';
+  };
+
+  uint64_t dropped = dropped_.load();
+  if (dropped != reported_) {
+    emit(LogLevel::kWarn, "[Logger] " + std::to_string(dropped - reported_) +
+                          " line(s) dropped, log buffer full");
+    reported_ = dropped;
+  }
+
+  while (true) {
+    Slot& slot = slots_[head_ & mask_];
+    if (slot.seq.load(std::memory_order_acquire) != head_ + 1) break;
+    emit(slot.level, slot.line);
+    slot.line.clear();
+    slot.seq.store(head_ + mask_ + 1, std::memory_order_release);
+    ++head_;
+    ++n;
+  }
+
+  if (!out.empty()) {
+    std::fwrite(out.data(), 1, out.size(), stdout);
+    std::fflush(stdout);
+  }
+  if (!err.empty()) {
+    std::fwrite(err.data(), 1, err.size(), stderr);
+    std::fflush(stderr);
+  }
+  if (n) {
+    written_.fetch_add(n);
+    std::lock_guard<std::mutex> lk(mu_);
+    flushed_cv_.notify_all();
+  }
+  return n;
+}
+
+void Logger::drainLoop() {
+  while (true) {
+    if (drain() > 0) continue;
+    std::unique_lock<std::mutex> lk(mu_);
+    if (stopping_) break;
+    idle_ = true;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    cv_.wait_for(lk, kIdleWait, [&]{
+      return stopping_ ||
+             slots_[head_ & mask_].seq.load(std::memory_order_acquire)
+               == head_ + 1;
+    });
+    idle_ = false;
+  }
+  drain();
+}
+
+void Logger::Flush() {
+  uint64_t target = tail_.load();
+  std::unique_lock<std::mutex> lk(mu_);
+  cv_.notify_one();
+  flushed_cv_.wait(lk, [&]{ return written_.load() >= target; });
+}
+
+LogLine::LogLine(Logger& logger, LogLevel level, const char* tag,
+                 uint64_t suppressed)
+  : logger_(logger), level_(level), suppressed_(suppressed)
+{
+  os_ << '[' << tag << "] ";
+}
+
+LogLine::~LogLine() {
+  if (suppressed_) os_ << " (" << suppressed_ << " similar suppressed)";
+  logger_.Write(level_, os_.str());
+}
+
+bool LogRateLimit::Allow(uint64_t* suppressed) {
+  int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+  int64_t next = next_ns_.load(std::memory_order_relaxed);
+  if (now < next ||
+      !next_ns_.compare_exchange_strong(
+        next, now + std::chrono::nanoseconds(every_).count(),
+        std::memory_order_relaxed)) {
+    suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  *suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+  return true;
+}
@@ -1,41 +1,81 @@
 #include "mempool_manager.h"
+#include "logger.h"
+#include "canonical_payload.h"  // CanonicalLeafHash
+#include "merkle_tree.h"        // DeterministicSerialize
+#include "metrics.h"
+#include <chrono>
+#include <cstdio>
 #include <fstream>
-#include <iostream>
-#include <sstream>
-#include <unordered_set>
 
 using google::protobuf::util::MessageToJsonString;
 using google::protobuf::util::JsonStringToMessage;
 
-// Constructor: just capture the path
-MempoolManager::MempoolManager(std::string path)
-    : path_(std::move(path)) {}
+// JSON log: a tombstone line is "-<req_id>"; every other line is one audit.
+static constexpr char kTombstonePrefix = '-';
+// Binary log: a tag byte, then a varint-length-prefixed payload
+// (a serialized FileAudit, or the bare req_id for a tombstone).
+static constexpr char kBinaryAudit     = 0x01;
+static constexpr char kBinaryTombstone = 0x02;
 
-// Append one audit as JSON line
-void MempoolManager::Append(const common::FileAudit& audit) {
-  std::lock_guard<std::mutex> lk(mu_);
-  std::ofstream out(path_, std::ios::app);
-  if (!out) {
-    std::cerr << "[MempoolManager] failed to open " << path_ << "\n";
-    return;
+// Compact once at least this many records are in the log...
+static constexpr size_t kCompactMinRecords = 1024;
+// ...and more than this fraction of them are dead.
+static constexpr double kCompactDeadRatio = 0.5;
+// How often the compactor re-checks on its own.
+static constexpr auto kCompactCheckInterval = std::chrono::seconds(5);
+
+// Constructor: replay the log into memory, then keep it open for appends
+MempoolManager::MempoolManager(std::string path, StorageFormat format,
+                               std::shared_ptr<KeyRegistry> keys)
+    : path_(std::move(path))
+    , format_(format)
+    , keys_(std::move(keys))
+{
+  replayLog();
+  log_.open(path_, std::ios::app | std::ios::binary);
+  if (!log_) {
+    LOG_WARN("MempoolManager") << "failed to open " << path_;
   }
-  std::string json;
-  auto status = MessageToJsonString(audit, &json);
-  if (!status.ok()) {
-    std::cerr << "[MempoolManager] JSON serialization failed: "
-              << status.ToString() << "\n";
-    return;
+  compactor_ = std::thread(&MempoolManager::compactorLoop, this);
+}
+
+MempoolManager::~MempoolManager() {
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    stopping_ = true;
   }
-  out << json << "\n";
+  compact_cv_.notify_all();
+  if (compactor_.joinable()) compactor_.join();
 }
 
-// Load all audits by parsing JSON lines
-std::vector<common::FileAudit> MempoolManager::LoadAll() const {
-  std::lock_guard<std::mutex> lk(mu_);
-  std::vector<common::FileAudit> all;
-  std::ifstream in(path_);
-  if (!in) return all;
+// Rebuild the in-memory index from the log on disk (startup only)
+void MempoolManager::replayLog() {
+  StorageFormat on_disk;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    std::ifstream in(path_, std::ios::binary);
+    if (!in) return;  // no log yet
 
+    // JSON records start with '{' (audit) or '-' (tombstone)
+    in >> std::ws;
+    int c = in.peek();
+    if (c == EOF) return;
+    on_disk = (c == '{' || c == kTombstonePrefix) ? StorageFormat::kJson
+                                                   : StorageFormat::kBinary;
+    bool clean = on_disk == StorageFormat::kJson ? replayJson(in)
+                                                 : replayBinary(in);
+    size_ = entries_.size();
+    if (clean && on_disk == format_) return;
+  }
+
+  // Torn tail or other format: rewrite the log before appending to it
+  LOG_INFO("MempoolManager") << "rewriting " << path_ << " ("
+                             << StorageFormatName(on_disk) << " -> "
+                             << StorageFormatName(format_) << ")";
+  compact(true);
+}
+
+bool MempoolManager::replayJson(std::istream& in) {
   std::string line;
   while (std::getline(in, line)) {
     // trim whitespace
@@ -44,54 +84,276 @@ std::vector<common::FileAudit> MempoolManager::LoadAll() const {
       // blank or all-whitespace: skip
       continue;
     }
+    ++records_;
+
+    if (line[first] == kTombstonePrefix) {
+      auto last = line.find_last_not_of(" \t\r\n");
+      applyTombstone(line.substr(first + 1, last - first));
+      continue;
+    }
 
     common::FileAudit a;
     auto status = JsonStringToMessage(line, &a);
     if (!status.ok()) {
-      std::cerr << "[MempoolManager] JSON parse error: "
-                << status.ToString() << "\n";
+      LOG_WARN("MempoolManager") << "JSON parse error: "
+                                 << status.ToString();
       continue;
     }
-    all.push_back(std::move(a));
+    applyAudit(std::move(a));
   }
-  return all;
+  return true;
 }
 
+bool MempoolManager::replayBinary(std::istream& in) {
+  std::string bytes;
+  for (int tag; (tag = in.get()) != EOF; ) {
+    if (!ReadDelimited(in, &bytes)) {
+      LOG_WARN("MempoolManager") << "truncated record at end of "
+                                 << path_;
+      return false;
+    }
+    ++records_;
+
+    if (tag == kBinaryTombstone) {
+      applyTombstone(bytes);
+      continue;
+    }
+    common::FileAudit a;
+    if (tag != kBinaryAudit || !a.ParseFromString(bytes)) {
+      LOG_WARN("MempoolManager") << "corrupt record in " << path_;
+      return false;
+    }
+    applyAudit(std::move(a));
+  }
+  return true;
+}
+
+void MempoolManager::applyAudit(common::FileAudit a) {
+  if (index_.count(a.req_id())) return;  // duplicate record
+  if (NeedsKey(a) && !(keys_ && keys_->Resolve(&a))) {
+    LOG_WARN_EVERY_MS("MempoolManager", 1000)
+      << "unknown key_id for req_id=" << a.req_id();
+  }
+  std::string id = a.req_id();
+  std::string leaf = CanonicalLeafHash(a);
+  entries_.push_back({std::move(a), std::move(leaf)});
+  index_.emplace(std::move(id), std::prev(entries_.end()));
+}
+
+void MempoolManager::applyTombstone(const std::string& req_id) {
+  auto it = index_.find(req_id);
+  if (it == index_.end()) return;
+  entries_.erase(it->second);
+  index_.erase(it);
+}
+
+std::string MempoolManager::encodeAudit(const common::FileAudit& in) const {
+  // The record names an interned key instead of repeating the PEM
+  common::FileAudit stripped;
+  const common::FileAudit* audit = &in;
+  if (keys_ && !in.public_key().empty()) {
+    stripped = in;
+    if (keys_->Strip(&stripped)) audit = &stripped;
+  }
+
+  std::string rec;
+  if (format_ == StorageFormat::kBinary) {
+    rec.push_back(kBinaryAudit);
+    AppendDelimited(DeterministicSerialize(*audit), &rec);
+    return rec;
+  }
+  auto status = MessageToJsonString(*audit, &rec);
+  if (!status.ok()) {
+    LOG_WARN("MempoolManager") << "JSON serialization failed: "
+                               << status.ToString();
+    return {};
+  }
+  rec.push_back('\n');
+  return rec;
+}
+
+std::string MempoolManager::encodeTombstone(const std::string& req_id) const {
+  std::string rec;
+  if (format_ == StorageFormat::kBinary) {
+    rec.push_back(kBinaryTombstone);
+    AppendDelimited(req_id, &rec);
+  } else {
+    rec = kTombstonePrefix + req_id + "\n";
+  }
+  return rec;
+}
+
+// Write one encoded record to the open log (caller holds mu_)
+void MempoolManager::writeRecord(std::string record) {
+  ++records_;
+  if (!log_) {
+    LOG_WARN("MempoolManager") << "log not open: " << path_;
+  } else {
+    log_ << record;
+  }
+  if (compacting_) compact_tail_.push_back(std::move(record));
+}
+
+// Append one audit to the log and the index
+bool MempoolManager::Append(const common::FileAudit& audit,
+                            std::string leaf_hash) {
+  static auto& latency = MetricsRegistry::Shared().GetHistogram(
+    "mempool_append_seconds", "MempoolManager::Append, encoding and log write");
+  ScopedLatency timer(latency);
+
+  std::string rec = encodeAudit(audit);
+  if (rec.empty()) return false;
+  if (leaf_hash.empty()) leaf_hash = CanonicalLeafHash(audit);
 
-// Remove a batch of req_ids by rewriting the file
-void MempoolManager::RemoveBatch(const std::vector<std::string>& ids) {
   std::lock_guard<std::mutex> lk(mu_);
-  std::unordered_set<std::string> to_remove(ids.begin(), ids.end());
+  if (index_.count(audit.req_id())) return false;
+
+  writeRecord(std::move(rec));
+  log_.flush();
+
+  entries_.push_back({audit, std::move(leaf_hash)});
+  index_.emplace(audit.req_id(), std::prev(entries_.end()));
+  size_ = entries_.size();
+  appended_.fetch_add(1, std::memory_order_relaxed);
+  if (entries_.size() == wait_threshold_) size_cv_.notify_all();
+  return true;
+}
+
+bool MempoolManager::WaitForSize(
+    size_t n, std::chrono::steady_clock::time_point deadline,
+    const std::function<bool()>& cancelled)
+{
+  std::unique_lock<std::mutex> lk(mu_);
+  wait_threshold_ = n;
+  size_cv_.wait_until(lk, deadline, [&]{
+    return entries_.size() >= n || (cancelled && cancelled());
+  });
+  wait_threshold_ = SIZE_MAX;
+  return entries_.size() >= n;
+}
+
+// Taking the lock orders this after a waiter's predicate check
+void MempoolManager::WakeWaiters() {
+  { std::lock_guard<std::mutex> lk(mu_); }
+  size_cv_.notify_all();
+}
 
-  // Read everything
-  std::vector<common::FileAudit> keep;
+// Snapshot of the in-memory view (no file I/O)
+std::vector<common::FileAudit> MempoolManager::LoadAll() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  std::vector<common::FileAudit> out;
+  out.reserve(entries_.size());
+  for (auto& e : entries_) out.push_back(e.audit);
+  return out;
+}
+
+std::vector<PendingAudit> MempoolManager::LoadPending() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  return std::vector<PendingAudit>(entries_.begin(), entries_.end());
+}
+
+std::vector<PendingAudit> MempoolManager::Find(
+    const std::vector<std::string>& ids) const {
+  std::vector<PendingAudit> out(ids.size());
+  std::lock_guard<std::mutex> lk(mu_);
+  for (size_t i = 0; i < ids.size(); ++i) {
+    auto it = index_.find(ids[i]);
+    if (it != index_.end()) out[i] = *it->second;
+  }
+  return out;
+}
+
+
+// Remove a batch of req_ids: O(batch), independent of mempool depth
+void MempoolManager::RemoveBatch(const std::vector<std::string>& ids) {
+  bool wake = false;
   {
-    std::ifstream in(path_);
-    std::string line;
-    while (std::getline(in, line)) {
-      common::FileAudit a;
-      auto st = JsonStringToMessage(line, &a);
-      if (!st.ok()) continue;
-      if (!to_remove.count(a.req_id())) {
-        keep.push_back(std::move(a));
-      }
+    std::lock_guard<std::mutex> lk(mu_);
+    for (auto& id : ids) {
+      auto it = index_.find(id);
+      if (it == index_.end()) continue;
+      entries_.erase(it->second);
+      index_.erase(it);
+      writeRecord(encodeTombstone(id));
     }
+    log_.flush();
+    size_ = entries_.size();
+    wake = needsCompaction();
+  }
+  if (wake) compact_cv_.notify_one();
+}
+
+// Dead records = everything in the log that is not a live audit (caller holds mu_)
+bool MempoolManager::needsCompaction() const {
+  if (compacting_ || records_ < kCompactMinRecords) return false;
+  size_t dead = records_ - entries_.size();
+  return static_cast<double>(dead) / records_ > kCompactDeadRatio;
+}
+
+bool MempoolManager::MaybeCompact() {
+  return compact(false);
+}
+
+bool MempoolManager::compact(bool force) {
+  // 1) Snapshot the live audits; new records are mirrored from here on
+  std::vector<common::FileAudit> live;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (compacting_ || (!force && !needsCompaction())) return false;
+    live.reserve(entries_.size());
+    for (auto& e : entries_) live.push_back(e.audit);
+    compacting_ = true;
+    compact_tail_.clear();
   }
 
-  // Rewrite
-  std::ofstream out(path_, std::ios::trunc);
+  // 2) Write the snapshot to a temp file without holding the lock
+  const std::string tmp = path_ + ".compact";
+  std::ofstream out(tmp, std::ios::trunc | std::ios::binary);
+  for (auto& a : live) out << encodeAudit(a);
+
+  // 3) Carry over the tail, then atomically swap the logs
+  std::lock_guard<std::mutex> lk(mu_);
+  compacting_ = false;
+  for (auto& rec : compact_tail_) out << rec;
+  out.close();
   if (!out) {
-    std::cerr << "[MempoolManager] failed to reopen " << path_ << "\n";
-    return;
+    LOG_WARN("MempoolManager") << "compaction failed writing " << tmp;
+    std::remove(tmp.c_str());
+    compact_tail_.clear();
+    return false;
   }
-  for (auto& a : keep) {
-    std::string json;
-    auto status = MessageToJsonString(a, &json);
-    if (!status.ok()) {
-      std::cerr << "[MempoolManager] JSON serialization failed: "
-                << status.ToString() << "\n";
-      continue;
+
+  size_t before = records_;
+  bool was_open = log_.is_open();
+  log_.close();
+  bool replaced = ReplaceFile(tmp, path_);
+  if (!replaced) {
+    LOG_WARN("MempoolManager") << "compaction failed replacing " << path_;
+  } else {
+    records_ = live.size() + compact_tail_.size();
+  }
+  compact_tail_.clear();
+  if (was_open) {
+    log_.open(path_, std::ios::app | std::ios::binary);
+    if (!log_) {
+      LOG_WARN("MempoolManager") << "failed to reopen " << path_;
     }
-    out << json << "\n";
+  }
+  if (!replaced) return false;
+  LOG_INFO("MempoolManager") << "compacted log: " << before
+                             << " -> " << records_ << " records";
+  return true;
+}
+
+void MempoolManager::compactorLoop() {
+  std::unique_lock<std::mutex> lk(mu_);
+  while (!stopping_) {
+    compact_cv_.wait_for(lk, kCompactCheckInterval,
+                         [&]{ return stopping_ || needsCompaction(); });
+    if (stopping_) break;
+    if (!needsCompaction()) continue;
+    lk.unlock();
+    MaybeCompact();
+    lk.lock();
   }
 }
@@ -1,16 +1,23 @@
 #include "merkle_tree.h"
 #include <openssl/sha.h>
-#include <iomanip>
-#include <sstream>
+#include <cstring>
 #include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 #include <google/protobuf/io/coded_stream.h>
 
+static const char kHexDigits[] = "0123456789abcdef";
+
+// Lowercase hex of `len` bytes into `out` (2 * len chars, no terminator)
+static void HexInto(const unsigned char* buf, size_t len, char* out) {
+  for (size_t i = 0; i < len; i++) {
+    out[2 * i]     = kHexDigits[buf[i] >> 4];
+    out[2 * i + 1] = kHexDigits[buf[i] & 0xf];
+  }
+}
+
 static std::string toHex(const unsigned char* buf, size_t len) {
-  std::ostringstream out;
-  out << std::hex << std::setfill('0');
-  for (size_t i = 0; i < len; i++)
-    out << std::setw(2) << (int)buf[i];
-  return out.str();
+  std::string out(2 * len, '\0');
+  HexInto(buf, len, &out[0]);
+  return out;
 }
 
 std::string SHA256Hex(const std::string& data) {
@@ -26,6 +33,7 @@ std::string DeterministicSerialize(const google::protobuf::Message& msg) {
   google::protobuf::io::StringOutputStream sos(&out);
   google::protobuf::io::CodedOutputStream cos(&sos);
   cos.SetSerializationDeterministic(true);
+  msg.ByteSizeLong();  // populate the cached sizes used below
   msg.SerializeWithCachedSizes(&cos);
   cos.Trim();
   return out;
@@ -33,6 +41,14 @@ std::string DeterministicSerialize(const google::protobuf::Message& msg) {
 
 std::string ComputeMerkleRoot(const std::vector<std::string>& leaf_hashes) {
   if (leaf_hashes.empty()) return "";
+
+  // Normal case: real SHA-256 hex leaves, hashed as binary digests
+  MerkleTree tree(std::vector<MerkleTree::Digest>{});
+  if (MerkleTree::FromHex(leaf_hashes, MerkleTree::Mode::kHexCompat, &tree)) {
+    return tree.RootHex();
+  }
+
+  // Anything else keeps the original string-concatenation behaviour
   std::vector<std::string> level = leaf_hashes;
   while (level.size() > 1) {
     std::vector<std::string> next;
@@ -44,4 +60,126 @@ std::string ComputeMerkleRoot(const std::vector<std::string>& leaf_hashes) {
     level.swap(next);
   }
   return level[0];
-}
\ No newline at end of file
+}
+
+// -- MerkleTree -------------------------------------------------------------
+
+// Parent of (left, right) in the given mode
+static void HashPair(const MerkleTree::Digest& left,
+                     const MerkleTree::Digest& right,
+                     MerkleTree::Mode mode, MerkleTree::Digest* out) {
+  if (mode == MerkleTree::Mode::kHexCompat) {
+    char buf[128];
+    HexInto(left.data(), 32, buf);
+    HexInto(right.data(), 32, buf + 64);
+    SHA256(reinterpret_cast<const unsigned char*>(buf), sizeof buf,
+           out->data());
+  } else {
+    unsigned char buf[64];
+    std::memcpy(buf, left.data(), 32);
+    std::memcpy(buf + 32, right.data(), 32);
+    SHA256(buf, sizeof buf, out->data());
+  }
+}
+
+MerkleTree::MerkleTree(std::vector<Digest> leaves, Mode mode)
+  : mode_(mode)
+  , leaf_count_(leaves.size())
+  , nodes_(std::move(leaves))
+{
+  build();
+}
+
+bool MerkleTree::FromHex(const std::vector<std::string>& hex_leaves,
+                         Mode mode, MerkleTree* out) {
+  std::vector<Digest> leaves(hex_leaves.size());
+  for (size_t i = 0; i < hex_leaves.size(); ++i) {
+    if (!ParseHex(hex_leaves[i], &leaves[i])) return false;
+  }
+  *out = MerkleTree(std::move(leaves), mode);
+  return true;
+}
+
+// Append each level after the previous one, in a single allocation
+void MerkleTree::build() {
+  level_offsets_.clear();
+  if (leaf_count_ == 0) return;
+
+  size_t total = 0;
+  for (size_t n = leaf_count_; ; n = (n + 1) / 2) {
+    total += n;
+    if (n == 1) break;
+  }
+  nodes_.resize(total);
+
+  size_t begin = 0, n = leaf_count_;
+  level_offsets_.push_back(0);
+  while (n > 1) {
+    size_t next = begin + n;
+    for (size_t i = 0; i < n; i += 2) {
+      const Digest& left  = nodes_[begin + i];
+      const Digest& right = i + 1 < n ? nodes_[begin + i + 1] : left;
+      HashPair(left, right, mode_, &nodes_[next + i / 2]);
+    }
+    begin = next;
+    n = (n + 1) / 2;
+    level_offsets_.push_back(begin);
+  }
+}
+
+MerkleTree::Digest MerkleTree::Root() const {
+  return nodes_.empty() ? Digest{} : nodes_.back();
+}
+
+std::string MerkleTree::RootHex() const {
+  return nodes_.empty() ? "" : ToHex(nodes_.back());
+}
+
+std::vector<MerkleTree::ProofStep> MerkleTree::GetProof(size_t index) const {
+  std::vector<ProofStep> proof;
+  if (index >= leaf_count_) return proof;
+
+  size_t n = leaf_count_;
+  for (size_t level = 0; level + 1 < level_offsets_.size(); ++level) {
+    size_t begin = level_offsets_[level];
+    size_t sib   = index ^ 1;
+    if (sib >= n) sib = index;   // odd node pairs with itself
+    proof.push_back({nodes_[begin + sib], sib < index});
+    index /= 2;
+    n = (n + 1) / 2;
+  }
+  return proof;
+}
+
+bool MerkleTree::VerifyProof(const Digest& leaf,
+                             const std::vector<ProofStep>& proof,
+                             const Digest& root, Mode mode) {
+  Digest cur = leaf;
+  for (auto& step : proof) {
+    Digest parent;
+    if (step.sibling_is_left) HashPair(step.sibling, cur, mode, &parent);
+    else                      HashPair(cur, step.sibling, mode, &parent);
+    cur = parent;
+  }
+  return cur == root;
+}
+
+std::string MerkleTree::ToHex(const Digest& d) {
+  return toHex(d.data(), d.size());
+}
+
+// Lowercase only: the compat hash is over the exact hex text
+bool MerkleTree::ParseHex(const std::string& hex, Digest* out) {
+  if (hex.size() != 64) return false;
+  auto nibble = [](char c) -> int {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+  };
+  for (size_t i = 0; i < 32; ++i) {
+    int hi = nibble(hex[2 * i]), lo = nibble(hex[2 * i + 1]);
+    if (hi < 0 || lo < 0) return false;
+    (*out)[i] = static_cast<uint8_t>(hi << 4 | lo);
+  }
+  return true;
+}
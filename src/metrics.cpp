@@ -0,0 +1,144 @@
+// src/metrics.cpp
+
+#include "metrics.h"
+#include <cstdio>
+#include <sstream>
+
+namespace {
+
+// a="x",b="y" with Prometheus escaping; also the registry's series key
+std::string RenderLabels(const MetricsRegistry::Labels& labels) {
+  std::string out;
+  for (auto& [k, v] : labels) {
+    if (!out.empty()) out += ',';
+    out += k;
+    out += "=\"";
+    for (char c : v) {
+      if (c == '\\' || c == '"') out += '\\';
+      if (c == '\n') {
+        out += "\\n";
+        continue;
+      }
+      out += c;
+    }
+    out += '"';
+  }
+  return out;
+}
+
+std::string Number(double v) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%.9g", v);
+  return buf;
+}
+
+// name{labels} or name{labels,extra}; no braces when both are empty
+std::string SeriesName(const std::string& name, const std::string& labels,
+                       const std::string& extra = "") {
+  if (labels.empty() && extra.empty()) return name;
+  std::string sep = labels.empty() || extra.empty() ? "" : ",";
+  return name + "{" + labels + sep + extra + "}";
+}
+
+bool IsPowerOfFour(uint64_t v) {
+  return v && (v & (v - 1)) == 0 && (__builtin_ctzll(v) % 2) == 0;
+}
+
+}  // namespace
+
+MetricsRegistry& MetricsRegistry::Shared() {
+  static MetricsRegistry registry;
+  return registry;
+}
+
+MetricsRegistry::Series& MetricsRegistry::series(const std::string& name,
+                                                 const std::string& help,
+                                                 Type type,
+                                                 const Labels& labels) {
+  // Caller holds mu_
+  auto& family = families_[name];
+  if (family.series.empty()) {
+    family.type = type;
+    family.help = help;
+  }
+  return family.series[RenderLabels(labels)];
+}
+
+Counter& MetricsRegistry::GetCounter(const std::string& name,
+                                     const std::string& help,
+                                     const Labels& labels) {
+  std::lock_guard<std::mutex> lk(mu_);
+  auto& s = series(name, help, Type::kCounter, labels);
+  if (!s.counter) s.counter = std::make_unique<Counter>();
+  return *s.counter;
+}
+
+Gauge& MetricsRegistry::GetGauge(const std::string& name,
+                                 const std::string& help,
+                                 const Labels& labels) {
+  std::lock_guard<std::mutex> lk(mu_);
+  auto& s = series(name, help, Type::kGauge, labels);
+  if (!s.gauge) s.gauge = std::make_unique<Gauge>();
+  return *s.gauge;
+}
+
+LatencyHistogram& MetricsRegistry::GetHistogram(const std::string& name,
+                                                const std::string& help,
+                                                const Labels& labels) {
+  std::lock_guard<std::mutex> lk(mu_);
+  auto& s = series(name, help, Type::kHistogram, labels);
+  if (!s.histogram) s.histogram = std::make_unique<LatencyHistogram>();
+  return *s.histogram;
+}
+
+void MetricsRegistry::SetGaugeFn(const std::string& name,
+                                 const std::string& help,
+                                 std::function<double()> fn,
+                                 const Labels& labels) {
+  std::lock_guard<std::mutex> lk(mu_);
+  series(name, help, Type::kGauge, labels).fn = std::move(fn);
+}
+
+std::string MetricsRegistry::Render() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  std::ostringstream os;
+  for (auto& [name, family] : families_) {
+    const char* type = family.type == Type::kCounter ? "counter"
+                     : family.type == Type::kGauge   ? "gauge"
+                                                     : "histogram";
+    os << "# HELP " << name << " " << family.help << "\n"
+       << "# TYPE " << name << " " << type << "\n";
+
+    for (auto& [labels, s] : family.series) {
+      if (s.counter) {
+        os << SeriesName(name, labels) << " " << s.counter->Value() << "\n";
+      } else if (s.fn) {
+        os << SeriesName(name, labels) << " " << Number(s.fn()) << "\n";
+      } else if (s.gauge) {
+        os << SeriesName(name, labels) << " " << s.gauge->Value() << "\n";
+      } else if (s.histogram) {
+        // Cumulative counts at 1us, 4us, 16us, ... (bucket edges are exact
+        // there); le is exclusive at microsecond resolution
+        const auto& h = *s.histogram;
+        uint64_t seen = 0;
+        for (size_t b = 0; b < LatencyHistogram::kBuckets; ++b) {
+          seen += h.BucketCount(b);
+          uint64_t upper = LatencyHistogram::UpperBoundUs(b);
+          if (!IsPowerOfFour(upper)) continue;
+          os << SeriesName(name + "_bucket", labels,
+                           "le=\"" + Number(upper / 1e6) + "\"")
+             << " " << seen << "\n";
+        }
+        // The bucket total, not Count(), so +Inf never trails a bucket
+        // that a concurrent Record() has already bumped
+        uint64_t count = seen;
+        os << SeriesName(name + "_bucket", labels, "le=\"+Inf\"") << " "
+           << count << "\n"
+           << SeriesName(name + "_sum", labels) << " "
+           << Number(h.SumUs() / 1e6) << "\n"
+           << SeriesName(name + "_count", labels) << " " << count << "\n";
+      }
+    }
+  }
+  return os.str();
+}
@@ -0,0 +1,103 @@
+// src/metrics_server.cpp
+
+#include "metrics_server.h"
+#include "logger.h"
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// How often the accept loop checks for stop().
+static constexpr int kPollMs = 200;
+// A client that hasn't sent its request line by then is dropped.
+static constexpr int kReadTimeoutMs = 2000;
+
+MetricsServer::MetricsServer(int port, MetricsRegistry& registry)
+  : port_(port), registry_(registry) {}
+
+MetricsServer::~MetricsServer() {
+  stop();
+}
+
+bool MetricsServer::start() {
+  if (running_) return true;
+  listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (listen_fd_ < 0) return false;
+  int one = 1;
+  ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  sockaddr_in addr{};
+  addr.sin_family      = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port        = htons(static_cast<uint16_t>(port_));
+  if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+      ::listen(listen_fd_, 16) != 0) {
+    LOG_WARN("Metrics") << "cannot listen on port " << port_ << ": "
+                        << std::strerror(errno);
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+    return false;
+  }
+
+  running_ = true;
+  thr_ = std::thread(&MetricsServer::loop, this);
+  LOG_INFO("Metrics") << "serving http://0.0.0.0:" << port_ << "/metrics";
+  return true;
+}
+
+void MetricsServer::stop() {
+  running_ = false;
+  if (thr_.joinable()) thr_.join();
+  if (listen_fd_ >= 0) {
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+  }
+}
+
+void MetricsServer::loop() {
+  while (running_) {
+    pollfd p{listen_fd_, POLLIN, 0};
+    if (::poll(&p, 1, kPollMs) <= 0) continue;
+    int fd = ::accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0) continue;
+    serve(fd);
+    ::close(fd);
+  }
+}
+
+void MetricsServer::serve(int fd) {
+  // Read up to the end of the request line; the headers don't matter
+  std::string req;
+  char buf[1024];
+  while (req.find("\r\n") == std::string::npos && req.size() < 8192) {
+    pollfd p{fd, POLLIN, 0};
+    if (::poll(&p, 1, kReadTimeoutMs) <= 0) return;
+    ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0) return;
+    req.append(buf, static_cast<size_t>(n));
+  }
+
+  std::string status = "200 OK", body;
+  if (req.rfind("GET /metrics ", 0) == 0 || req.rfind("GET /metrics?", 0) == 0) {
+    body = registry_.Render();
+  } else {
+    status = "404 Not Found";
+    body   = "not found\n";
+  }
+  std::string reply =
+    "HTTP/1.1 " + status + "\r\n"
+    "Content-Type: text/plain; version=0.0.4\r\n"
+    "Content-Length: " + std::to_string(body.size()) + "\r\n"
+    "Connection: close\r\n\r\n" + body;
+
+  size_t off = 0;
+  while (off < reply.size()) {
+    ssize_t n = ::send(fd, reply.data() + off, reply.size() - off, MSG_NOSIGNAL);
+    if (n <= 0) return;
+    off += static_cast<size_t>(n);
+  }
+}
@@ -0,0 +1,235 @@
+// src/node.cpp
+
+#include "node.h"
+#include "logger.h"
+#include "rpc_metrics.h"
+
+// Time in-flight RPCs get to finish when the node stops.
+static constexpr std::chrono::seconds kShutdownGrace{2};
+// A keepalive ping that gets no answer by then closes the connection.
+static constexpr int kKeepaliveTimeoutMs = 10000;
+
+static BlockStore::Options BlockStoreOptions(const LeaderConfig& cfg) {
+  BlockStore::Options opts;
+  opts.archive_after_s = cfg.getArchiveAfterSec();
+  return opts;
+}
+
+Node::Node(Options opts, const LeaderConfig& cfg)
+  : opts_(std::move(opts))
+  , cfg_(cfg)
+  , keys_(cfg_.getInternKeys()
+      ? std::make_shared<KeyRegistry>(path("keys.dat")) : nullptr)
+  , mempool_(std::make_shared<MempoolManager>(path("mempool.dat"),
+                                              cfg_.getStorageFormat(), keys_))
+  , chain_(path("chain.json"))
+  , blocks_(std::make_shared<BlockStore>(path("blocks"),
+                                         BlockStoreOptions(cfg_), keys_))
+  , hb_table_(std::make_shared<HeartbeatTable>(
+      std::chrono::milliseconds(cfg_.getHeartbeatTimeoutMs())))
+  , election_state_(opts_.addr)
+  , block_cache_(std::make_shared<BlockCache>())
+  , audit_index_(std::make_shared<AuditIndex>(chain_, blocks_))
+  , verified_(std::make_shared<VerifiedAuditSet>())
+{
+  LOG_INFO("Node") << "Recovered " << mempool_->Size()
+                   << " audits from mempool";
+
+  // A fresh node starts from a peer's snapshot and syncs only the rest
+  if (chain_.getLastID() < 0) {
+    for (auto& p : opts_.peers) {
+      auto stub = blockchain::BlockChainService::NewStub(
+        grpc::CreateChannel(p, grpc::InsecureChannelCredentials()));
+      std::string err;
+      if (SnapshotManager::Bootstrap(stub.get(), chain_, *mempool_, &err)) {
+        break;
+      }
+      LOG_WARN("Snapshot") << "bootstrap from " << p << " failed: " << err;
+    }
+  }
+  SnapshotManager::Options snap_opts;
+  snap_opts.interval = std::chrono::seconds(cfg_.getSnapshotIntervalSec());
+  snapshots_ = std::make_shared<SnapshotManager>(
+    path("snapshot.dat"), chain_, mempool_, blocks_, snap_opts);
+
+  AdmissionControl::Options adm_opts;
+  adm_opts.max_mempool     = static_cast<size_t>(cfg_.getMaxMempool());
+  adm_opts.max_ingest_rate = cfg_.getMaxIngestRate();
+  adm_opts.client_rate     = cfg_.getClientRate();
+  adm_opts.client_burst    = cfg_.getClientBurst();
+  adm_opts.full_retry      = std::chrono::seconds(std::max(1, cfg_.getBatchIntervalSec()));
+  admission_ = std::make_shared<AdmissionControl>(
+    adm_opts, mempool_, hb_table_, opts_.addr);
+
+  // Secondary index for QueryAudits, rebuilt from the block store
+  auto t0 = std::chrono::steady_clock::now();
+  size_t n = audit_index_->CatchUp();
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - t0).count();
+  LOG_INFO("Node") << "Indexed " << n << " committed audits in " << ms << " ms";
+}
+
+Node::~Node() {
+  stop();
+}
+
+std::string Node::path(const std::string& name) const {
+  return opts_.data_dir + "/" + name;
+}
+
+bool Node::start() {
+  // Services (signatures already checked at submit/gossip time are
+  // remembered in verified_)
+  file_svc_ = std::make_unique<FileAuditServiceImpl>(
+    opts_.peers, mempool_, verified_, admission_, keys_);
+  block_svc_ = std::make_unique<BlockChainServiceImpl>(
+    mempool_, chain_, hb_table_, election_state_, opts_.addr, blocks_,
+    verified_, snapshots_, block_cache_, audit_index_, admission_, keys_);
+
+  grpc::ServerBuilder builder;
+  builder.AddListeningPort(opts_.addr, grpc::InsecureServerCredentials());
+  builder.RegisterService(file_svc_.get());
+  builder.RegisterService(block_svc_.get());
+
+  const int max_message = cfg_.getRpcMaxMessageMb() << 20;
+  builder.SetMaxReceiveMessageSize(max_message);
+  builder.SetMaxSendMessageSize(max_message);
+  if (cfg_.getRpcKeepaliveMs() > 0) {
+    builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_TIME_MS,
+                               cfg_.getRpcKeepaliveMs());
+    builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_TIMEOUT_MS,
+                               kKeepaliveTimeoutMs);
+    builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
+    builder.AddChannelArgument(GRPC_ARG_HTTP2_MAX_PINGS_WITHOUT_DATA, 0);
+  }
+
+  // Streams and queries share gRPC's sync pool; the rest runs on lanes of
+  // its own, so a flood of submissions cannot starve heartbeats and votes
+  grpc::ResourceQuota quota("node");
+  quota.SetMaxThreads(cfg_.getRpcSyncThreads());
+  builder.SetResourceQuota(quota);
+
+  auto lane = [&](const char* name, int threads) {
+    return std::make_unique<RpcLane>(
+      builder, RpcLane::Options{name, threads, cfg_.getRpcQueueLimit()});
+  };
+  control_lane_   = lane("control",   cfg_.getRpcControlThreads());
+  consensus_lane_ = lane("consensus", cfg_.getRpcConsensusThreads());
+  ingest_lane_    = lane("ingest",    cfg_.getRpcIngestThreads());
+
+  using B = BlockChainServiceImpl;
+  auto* bc = block_svc_.get();
+  control_lane_->serve(bc, &B::RequestSendHeartbeat,    &B::SendHeartbeat);
+  control_lane_->serve(bc, &B::RequestTriggerElection,  &B::TriggerElection);
+  control_lane_->serve(bc, &B::RequestNotifyLeadership, &B::NotifyLeadership);
+  consensus_lane_->serve(bc, &B::RequestProposeBlock, &B::ProposeBlock);
+  consensus_lane_->serve(bc, &B::RequestCommitBlock,  &B::CommitBlock);
+  ingest_lane_->serve(bc, &B::RequestWhisperAuditRequest,
+                      &B::WhisperAuditRequest);
+  ingest_lane_->serve(bc, &B::RequestWhisperAuditBatch, &B::WhisperAuditBatch);
+  using F = FileAuditServiceImpl;
+  ingest_lane_->serve(file_svc_.get(), &F::RequestSubmitAudit, &F::SubmitAudit);
+
+  // Per-method latency and status counts for every service
+  std::vector<std::unique_ptr<
+    grpc::experimental::ServerInterceptorFactoryInterface>> interceptors;
+  interceptors.push_back(std::make_unique<RpcMetricsInterceptorFactory>(
+    MetricsRegistry::Shared()));
+  builder.experimental().SetInterceptorCreators(std::move(interceptors));
+
+  server_ = builder.BuildAndStart();
+  if (!server_) {
+    LOG_ERROR("Node") << "cannot listen on " << opts_.addr;
+    return false;
+  }
+  LOG_INFO("Node") << "Server listening on " << opts_.addr;
+  control_lane_->start();
+  consensus_lane_->start();
+  ingest_lane_->start();
+
+  if (cfg_.getMetricsPort() > 0) {
+    metrics_server_ = std::make_unique<MetricsServer>(
+      cfg_.getMetricsPort(), MetricsRegistry::Shared());
+    metrics_server_->start();
+  }
+
+  // Block‐proposal scheduler
+  scheduler_ = std::make_unique<BlockScheduler>(
+    mempool_,
+    chain_,
+    blocks_,
+    file_svc_->getGossipStubs(),
+    opts_.peers,
+    cfg_,
+    [this]{ return election_state_.isLeader(); },
+    block_cache_,
+    audit_index_
+  );
+  election_state_.subscribe(
+    [this](const ElectionState::Snapshot&, const ElectionState::Snapshot&) {
+      scheduler_->leadershipChanged();
+    });
+  scheduler_->start();
+  snapshots_->start();
+
+  HeartbeatManager::Options hb_opts;
+  hb_opts.interval    = std::chrono::milliseconds(cfg_.getHeartbeatIntervalMs());
+  hb_opts.rpc_timeout = std::chrono::milliseconds(cfg_.getElectionRpcTimeoutMs());
+  hb_opts.pressure    = [this]{ return admission_->Pressure(); };
+  hb_mgr_ = std::make_unique<HeartbeatManager>(
+    opts_.peers, opts_.addr, election_state_, mempool_, chain_, hb_table_,
+    blocks_, hb_opts);
+  hb_mgr_->start();
+
+  ElectionManager::Options el_opts;
+  el_opts.interval      = std::chrono::milliseconds(cfg_.getElectionIntervalMs());
+  el_opts.initial_delay =
+    std::chrono::milliseconds(cfg_.getElectionInitialDelayMs());
+  el_opts.rpc_timeout   = std::chrono::milliseconds(cfg_.getElectionRpcTimeoutMs());
+  election_mgr_ = std::make_unique<ElectionManager>(
+    opts_.peers, opts_.addr, hb_table_, election_state_, mempool_, chain_,
+    el_opts);
+  election_mgr_->start();
+  return true;
+}
+
+void Node::wait() {
+  if (server_) server_->Wait();
+}
+
+void Node::stop() {
+  if (stopped_) return;
+  stopped_ = true;
+  if (election_mgr_) election_mgr_->stop();
+  if (hb_mgr_)       hb_mgr_->stop();
+  if (scheduler_)    scheduler_->stop();
+  snapshots_->stop();
+  if (server_) {
+    server_->Shutdown(std::chrono::system_clock::now() + kShutdownGrace);
+  }
+  // After the server: the lanes' queues only drain once it is shut down
+  if (ingest_lane_)    ingest_lane_->stop();
+  if (consensus_lane_) consensus_lane_->stop();
+  if (control_lane_)   control_lane_->stop();
+  if (metrics_server_) metrics_server_->stop();
+}
+
+void Node::exportGauges(MetricsRegistry& metrics) {
+  metrics.SetGaugeFn("mempool_depth", "Audits waiting for a block",
+    [this]{ return static_cast<double>(mempool_->Size()); });
+  metrics.SetGaugeFn("chain_head_id", "Id of the last committed block",
+    [this]{ return static_cast<double>(chain_.getLastID()); });
+  metrics.SetGaugeFn("audit_index_size", "Audits in the QueryAudits index",
+    [this]{ return static_cast<double>(audit_index_->Size()); });
+  metrics.SetGaugeFn("gossip_pending", "Audits queued for gossip to peers",
+    [this]{
+      return file_svc_ ? static_cast<double>(file_svc_->gossipPending()) : 0;
+    });
+  metrics.SetGaugeFn("ingest_pressure",
+    "How close the node is to refusing audits (0-100)",
+    [this]{ return static_cast<double>(admission_->Pressure()); });
+  metrics.SetGaugeFn("block_cache_bytes", "Bytes held by the GetBlock cache",
+    [this]{ return static_cast<double>(block_cache_->GetStats().bytes); });
+  metrics.SetGaugeFn("block_cache_hit_ratio", "GetBlock cache hit rate",
+    [this]{ return block_cache_->GetStats().HitRate(); });
+}
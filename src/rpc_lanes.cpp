@@ -0,0 +1,62 @@
+// src/rpc_lanes.cpp
+
+#include "rpc_lanes.h"
+#include "logger.h"
+#include <algorithm>
+
+RpcLane::RpcLane(grpc::ServerBuilder& builder, Options opts)
+  : opts_(std::move(opts))
+  , cq_(builder.AddCompletionQueue())
+{
+  opts_.threads     = std::max(1, opts_.threads);
+  opts_.queue_limit = std::max(1, opts_.queue_limit);
+}
+
+RpcLane::~RpcLane() {
+  stop();
+}
+
+void RpcLane::start() {
+  for (size_t m = 0; m < request_next_.size(); ++m) {
+    for (int i = 0; i < opts_.queue_limit; ++i) arm(m);
+  }
+  for (int i = 0; i < opts_.threads; ++i) {
+    threads_.emplace_back(&RpcLane::loop, this);
+  }
+  LOG_INFO("RpcLane") << opts_.name << " lane: methods="
+                      << request_next_.size() << " threads=" << opts_.threads;
+}
+
+void RpcLane::stop() {
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (shutdown_) return;
+    shutdown_ = true;
+    cq_->Shutdown();
+  }
+  // The queue must be drained before it is destroyed, started or not
+  if (threads_.empty()) {
+    loop();
+  }
+  for (auto& t : threads_) t.join();
+  threads_.clear();
+}
+
+void RpcLane::arm(size_t m) {
+  std::lock_guard<std::mutex> lk(mu_);
+  if (!shutdown_) request_next_[m]();
+}
+
+grpc::Status RpcLane::handlerThrew(const char* what) const {
+  LOG_ERROR("RpcLane") << opts_.name << " lane: handler threw: " << what;
+  return grpc::Status(grpc::StatusCode::UNKNOWN,
+                      std::string("handler threw: ") + what);
+}
+
+void RpcLane::loop() {
+  void* tag = nullptr;
+  bool  ok  = false;
+  while (cq_->Next(&tag, &ok)) {
+    static_cast<Call*>(tag)->proceed(ok);
+  }
+}
@@ -0,0 +1,91 @@
+// src/rpc_metrics.cpp
+
+#include "rpc_metrics.h"
+#include <chrono>
+#include <mutex>
+
+namespace {
+
+class RpcMetricsInterceptor : public grpc::experimental::Interceptor {
+public:
+  RpcMetricsInterceptor(RpcMetricsInterceptorFactory& factory,
+                        RpcMetricsInterceptorFactory::Method& method)
+    : factory_(factory)
+    , method_(method)
+    , start_(std::chrono::steady_clock::now()) {}
+
+  void Intercept(grpc::experimental::InterceptorBatchMethods* m) override {
+    using grpc::experimental::InterceptionHookPoints;
+    if (m->QueryInterceptionHookPoint(InterceptionHookPoints::PRE_SEND_STATUS)) {
+      method_.latency->Record(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - start_));
+      factory_.Handled(method_, m->GetSendStatus().error_code());
+    }
+    m->Proceed();
+  }
+
+private:
+  RpcMetricsInterceptorFactory&         factory_;
+  RpcMetricsInterceptorFactory::Method& method_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+const char* CodeName(grpc::StatusCode code) {
+  static const char* const kNames[] = {
+    "OK", "CANCELLED", "UNKNOWN", "INVALID_ARGUMENT", "DEADLINE_EXCEEDED",
+    "NOT_FOUND", "ALREADY_EXISTS", "PERMISSION_DENIED", "RESOURCE_EXHAUSTED",
+    "FAILED_PRECONDITION", "ABORTED", "OUT_OF_RANGE", "UNIMPLEMENTED",
+    "INTERNAL", "UNAVAILABLE", "DATA_LOSS", "UNAUTHENTICATED"};
+  auto i = static_cast<size_t>(code);
+  return i < sizeof(kNames) / sizeof(kNames[0]) ? kNames[i] : "UNKNOWN";
+}
+
+}  // namespace
+
+RpcMetricsInterceptorFactory::RpcMetricsInterceptorFactory(
+    MetricsRegistry& registry)
+  : registry_(registry) {}
+
+grpc::experimental::Interceptor*
+RpcMetricsInterceptorFactory::CreateServerInterceptor(
+    grpc::experimental::ServerRpcInfo* info)
+{
+  return new RpcMetricsInterceptor(*this, method(info->method()));
+}
+
+RpcMetricsInterceptorFactory::Method&
+RpcMetricsInterceptorFactory::method(const char* full_name) {
+  {
+    std::shared_lock<std::shared_mutex> lk(mu_);
+    auto it = methods_.find(full_name);
+    if (it != methods_.end()) return *it->second;
+  }
+  std::unique_lock<std::shared_mutex> lk(mu_);
+  auto& m = methods_[full_name];
+  if (!m) {
+    // "/blockchain.BlockChainService/GetBlock" -> "BlockChainService/GetBlock"
+    std::string name = full_name;
+    auto dot = name.find('.');
+    if (dot != std::string::npos) name = name.substr(dot + 1);
+    m = std::make_unique<Method>();
+    m->name    = name;
+    m->latency = &registry_.GetHistogram(
+      "rpc_server_handling_seconds", "Time from call start to status, by method",
+      {{"method", name}});
+  }
+  return *m;
+}
+
+void RpcMetricsInterceptorFactory::Handled(Method& m, grpc::StatusCode code) {
+  auto i = static_cast<size_t>(code);
+  if (i >= m.by_code.size()) i = static_cast<size_t>(grpc::StatusCode::UNKNOWN);
+  Counter* c = m.by_code[i].load(std::memory_order_acquire);
+  if (!c) {
+    c = &registry_.GetCounter(
+      "rpc_server_handled_total", "RPCs finished, by method and status code",
+      {{"method", m.name}, {"code", CodeName(static_cast<grpc::StatusCode>(i))}});
+    m.by_code[i].store(c, std::memory_order_release);
+  }
+  c->Inc();
+}
@@ -1,94 +1,87 @@
 // src/server.cpp
 
 #include "server.h"
+#include "logger.h"
 #include "merkle_tree.h"    
 #include "heartbeat_table.h"   
 #include "election_state.h"                   // SHA256Hex, ComputeMerkleRoot
 #include <google/protobuf/util/json_util.h>       // MessageToJsonString
-#include <openssl/pem.h>
-#include <openssl/evp.h>
-#include <openssl/bio.h>
-#include <openssl/buffer.h>
-#include <iostream>
+#include "signature_verifier.h"                // VerifySignature
+#include "verification_pool.h"
+#include "canonical_payload.h"                 // CanonicalPayload
+#include "compact_block.h"                     // ExpandProposal
+#include <algorithm>
 #include <chrono>
+#include <deque>
 #include <unordered_set>
-#include <nlohmann/json.hpp>
 #include <filesystem>
 #include <fstream>
 #include <sstream>
-using ordered_json = nlohmann::ordered_json;
 namespace fs = std::filesystem;
 using namespace std::chrono;
 
 using google::protobuf::util::MessageToJsonString;
 using google::protobuf::util::JsonStringToMessage;
 
-static constexpr auto kGossipTimeoutMs = 200;
-
-// Utility: Base64-decode into a byte vector
-static std::vector<unsigned char> Base64Decode(const std::string& b64) {
-  BIO* bmem  = BIO_new_mem_buf(b64.data(), (int)b64.size());
-  BIO* b64f  = BIO_new(BIO_f_base64());
-  BIO_set_flags(b64f, BIO_FLAGS_BASE64_NO_NL);
-  bmem = BIO_push(b64f, bmem);
-  std::vector<unsigned char> out(b64.size());
-  int len = BIO_read(bmem, out.data(), (int)out.size());
-  BIO_free_all(bmem);
-  if (len < 0) return {};
-  out.resize(len);
-  return out;
+// Most blocks one GetBlocks stream sends; callers ask again for the rest.
+static constexpr int64_t kMaxBlocksPerStream = 4096;
+// Log BlockCache statistics after this many GetBlock calls.
+static constexpr uint64_t kCacheLogEvery = 1000;
+// QueryAudits page size when none is given, and the largest allowed.
+static constexpr int kDefaultAuditPage = 100;
+static constexpr int kMaxAuditPage     = 1000;
+// Error for an audit whose key_id this node does not hold.
+static constexpr const char* kUnknownKeyId =
+  "unknown key_id; resend with public_key";
+// Accepted compact proposals kept for their commits (a few are in flight
+// when the leader pipelines blocks).
+static constexpr size_t kMaxProposals = 8;
+
+// RESOURCE_EXHAUSTED for load shedding, with the retry hint also sent as
+// trailing metadata (a unary reply body is dropped on errors)
+static grpc::Status Refused(grpc::ServerContext* ctx,
+                            const AdmissionControl::Decision& d) {
+  ctx->AddTrailingMetadata("retry-after-ms",
+                           std::to_string(d.retry_after.count()));
+  if (!d.redirect.empty()) ctx->AddTrailingMetadata("redirect-addr", d.redirect);
+  return grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED, d.message());
 }
 
-// Utility: verify signature_b64 over data using PEM public key
-static bool VerifySignature(
-    const std::string& data,
-    const std::string& signature_b64,
-    const std::string& pubkey_pem)
-{
-  auto sig = Base64Decode(signature_b64);
-  std::cout << "[VerifySignature] decoded signature (len="
-            << sig.size() << ")\n";
-  BIO* bio = BIO_new_mem_buf(pubkey_pem.data(), (int)pubkey_pem.size());
-  EVP_PKEY* pkey = PEM_read_bio_PUBKEY(bio, NULL, NULL, NULL);
-  BIO_free(bio);
-  std::cout << "[VerifySignature] decoded public key (len="
-            << pubkey_pem << ")\n";
-  std::cout << "Signature: " << signature_b64 << "\n";
-  std::cout << "Data: " << data << "\n";
-  if (!pkey) return false;
-
-  EVP_MD_CTX* ctx = EVP_MD_CTX_new();
-  
-  EVP_DigestVerifyInit(ctx, NULL, EVP_sha256(), NULL, pkey);
-
-  EVP_PKEY_CTX *pctx = EVP_MD_CTX_pkey_ctx(ctx);
-  if (EVP_PKEY_CTX_set_rsa_padding(pctx, RSA_PKCS1_PADDING) <= 0) {
-    std::cerr << "Failed to set RSA padding\n";
+// Verify one audit unless this exact audit was verified before; `key_id`
+// is passed only when it is known to match the PEM
+static bool VerifyOnce(const common::FileAudit& a, const std::string& payload,
+                       VerifiedAuditSet& verified,
+                       const std::string& key_id = {}) {
+  std::string digest = VerifiedAuditSet::Digest(payload, a);
+  if (verified.Contains(a.req_id(), digest)) return true;
+  if (!VerifySignature(payload, a.signature(), a.public_key(), key_id)) {
+    return false;
   }
-
-  EVP_DigestVerifyUpdate(ctx, data.data(), data.size());
-  int rc = EVP_DigestVerifyFinal(ctx, sig.data(), sig.size());
-  std::cout << "[VerifySignature] EVP_DigestVerifyFinal rc="
-            << rc << "\n";
-  EVP_MD_CTX_free(ctx);
-  EVP_PKEY_free(pkey);
-  return rc == 1;
+  verified.Add(a.req_id(), std::move(digest));
+  return true;
 }
 
 // -- FileAuditServiceImpl -------------------------------------------------
 
 FileAuditServiceImpl::FileAuditServiceImpl(
     const std::vector<std::string>& peers,
-    std::shared_ptr<MempoolManager> mempool)
+    std::shared_ptr<MempoolManager> mempool,
+    std::shared_ptr<VerifiedAuditSet> verified,
+    std::shared_ptr<AdmissionControl> admission,
+    std::shared_ptr<KeyRegistry> keys)
   : mempool_(std::move(mempool))
+  , verified_(std::move(verified))
+  , admission_(std::move(admission))
+  , keys_(std::move(keys))
 {
   for (auto& addr : peers) {
-    std::cout << "[FileAuditServiceImpl] gossip to peer="
-              << addr << "\n";
+    LOG_INFO("FileAuditServiceImpl") << "gossip to peer=" << addr;
     auto chan = grpc::CreateChannel(addr, grpc::InsecureChannelCredentials());
     gossip_stubs_.push_back(
       blockchain::BlockChainService::NewStub(chan));
   }
+  gossip_ = std::make_unique<GossipPipeline>(
+    peers, gossip_stubs_, GossipPipeline::Options{}, keys_);
 }
 
 std::vector<std::unique_ptr<blockchain::BlockChainService::Stub>>&
@@ -97,71 +90,100 @@ FileAuditServiceImpl::getGossipStubs() {
 }
 
 
-grpc::Status FileAuditServiceImpl::SubmitAudit(
-    grpc::ServerContext* /*ctx*/,
-    const common::FileAudit* request,
-    fileaudit::FileAuditResponse* response)
+// Verify, persist and gossip one client audit; fills the per-audit reply
+grpc::StatusCode FileAuditServiceImpl::ingest(
+    const common::FileAudit& submitted,
+    fileaudit::FileAuditResponse* response,
+    AdmissionControl::Decision* refused)
 {
+  response->set_req_id(submitted.req_id());
+  auto refuse = [&](const AdmissionControl::Decision& d) {
+    if (refused) *refused = d;
+    LOG_WARN_EVERY_MS("Admission", 1000)
+      << "refusing audits: " << d.message()
+      << " (pressure " << admission_->Pressure() << ")";
+    response->set_status("failure");
+    response->set_error_message(d.message());
+    response->set_retry_after_ms(d.retry_after.count());
+    response->set_redirect_addr(d.redirect);
+    return grpc::StatusCode::RESOURCE_EXHAUSTED;
+  };
 
-  std::cout << "[SubmitAudit] client signature="
-            << request->signature() << "\n";
-  std::cout << "[SubmitAudit] client public key="
-            << request->public_key() << "\n";
-  std::cout << "[SubmitAudit] verifying client signature\n";
-
-  // 1) Canonical JSON payload (sorted keys)
-  ordered_json j;
-  j["access_type"] = request->access_type();
-  j["file_info"]   = {{"file_id",   request->file_info().file_id()},
-                      {"file_name", request->file_info().file_name()}};
-  j["req_id"]      = request->req_id();
-  j["timestamp"]   = request->timestamp();
-  j["user_info"]   = {{"user_id",   request->user_info().user_id()},
-                      {"user_name", request->user_info().user_name()}};
-  std::string payload = j.dump();
-  std::cout << "[SubmitAudit] payload=" << payload << "\n";
-
-  if (!VerifySignature(payload,
-                       request->signature(),
-                       request->public_key())) {
-    return grpc::Status(
-      grpc::StatusCode::INVALID_ARGUMENT,
-      "Invalid client signature");
+  // 0) Shed load before the signature check, which is the expensive part
+  if (admission_) {
+    auto d = admission_->AdmitClient();
+    if (!d.ok()) return refuse(d);
   }
-  std::cout << "[SubmitAudit] verified client signature\n";
 
-  // 2) Persist to mempool
-  mempool_->Append(*request);
-
-  // 3) Gossip to peers
-for (auto& stub : gossip_stubs_) {
-    // create a new context and set a 200 ms deadline
-    grpc::ClientContext ctx2;
-    ctx2.set_deadline(
-      std::chrono::system_clock::now() +
-      std::chrono::milliseconds(kGossipTimeoutMs)
-    );
-
-    blockchain::WhisperResponse wr;
-    auto st = stub->WhisperAuditRequest(&ctx2, *request, &wr);
-
-    if (!st.ok()) {
-      if (st.error_code() == grpc::StatusCode::DEADLINE_EXCEEDED) {
-        std::cerr << "[Gossip] to peer timed out after "
-                  << kGossipTimeoutMs << "ms\n";
-      } else {
-        std::cerr << "[Gossip] to peer failed: "
-                  << st.error_message() << "\n";
-      }
-    } else {
-      std::cout << "[Gossip] to peer succeeded: "
-                << wr.status() << "\n";
+  // 0b) A key sent by key_id alone must be one we hold; the client then
+  //     resends the audit with its PEM
+  common::FileAudit resolved;
+  const bool by_id = NeedsKey(submitted);
+  if (by_id) {
+    resolved = submitted;
+    if (!keys_ || !keys_->Resolve(&resolved)) {
+      response->set_status("failure");
+      response->set_error_message(kUnknownKeyId);
+      response->set_unknown_key_id(true);
+      return grpc::StatusCode::FAILED_PRECONDITION;
     }
   }
+  const common::FileAudit& audit = by_id ? resolved : submitted;
+
+  // 1) Check the signature over the canonical JSON payload
+  std::string payload = CanonicalPayload(audit);
+  if (!VerifyOnce(audit, payload, *verified_,
+                  by_id ? submitted.key_id() : std::string())) {
+    response->set_status("failure");
+    response->set_error_message("Invalid client signature");
+    return grpc::StatusCode::INVALID_ARGUMENT;
+  }
+
+  // 1b) The client's own rate limit, charged only for audits it signed
+  if (admission_) {
+    auto d = admission_->AdmitFrom(audit);
+    if (!d.ok()) return refuse(d);
+  }
+
+  // 2) Persist to mempool; the reply does not wait for peers
+  if (mempool_->Append(audit, SHA256Hex(payload))) {
+    // 3) Hand off to the background gossip stage (new audits only)
+    gossip_->Enqueue(audit);
+  }
 
-  // 4) Reply to client
-  response->set_req_id(request->req_id());
   response->set_status("success");
+  return grpc::StatusCode::OK;
+}
+
+grpc::Status FileAuditServiceImpl::SubmitAudit(
+    grpc::ServerContext* ctx,
+    const common::FileAudit* request,
+    fileaudit::FileAuditResponse* response)
+{
+  AdmissionControl::Decision refused;
+  auto code = ingest(*request, response, &refused);
+  if (code == grpc::StatusCode::RESOURCE_EXHAUSTED) {
+    return Refused(ctx, refused);
+  }
+  if (code != grpc::StatusCode::OK) {
+    return grpc::Status(code, response->error_message());
+  }
+  return grpc::Status::OK;
+}
+
+grpc::Status FileAuditServiceImpl::SubmitAudits(
+    grpc::ServerContext* /*ctx*/,
+    grpc::ServerReaderWriter<fileaudit::FileAuditResponse,
+                             common::FileAudit>* stream)
+{
+  // Acks go back in request order; a bad or refused audit fails only its
+  // own ack (a refusal carries retry_after_ms)
+  common::FileAudit audit;
+  while (stream->Read(&audit)) {
+    fileaudit::FileAuditResponse ack;
+    ingest(audit, &ack);
+    if (!stream->Write(ack)) break;   // client went away
+  }
   return grpc::Status::OK;
 }
 
@@ -173,90 +195,191 @@ BlockChainServiceImpl::BlockChainServiceImpl(
     ChainManager& chain,
     std::shared_ptr<HeartbeatTable> hb_table,
     ElectionState& election_state,
-    std::string self_addr)
+    std::string self_addr,
+    std::shared_ptr<BlockStore> blocks,
+    std::shared_ptr<VerifiedAuditSet> verified,
+    std::shared_ptr<SnapshotManager> snapshots,
+    std::shared_ptr<BlockCache> cache,
+    std::shared_ptr<AuditIndex> index,
+    std::shared_ptr<AdmissionControl> admission,
+    std::shared_ptr<KeyRegistry> keys)
   : mempool_(std::move(mempool))
   , chain_(chain)
   , hb_table_(std::move(hb_table))
   , state_(election_state)
   , self_addr_(std::move(self_addr))
+  , blocks_(std::move(blocks))
+  , verified_(std::move(verified))
+  , snapshots_(std::move(snapshots))
+  , cache_(std::move(cache))
+  , index_(std::move(index))
+  , admission_(std::move(admission))
+  , keys_(std::move(keys))
 {}
 
 grpc::Status BlockChainServiceImpl::WhisperAuditRequest(
-    grpc::ServerContext* /*ctx*/,
-    const common::FileAudit* request,
+    grpc::ServerContext* ctx,
+    const common::FileAudit* gossiped,
     blockchain::WhisperResponse* response)
 {
-  std::cout << "[WhisperAuditRequest] audit request received\n";
-  std::cout << "  req_id:    " << request->req_id() << "\n";
-  std::cout << "  file_info: id=" << request->file_info().file_id()
-            << ", name=" << request->file_info().file_name() << "\n";
-  std::cout << "  user_info: id=" << request->user_info().user_id()
-            << ", name=" << request->user_info().user_name() << "\n";
-  std::cout << "  access:    " << request->access_type()
-            << ", timestamp=" << request->timestamp() << "\n";
-  std::cout << "  signature: (len=" << request->signature().size() << ")\n";
-  std::cout << "  public_key: (len=" << request->public_key().size() << ")\n";
-
-  ordered_json j;
-  j["access_type"] = request->access_type();
-  j["file_info"]   = {{"file_id",   request->file_info().file_id()},
-                      {"file_name", request->file_info().file_name()}};
-  j["req_id"]      = request->req_id();
-  j["timestamp"]   = request->timestamp();
-  j["user_info"]   = {{"user_id",   request->user_info().user_id()},
-                      {"user_name", request->user_info().user_name()}};
-  std::string payload2 = j.dump();
-  std::cout << "[SubmitAudit] payload=" << payload2 << "\n";
-
-
-  if (!VerifySignature(payload2,
-                       request->signature(),
-                       request->public_key()))
-  {
-    std::cerr << "[WhisperAuditRequest] invalid signature for req_id="
-              << request->req_id() << "\n";
+  // 0) A full mempool refuses it; the peer's gossip retries later
+  if (admission_) {
+    auto d = admission_->AdmitGossip(1);
+    if (!d.ok()) return Refused(ctx, d);
+  }
+
+  // 0b) An audit sent by key_id alone gets its PEM from our registry
+  common::FileAudit resolved;
+  const bool by_id = NeedsKey(*gossiped);
+  if (by_id) {
+    resolved = *gossiped;
+    if (!keys_ || !keys_->Resolve(&resolved)) {
+      return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, kUnknownKeyId);
+    }
+  }
+  const common::FileAudit* request = by_id ? &resolved : gossiped;
+
+  // 1) Check the signature (skipped if we already verified this audit)
+  std::string payload = CanonicalPayload(*request);
+  if (!VerifyOnce(*request, payload, *verified_,
+                  by_id ? gossiped->key_id() : std::string())) {
+    LOG_WARN_EVERY_MS("WhisperAuditRequest", 1000)
+      << "invalid signature for req_id="
+      << request->req_id();
     return grpc::Status(
       grpc::StatusCode::INVALID_ARGUMENT,
       "Invalid signature in gossiped audit");
-  } else {
-    std::cout << "[WhisperAuditRequest] verified signature for req_id="
-              << request->req_id() << "\n";
   }
 
   // 2) Persist to mempool
-  mempool_->Append(*request);
-
-  // 3) Log that it's added
-  std::cout << "[WhisperAuditRequest] audit added to mempool\n";
+  mempool_->Append(*request, SHA256Hex(payload));
 
-  // 4) Ack
+  // 3) Ack
   response->set_status("success");
   return grpc::Status::OK;
 }
 
+grpc::Status BlockChainServiceImpl::WhisperAuditBatch(
+    grpc::ServerContext* ctx,
+    const blockchain::AuditBatch* request,
+    blockchain::WhisperBatchResponse* response)
+{
+  const int n = request->audits_size();
+  if (admission_) {
+    auto d = admission_->AdmitGossip(static_cast<size_t>(n));
+    if (!d.ok()) return Refused(ctx, d);
+  }
+
+  // Audits sent by key_id alone get their PEM from our registry; the ones
+  // we cannot resolve are skipped and named in the reply
+  std::vector<const common::FileAudit*> audits(n);
+  std::deque<common::FileAudit> resolved;
+  std::unordered_set<std::string> unknown_keys;
+  for (int i = 0; i < n; ++i) {
+    auto& a = request->audits(i);
+    if (!NeedsKey(a)) {
+      audits[i] = &a;
+      continue;
+    }
+    resolved.push_back(a);
+    if (keys_ && keys_->Resolve(&resolved.back())) {
+      audits[i] = &resolved.back();
+    } else {
+      resolved.pop_back();
+      unknown_keys.insert(a.key_id());
+    }
+  }
+
+  // Verify the new audits on the pool; on a failure, sort out which ones
+  std::vector<std::string> payloads(n), digests(n);
+  std::vector<bool> known(n);
+  std::vector<VerificationPool::Item> items;
+  for (int i = 0; i < n; ++i) {
+    if (!audits[i]) continue;
+    auto& a = *audits[i];
+    payloads[i] = CanonicalPayload(a);
+    digests[i]  = VerifiedAuditSet::Digest(payloads[i], a);
+    known[i] = verified_->Contains(a.req_id(), digests[i]);
+    if (!known[i]) {
+      items.push_back({&payloads[i], &a.signature(), &a.public_key(),
+                       &a != &request->audits(i)
+                         ? &request->audits(i).key_id() : nullptr});
+    }
+  }
+  bool all_valid = VerificationPool::Shared().VerifyAll(items) < 0;
+
+  int accepted = 0, invalid = 0;
+  for (int i = 0; i < n; ++i) {
+    if (!audits[i]) continue;
+    auto& a = *audits[i];
+    if (!known[i]) {
+      if (!all_valid &&
+          !VerifySignature(payloads[i], a.signature(), a.public_key(),
+                           &a != &request->audits(i)
+                             ? request->audits(i).key_id() : std::string())) {
+        LOG_WARN_EVERY_MS("WhisperAuditBatch", 1000)
+          << "invalid signature for req_id="
+          << a.req_id();
+        ++invalid;
+        continue;
+      }
+      verified_->Add(a.req_id(), std::move(digests[i]));
+    }
+    if (mempool_->Append(a, SHA256Hex(payloads[i]))) ++accepted;
+  }
+  LOG_DEBUG("WhisperAuditBatch") << request->audits_size()
+                                 << " audits received, " << accepted << " new, "
+                                 << invalid << " invalid";
+
+  response->set_accepted(accepted);
+  response->set_interns_keys(keys_ != nullptr);
+  for (auto& id : unknown_keys) response->add_unknown_key_ids(id);
+  if (invalid) {
+    response->set_status("failure");
+    response->set_error_message(std::to_string(invalid) +
+                                " audits with invalid signatures");
+  } else {
+    response->set_status("success");
+  }
+  return grpc::Status::OK;
+}
+
 grpc::Status BlockChainServiceImpl::ProposeBlock(
     grpc::ServerContext* /*ctx*/,
-    const blockchain::Block* blk,
+    const blockchain::Block* proposal,
     blockchain::BlockVoteResponse* resp)
 {
+  // 0) A compact proposal is rebuilt from our mempool; audits we lack are
+  //    asked for, and the leader proposes again with them attached
+  const bool compact = proposal->audit_ids_size() > 0;
+  auto expanded = std::make_shared<blockchain::Block>();
+  const blockchain::Block* blk = proposal;
+  if (compact) {
+    std::vector<std::string> missing;
+    if (!ExpandProposal(*proposal, *mempool_, expanded.get(), &missing)) {
+      for (auto& id : missing) resp->add_missing_ids(id);
+      resp->set_vote(false);
+      resp->set_status("failure");
+      resp->set_error_message(std::to_string(missing.size()) +
+                              " audits missing");
+      return grpc::Status::OK;
+    }
+    blk = expanded.get();
+  }
+
   // 1) Recompute Merkle root from the same JSON-hashes Python uses
-  std::vector<std::string> leafs;
+  std::vector<std::string> payloads, leafs;
+  payloads.reserve(blk->audits_size());
+  leafs.reserve(blk->audits_size());
   for (auto& a : blk->audits()) {
-    ordered_json j;
-    j["access_type"] = a.access_type();
-    j["file_info"]   = {
-      {"file_id",   a.file_info().file_id()},
-      {"file_name", a.file_info().file_name()}
-    };
-    j["req_id"]      = a.req_id();
-    j["timestamp"]   = a.timestamp();
-    j["user_info"]   = {
-      {"user_id",   a.user_info().user_id()},
-      {"user_name", a.user_info().user_name()}
-    };
-    leafs.push_back(SHA256Hex(j.dump()));
+    payloads.push_back(CanonicalPayload(a));
+    leafs.push_back(SHA256Hex(payloads.back()));
   }
   if (ComputeMerkleRoot(leafs) != blk->merkle_root()) {
+    // Our copies may differ from the leader's: ask for all of them
+    if (compact && proposal->audits_size() < proposal->audit_ids_size()) {
+      *resp->mutable_missing_ids() = proposal->audit_ids();
+    }
     resp->set_vote(false);
     resp->set_status("failure");
     resp->set_error_message("bad merkle_root");
@@ -289,24 +412,39 @@ grpc::Status BlockChainServiceImpl::ProposeBlock(
   //     return grpc::Status::OK;
   //   }
   // }
-  // // 4) verify each audit’s signature…
-  // for (auto& a : blk->audits()) {
-  //   common::FileAudit copy = a;
-  //   copy.clear_signature();
-  //   copy.clear_public_key();
-  //   std::string payload;
-  //   copy.SerializeToString(&payload);
-  //   if (!VerifySignature(
-  //         payload,
-  //         a.signature(),
-  //         a.public_key()))
-  //   {
-  //     resp->set_vote(false);
-  //     resp->set_status("failure");
-  //     resp->set_error_message("invalid audit signature: " + a.req_id());
-  //     return grpc::Status::OK;
-  //   }
-  // }
+  // 4) verify each audit's signature across the pool, skipping audits
+  //    already verified when they were gossiped to us
+  std::vector<std::string> digests;
+  std::vector<int> unverified;
+  std::vector<VerificationPool::Item> items;
+  digests.reserve(blk->audits_size());
+  for (int i = 0; i < blk->audits_size(); ++i) {
+    auto& a = blk->audits(i);
+    digests.push_back(VerifiedAuditSet::Digest(payloads[i], a));
+    if (verified_->Contains(a.req_id(), digests[i])) continue;
+    unverified.push_back(i);
+    items.push_back({&payloads[i], &a.signature(), &a.public_key()});
+  }
+  long bad = VerificationPool::Shared().VerifyAll(items);
+  if (bad >= 0) {
+    resp->set_vote(false);
+    resp->set_status("failure");
+    resp->set_error_message("invalid audit signature: " +
+                            blk->audits(unverified[bad]).req_id());
+    return grpc::Status::OK;
+  }
+  for (int i : unverified) {
+    verified_->Add(blk->audits(i).req_id(), std::move(digests[i]));
+  }
+
+  // 5) Keep the rebuilt block for the compact commit that follows
+  if (compact) {
+    std::lock_guard<std::mutex> lk(proposals_mu_);
+    proposals_[blk->id()] = std::move(expanded);
+    while (proposals_.size() > kMaxProposals) {
+      proposals_.erase(proposals_.begin());
+    }
+  }
 
   resp->set_vote(true);
   resp->set_status("success");
@@ -315,11 +453,33 @@ grpc::Status BlockChainServiceImpl::ProposeBlock(
 
 grpc::Status BlockChainServiceImpl::CommitBlock(
     grpc::ServerContext* /*ctx*/,
-    const blockchain::Block* blk,
+    const blockchain::Block* commit,
     blockchain::BlockCommitResponse* resp) 
 {
-  std::cout << "[CommitBlock] received block id=" << blk->id()
-            << ", merkle_root=" << blk->merkle_root() << "\n";
+  // 0) A compact commit names a block we accepted as a compact proposal
+  std::shared_ptr<const blockchain::Block> proposed;
+  const blockchain::Block* blk = commit;
+  {
+    std::lock_guard<std::mutex> lk(proposals_mu_);
+    if (IsCompactCommit(*commit)) {
+      auto it = proposals_.find(commit->id());
+      if (it == proposals_.end() || it->second->hash() != commit->hash()) {
+        LOG_DEBUG("CommitBlock") << "no proposal for block id="
+                                 << commit->id() << ", asking for it in full";
+        resp->set_status("failure");
+        resp->set_error_message("unknown block");
+        resp->set_unknown_block(true);
+        return grpc::Status::OK;
+      }
+      proposed = it->second;
+      blk = proposed.get();
+    }
+    proposals_.erase(proposals_.begin(),
+                     proposals_.upper_bound(commit->id()));
+  }
+
+  LOG_DEBUG("CommitBlock") << "received block id=" << blk->id()
+                           << ", merkle_root=" << blk->merkle_root();
   // // 1) verify merkle root
   // std::vector<std::string> leafs;
   // for (auto& a : blk->audits()) {
@@ -342,7 +502,10 @@ grpc::Status BlockChainServiceImpl::CommitBlock(
 
   // // 3) (optional) verify each audit’s signature here…
 
-  // 4) commit into chain.json
+  // 4) commit into chain.json; cached and indexed first, so GetBlock and
+  //    QueryAudits can serve it before the block store has it
+  if (cache_) cache_->PutBlock(*blk);
+  if (index_) index_->AddBlock(*blk);
   BlockMeta meta {
     blk->id(),
     blk->hash(),
@@ -355,96 +518,297 @@ grpc::Status BlockChainServiceImpl::CommitBlock(
   std::vector<std::string> ids;
   for (auto& a : blk->audits()) ids.push_back(a.req_id());
   mempool_->RemoveBatch(ids);
+  verified_->Remove(ids);
 
-  // 6) write full block out to its own file
-  try {
-    fs::create_directories("../blocks");
-    std::string block_json;
-    google::protobuf::util::MessageToJsonString(*blk, &block_json);
-
-    std::string path = "../blocks/block_" + std::to_string(blk->id()) + ".json";
-    std::ofstream out(path);
-    if (!out) {
-      std::cerr << "[CommitBlock] ERROR writing block file: " << path << "\n";
-      resp->set_status("failure");
-      resp->set_error_message("could not write block file");
-      return grpc::Status::OK;
-    }
-    out << block_json;
-    out.close();
-    std::cout << "[CommitBlock] wrote block file " << path << "\n";
-  } catch (const std::exception& e) {
-    std::cerr << "[CommitBlock] exception writing block file: " << e.what() << "\n";
+  // 6) append the full block to the block store
+  if (!blocks_->Put(*blk)) {
+    LOG_ERROR("CommitBlock") << "cannot store block id=" << blk->id();
     resp->set_status("failure");
-    resp->set_error_message("exception writing block file");
+    resp->set_error_message("could not store block");
     return grpc::Status::OK;
   }
+  LOG_DEBUG("CommitBlock") << "stored block id=" << blk->id();
 
   resp->set_status("success");
   return grpc::Status::OK;
 }
 
-grpc::Status BlockChainServiceImpl::GetBlock(
+// Failure replies are rare and small, so they are never cached
+static BlockCache::Bytes FailureReply(const std::string& error) {
+  blockchain::GetBlockResponse resp;
+  resp.set_status("failure");
+  resp.set_error_message(error);
+  return std::make_shared<const std::string>(resp.SerializeAsString());
+}
+
+BlockCache::Bytes BlockChainServiceImpl::blockReply(int64_t id) {
+  if (id > chain_.getLastID()) return FailureReply("block id out of range");
+  if (cache_) {
+    if (auto bytes = cache_->Get(id)) return bytes;
+  }
+
+  // Miss: read it back from the block store
+  blockchain::Block blk;
+  std::string err;
+  if (!blocks_->Get(id, &blk, &err)) return FailureReply(err);
+  return cache_ ? cache_->PutBlock(blk) : BlockCache::Encode(blk);
+}
+
+grpc::ServerUnaryReactor* BlockChainServiceImpl::GetBlock(
+    grpc::CallbackServerContext* ctx,
+    const grpc::ByteBuffer* request,
+    grpc::ByteBuffer* response)
+{
+  auto* reactor = ctx->DefaultReactor();
+  blockchain::GetBlockRequest req;
+  grpc::ByteBuffer in(*request);
+  if (!grpc::SerializationTraits<blockchain::GetBlockRequest>::Deserialize(
+          &in, &req).ok()) {
+    reactor->Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                 "malformed GetBlockRequest"));
+    return reactor;
+  }
+
+  // Hand the cached bytes to gRPC without copying; the slice keeps them alive
+  auto* bytes = new BlockCache::Bytes(blockReply(req.id()));
+  grpc::Slice slice(const_cast<char*>((*bytes)->data()), (*bytes)->size(),
+                    [](void* p) { delete static_cast<BlockCache::Bytes*>(p); },
+                    bytes);
+  grpc::ByteBuffer out(&slice, 1);
+  response->Swap(&out);
+  reactor->Finish(grpc::Status::OK);
+
+  if (cache_ && ++block_reads_ % kCacheLogEvery == 0) {
+    auto st = cache_->GetStats();
+    LOG_INFO("BlockCache")
+      << st.entries << " blocks, " << st.bytes
+      << " bytes, hit rate " << static_cast<int>(st.HitRate() * 100)
+      << "% (" << st.hits << " hits, " << st.misses << " misses, "
+      << st.evictions << " evictions)";
+  }
+  return reactor;
+}
+
+grpc::Status BlockChainServiceImpl::GetBlocks(
+    grpc::ServerContext* ctx,
+    const blockchain::GetBlocksRequest* req,
+    grpc::ServerWriter<blockchain::Block>* writer)
+{
+  if (req->start_id() < 0 || req->end_id() < req->start_id()) {
+    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "bad block range");
+  }
+  int64_t end = std::min({req->end_id(), chain_.getLastID(),
+                          req->start_id() + kMaxBlocksPerStream - 1});
+
+  blockchain::Block blk;
+  std::string err;
+  for (int64_t id = req->start_id(); id <= end; ++id) {
+    if (ctx->IsCancelled()) return grpc::Status::CANCELLED;
+    if (!blocks_->Get(id, &blk, &err)) {
+      return grpc::Status(grpc::StatusCode::NOT_FOUND, err);
+    }
+    if (!writer->Write(blk)) break;   // client went away
+  }
+  return grpc::Status::OK;
+}
+
+grpc::Status BlockChainServiceImpl::GetSnapshot(
+    grpc::ServerContext* ctx,
+    const blockchain::GetSnapshotRequest* /*req*/,
+    grpc::ServerWriter<blockchain::SnapshotChunk>* writer)
+{
+  bool found = snapshots_ && snapshots_->ForEachChunk(
+    [&](const blockchain::SnapshotChunk& chunk) {
+      return !ctx->IsCancelled() && writer->Write(chunk);
+    });
+  if (!found) {
+    return grpc::Status(grpc::StatusCode::UNAVAILABLE, "no snapshot yet");
+  }
+  return grpc::Status::OK;
+}
+
+grpc::Status BlockChainServiceImpl::GetAuditProof(
     grpc::ServerContext* /*ctx*/,
-    const blockchain::GetBlockRequest* req,
-    blockchain::GetBlockResponse* resp)
+    const blockchain::AuditProofRequest* req,
+    blockchain::AuditProofResponse* resp)
 {
-  int64_t id = req->id();
-  if (id > chain_.getLastID()) {
+  blockchain::Block blk;
+  std::string err;
+  if (req->block_id() > chain_.getLastID() ||
+      !blocks_->Get(req->block_id(), &blk, &err)) {
     resp->set_status("failure");
-    resp->set_error_message("block id out of range");
+    resp->set_error_message(err.empty() ? "block id out of range" : err);
     return grpc::Status::OK;
   }
 
-  // Read the JSON file we wrote earlier
-  std::string path = "../blocks/block_" + std::to_string(id) + ".json";
-  std::ifstream in(path);
-  if (!in) {
+  // Rebuild the block's tree from its audits
+  std::vector<MerkleTree::Digest> leaves(blk.audits_size());
+  int index = -1;
+  for (int i = 0; i < blk.audits_size(); ++i) {
+    MerkleTree::ParseHex(CanonicalLeafHash(blk.audits(i)), &leaves[i]);
+    if (index < 0 && blk.audits(i).req_id() == req->req_id()) index = i;
+  }
+  if (index < 0) {
     resp->set_status("failure");
-    resp->set_error_message("could not open block file");
+    resp->set_error_message("req_id not in block");
     return grpc::Status::OK;
   }
-  std::stringstream buf;
-  buf << in.rdbuf();
-  std::string json = buf.str();
-
-  // Parse back into a Block proto
-  blockchain::Block blk;
-  auto st = JsonStringToMessage(json, &blk);
-  if (!st.ok()) {
+  MerkleTree tree(std::move(leaves));
+  if (tree.RootHex() != blk.merkle_root()) {
     resp->set_status("failure");
-    resp->set_error_message("JSON parse error: " + st.ToString());
+    resp->set_error_message("stored block fails its merkle_root");
     return grpc::Status::OK;
   }
 
-  // Return it
-  *resp->mutable_block() = std::move(blk);
+  resp->set_block_id(blk.id());
+  resp->set_leaf_index(index);
+  resp->set_leaf_hash(CanonicalLeafHash(blk.audits(index)));
+  resp->set_merkle_root(tree.RootHex());
+  for (auto& step : tree.GetProof(index)) {
+    auto* s = resp->add_steps();
+    s->set_sibling(MerkleTree::ToHex(step.sibling));
+    s->set_sibling_is_left(step.sibling_is_left);
+  }
   resp->set_status("success");
   return grpc::Status::OK;
 }
 
+// Translate the wire query; false (with `err`) on a bad page token.
+static bool ParseAuditQuery(const blockchain::AuditQuery& req,
+                            AuditIndex::Query* q, uint64_t* cursor,
+                            std::string* err)
+{
+  q->file_id = req.file_id();
+  q->user_id = req.user_id();
+  if (req.from_timestamp() != 0) q->from_ts = req.from_timestamp();
+  if (req.to_timestamp() != 0)   q->to_ts   = req.to_timestamp();
+  *cursor = 0;
+  if (req.page_token().empty()) return true;
+  try {
+    size_t used = 0;
+    *cursor = std::stoull(req.page_token(), &used);
+    if (used == req.page_token().size()) return true;
+  } catch (const std::exception&) {}
+  *err = "bad page_token";
+  return false;
+}
+
+bool BlockChainServiceImpl::loadAudits(
+    const std::vector<AuditIndex::Hit>& hits,
+    const std::function<bool(blockchain::IndexedAudit&)>& emit,
+    std::string* err) const
+{
+  blockchain::Block blk;
+  blockchain::IndexedAudit out;
+  int64_t loaded = -1;
+  for (auto& h : hits) {
+    if (h.block_id != loaded) {
+      if (!blocks_->Get(h.block_id, &blk, err)) return false;
+      loaded = h.block_id;
+    }
+    if (h.index >= static_cast<uint32_t>(blk.audits_size())) {
+      *err = "block " + std::to_string(h.block_id) + " has no audit " +
+             std::to_string(h.index);
+      return false;
+    }
+    out.set_block_id(h.block_id);
+    out.set_audit_index(static_cast<int32_t>(h.index));
+    *out.mutable_audit() = blk.audits(static_cast<int>(h.index));
+    if (!emit(out)) break;
+  }
+  return true;
+}
+
+grpc::Status BlockChainServiceImpl::QueryAudits(
+    grpc::ServerContext* /*ctx*/,
+    const blockchain::AuditQuery* req,
+    blockchain::AuditQueryResponse* resp)
+{
+  AuditIndex::Query q;
+  uint64_t cursor;
+  std::string err;
+  if (!index_) {
+    err = "audit index disabled";
+  } else if (ParseAuditQuery(*req, &q, &cursor, &err)) {
+    int page = req->page_size() > 0 ? std::min(req->page_size(), kMaxAuditPage)
+                                    : kDefaultAuditPage;
+    uint64_t next;
+    auto hits = index_->Find(q, cursor, static_cast<size_t>(page), &next);
+    if (loadAudits(hits, [&](blockchain::IndexedAudit& a) {
+          resp->add_audits()->Swap(&a);
+          return true;
+        }, &err)) {
+      if (next) resp->set_next_page_token(std::to_string(next));
+      resp->set_status("success");
+      return grpc::Status::OK;
+    }
+  }
+  resp->clear_audits();
+  resp->set_status("failure");
+  resp->set_error_message(err);
+  return grpc::Status::OK;
+}
+
+grpc::Status BlockChainServiceImpl::StreamAudits(
+    grpc::ServerContext* ctx,
+    const blockchain::AuditQuery* req,
+    grpc::ServerWriter<blockchain::IndexedAudit>* writer)
+{
+  if (!index_) {
+    return grpc::Status(grpc::StatusCode::UNAVAILABLE, "audit index disabled");
+  }
+  AuditIndex::Query q;
+  uint64_t cursor;
+  std::string err;
+  if (!ParseAuditQuery(*req, &q, &cursor, &err)) {
+    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, err);
+  }
+
+  // Page through the index so the shared lock is never held for long
+  uint64_t left = req->page_size() > 0 ? static_cast<uint64_t>(req->page_size())
+                                       : UINT64_MAX;
+  bool open = true;
+  while (open && left > 0) {
+    if (ctx->IsCancelled()) return grpc::Status::CANCELLED;
+    uint64_t next;
+    auto hits = index_->Find(
+      q, cursor, static_cast<size_t>(std::min<uint64_t>(left, kMaxAuditPage)),
+      &next);
+    if (!loadAudits(hits, [&](blockchain::IndexedAudit& a) {
+          open = writer->Write(a);   // false: client went away
+          return open;
+        }, &err)) {
+      return grpc::Status(grpc::StatusCode::NOT_FOUND, err);
+    }
+    left -= hits.size();
+    if (next == 0) break;
+    cursor = next;
+  }
+  return grpc::Status::OK;
+}
 
 grpc::Status BlockChainServiceImpl::SendHeartbeat(
     grpc::ServerContext* /*ctx*/,
     const blockchain::HeartbeatRequest* req,
     blockchain::HeartbeatResponse* resp)
 {
-  std::cout << "[SendHeartbeat] from=" << req->from_address()
-            << " leader=" << req->current_leader_address()
-            << " blk=" << req->latest_block_id()
-            << " pool=" << req->mem_pool_size() << "\n";
+  LOG_DEBUG("SendHeartbeat") << "from=" << req->from_address()
+                             << " leader=" << req->current_leader_address()
+                             << " blk=" << req->latest_block_id()
+                             << " pool=" << req->mem_pool_size()
+                             << " pressure=" << req->ingest_pressure();
 
   hb_table_->update(
     req->from_address(),
     req->current_leader_address(),
     req->latest_block_id(),
-    req->mem_pool_size()
+    req->mem_pool_size(),
+    req->ingest_pressure()
   );
 
-  if (state_.getLeader().empty() && !req->current_leader_address().empty()) {
-    state_.setLeader(req->current_leader_address());
-    std::cout << "[SendHeartbeat] learned new leader: "
-                << state_.getLeader() << "\n";
+  if (state_.setLeaderIfUnknown(req->current_leader_address())) {
+    LOG_INFO("SendHeartbeat") << "learned new leader: "
+                              << req->current_leader_address();
   }
   
 
@@ -473,7 +837,7 @@ grpc::Status BlockChainServiceImpl::TriggerElection(
 
   // Our own stats
   int64_t my_blocks = chain_.getLastID();
-  int64_t my_pool   = static_cast<int64_t>(mempool_->LoadAll().size());
+  int64_t my_pool   = static_cast<int64_t>(mempool_->Size());
 
   bool vote_yes = false;
   if (cand_blocks > my_blocks ||
@@ -498,7 +862,7 @@ grpc::Status BlockChainServiceImpl::NotifyLeadership(
     blockchain::NotifyLeadershipResponse* resp)
 {
   state_.setLeader(req->address());
-  std::cout << "[NotifyLeadership] new leader = " << req->address() << "\n";
+  LOG_INFO("NotifyLeadership") << "new leader = " << req->address();
   resp->set_status("success");
   return grpc::Status::OK;
 }
@@ -0,0 +1,138 @@
+// src/signature_verifier.cpp
+
+#include "signature_verifier.h"
+#include "metrics.h"
+#include <openssl/bio.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#include <openssl/sha.h>
+#include <array>
+
+// Base64 alphabet -> 6-bit value; 0x40 = skip (line break), 0x80 = invalid
+static const std::array<uint8_t, 256> kBase64Table = [] {
+  std::array<uint8_t, 256> t{};
+  t.fill(0x80);
+  const char* alphabet =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  for (uint8_t i = 0; i < 64; ++i) t[static_cast<uint8_t>(alphabet[i])] = i;
+  t['\n'] = t['\r'] = 0x40;
+  return t;
+}();
+
+bool Base64Decode(const std::string& b64, std::string* out) {
+  out->clear();
+  out->reserve(b64.size() / 4 * 3);
+  uint32_t acc = 0;
+  int bits = 0;
+  size_t pad = 0;
+  for (unsigned char c : b64) {
+    if (c == '=') { ++pad; continue; }
+    uint8_t v = kBase64Table[c];
+    if (v == 0x40) continue;
+    if (v == 0x80 || pad) return false;   // bad char, or data after padding
+    acc = (acc << 6) | v;
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      out->push_back(static_cast<char>((acc >> bits) & 0xff));
+    }
+  }
+  return pad <= 2;
+}
+
+std::string KeyFingerprint(const std::string& pem) {
+  static const char* kHex = "0123456789abcdef";
+  unsigned char digest[SHA256_DIGEST_LENGTH];
+  SHA256(reinterpret_cast<const unsigned char*>(pem.data()), pem.size(),
+         digest);
+  std::string hex(2 * SHA256_DIGEST_LENGTH, '\0');
+  for (size_t i = 0; i < SHA256_DIGEST_LENGTH; ++i) {
+    hex[2 * i]     = kHex[digest[i] >> 4];
+    hex[2 * i + 1] = kHex[digest[i] & 0xf];
+  }
+  return hex;
+}
+
+// -- PublicKeyCache ---------------------------------------------------------
+
+PublicKeyCache& PublicKeyCache::Shared() {
+  static PublicKeyCache cache;
+  return cache;
+}
+
+PublicKeyCache::Key PublicKeyCache::Get(const std::string& pem,
+                                        const std::string& key_id) {
+  std::string digest = key_id.empty() ? KeyFingerprint(pem) : key_id;
+
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = index_.find(digest);
+    if (it != index_.end()) {
+      lru_.splice(lru_.begin(), lru_, it->second);
+      return it->second->second;
+    }
+  }
+
+  // Miss: parse outside the lock (two threads may race; both results are equal)
+  BIO* bio = BIO_new_mem_buf(pem.data(), static_cast<int>(pem.size()));
+  EVP_PKEY* raw = PEM_read_bio_PUBKEY(bio, nullptr, nullptr, nullptr);
+  BIO_free(bio);
+  if (!raw) return nullptr;
+  Key key(raw, EVP_PKEY_free);
+
+  std::lock_guard<std::mutex> lk(mu_);
+  auto it = index_.find(digest);
+  if (it != index_.end()) return it->second->second;
+  lru_.emplace_front(digest, key);
+  index_.emplace(std::move(digest), lru_.begin());
+  while (lru_.size() > capacity_) {
+    index_.erase(lru_.back().first);
+    lru_.pop_back();
+  }
+  return key;
+}
+
+size_t PublicKeyCache::Size() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  return lru_.size();
+}
+
+// -- VerifySignature --------------------------------------------------------
+
+bool VerifySignature(
+    const std::string& data,
+    const std::string& signature_b64,
+    const std::string& pubkey_pem,
+    const std::string& key_id)
+{
+  static auto& latency = MetricsRegistry::Shared().GetHistogram(
+    "signature_verify_seconds", "RSA signature checks (VerifySignature)");
+  ScopedLatency timer(latency);
+
+  std::string sig;
+  if (!Base64Decode(signature_b64, &sig) || sig.empty()) return false;
+
+  auto pkey = PublicKeyCache::Shared().Get(pubkey_pem, key_id);
+  if (!pkey) return false;
+
+  // One digest context per thread, reset between uses
+  thread_local std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)>
+    ctx(EVP_MD_CTX_new(), EVP_MD_CTX_free);
+  if (!ctx) return false;
+  EVP_MD_CTX_reset(ctx.get());
+
+  EVP_PKEY_CTX* pctx = nullptr;
+  if (EVP_DigestVerifyInit(ctx.get(), &pctx, EVP_sha256(), nullptr,
+                           pkey.get()) != 1) {
+    return false;
+  }
+  if (EVP_PKEY_base_id(pkey.get()) == EVP_PKEY_RSA &&
+      EVP_PKEY_CTX_set_rsa_padding(pctx, RSA_PKCS1_PADDING) <= 0) {
+    return false;
+  }
+  int rc = EVP_DigestVerify(
+    ctx.get(),
+    reinterpret_cast<const unsigned char*>(sig.data()), sig.size(),
+    reinterpret_cast<const unsigned char*>(data.data()), data.size());
+  return rc == 1;
+}
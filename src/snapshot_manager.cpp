@@ -0,0 +1,254 @@
+// src/snapshot_manager.cpp
+
+#include "snapshot_manager.h"
+#include "logger.h"
+#include "canonical_payload.h"    // CanonicalPayload
+#include "merkle_tree.h"          // SHA256Hex
+#include "signature_verifier.h"   // VerifySignature
+#include "storage_format.h"       // AppendDelimited, ReadDelimited, ReplaceFile
+#include "verification_pool.h"
+#include <grpcpp/grpcpp.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <unordered_set>
+
+// Deadline for downloading a whole snapshot during bootstrap.
+static constexpr auto kBootstrapTimeout = std::chrono::seconds(120);
+
+SnapshotManager::SnapshotManager(std::string                     path,
+                                 ChainManager&                   chain,
+                                 std::shared_ptr<MempoolManager> mempool,
+                                 std::shared_ptr<BlockStore>     blocks)
+  : SnapshotManager(std::move(path), chain, std::move(mempool),
+                    std::move(blocks), Options{}) {}
+
+SnapshotManager::SnapshotManager(std::string                     path,
+                                 ChainManager&                   chain,
+                                 std::shared_ptr<MempoolManager> mempool,
+                                 std::shared_ptr<BlockStore>     blocks,
+                                 Options                         opts)
+  : path_(std::move(path))
+  , chain_(chain)
+  , mempool_(std::move(mempool))
+  , blocks_(std::move(blocks))
+  , opts_(opts)
+{
+  opts_.chunk_items = std::max<size_t>(1, opts_.chunk_items);
+}
+
+SnapshotManager::~SnapshotManager() {
+  stop();
+}
+
+void SnapshotManager::start() {
+  if (opts_.interval.count() <= 0 || thr_.joinable()) return;
+  thr_ = std::thread(&SnapshotManager::loop, this);
+}
+
+void SnapshotManager::stop() {
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  if (thr_.joinable()) thr_.join();
+}
+
+void SnapshotManager::loop() {
+  std::unique_lock<std::mutex> lk(mu_);
+  while (!stopping_) {
+    cv_.wait_for(lk, opts_.interval, [&]{ return stopping_; });
+    if (stopping_) break;
+    lk.unlock();
+    int64_t head = chain_.getLastID();
+    bool moved;
+    {
+      std::lock_guard<std::mutex> wl(write_mu_);
+      moved = head != written_id_;
+    }
+    if (moved) WriteNow();
+    lk.lock();
+  }
+}
+
+bool SnapshotManager::WriteNow() {
+  std::lock_guard<std::mutex> wl(write_mu_);
+
+  // Mempool first, then the chain: an audit committed in between shows up
+  // in both, so drop the ones found in blocks from the old head onwards
+  // (the old head too, as its audits may not have been pruned yet).
+  int64_t before = chain_.getLastID();
+  auto audits = mempool_->LoadAll();
+  int64_t head = chain_.getLastID();
+
+  std::unordered_set<std::string> committed;
+  for (int64_t id = std::max<int64_t>(0, before); id <= head; ++id) {
+    blockchain::Block blk;
+    std::string err;
+    if (!blocks_->Get(id, &blk, &err)) continue;
+    for (auto& a : blk.audits()) committed.insert(a.req_id());
+  }
+
+  // Serialize as chunks: headers first, then audits
+  std::string out;
+  blockchain::SnapshotChunk chunk;
+  auto flush = [&] {
+    chunk.set_last_block_id(head);
+    AppendDelimited(chunk.SerializeAsString(), &out);
+    chunk.Clear();
+  };
+  size_t headers = 0;
+  for (int64_t from = 0; from <= head;
+       from += static_cast<int64_t>(opts_.chunk_items)) {
+    auto metas = chain_.getRange(
+      from, std::min(head, from + static_cast<int64_t>(opts_.chunk_items) - 1));
+    for (auto& m : metas) {
+      auto* h = chunk.add_headers();
+      h->set_id(m.id);
+      h->set_hash(m.hash);
+      h->set_previous_hash(m.previous_hash);
+      h->set_merkle_root(m.merkle_root);
+    }
+    headers += metas.size();
+    flush();
+  }
+  size_t kept = 0;
+  for (auto& a : audits) {
+    if (committed.count(a.req_id())) continue;
+    *chunk.add_audits() = std::move(a);
+    ++kept;
+    if (static_cast<size_t>(chunk.headers_size() + chunk.audits_size()) >=
+        opts_.chunk_items) {
+      flush();
+    }
+  }
+  if (chunk.headers_size() || chunk.audits_size() || out.empty()) flush();
+
+  const std::string tmp = path_ + ".tmp";
+  {
+    std::ofstream f(tmp, std::ios::trunc | std::ios::binary);
+    f.write(out.data(), static_cast<std::streamsize>(out.size()));
+    if (!f) {
+      LOG_ERROR("Snapshot") << "cannot write " << tmp;
+      std::remove(tmp.c_str());
+      return false;
+    }
+  }
+  // written_id_ stays put on failure, so the next tick retries
+  if (!ReplaceFile(tmp, path_)) {
+    LOG_ERROR("Snapshot") << "cannot commit " << path_;
+    return false;
+  }
+  written_id_ = head;
+  LOG_INFO("Snapshot")
+    << "wrote " << path_ << ": " << headers
+    << " headers, " << kept << " pending audits (" << out.size()
+    << " bytes)";
+  return true;
+}
+
+bool SnapshotManager::ForEachChunk(
+    const std::function<bool(const blockchain::SnapshotChunk&)>& emit) const
+{
+  // A rename swaps in the next snapshot; this stream keeps the old inode
+  std::ifstream in(path_, std::ios::binary);
+  if (!in) return false;
+
+  std::string bytes;
+  blockchain::SnapshotChunk chunk;
+  bool any = false;
+  while (ReadDelimited(in, &bytes)) {
+    if (!chunk.ParseFromString(bytes)) return false;
+    any = true;
+    if (!emit(chunk)) break;
+  }
+  return any;
+}
+
+bool SnapshotManager::Bootstrap(blockchain::BlockChainService::Stub* stub,
+                                ChainManager& chain, MempoolManager& mempool,
+                                std::string* err)
+{
+  grpc::ClientContext ctx;
+  ctx.set_deadline(std::chrono::system_clock::now() + kBootstrapTimeout);
+  blockchain::GetSnapshotRequest req;
+  auto reader = stub->GetSnapshot(&ctx, req);
+
+  // 1) Download, checking that headers run 0, 1, ... and link up
+  std::vector<BlockMeta> metas;
+  std::vector<common::FileAudit> audits;
+  int64_t head = -2;
+  blockchain::SnapshotChunk chunk;
+  bool linked = true;
+  while (linked && reader->Read(&chunk)) {
+    if (head == -2) head = chunk.last_block_id();
+    for (auto& h : chunk.headers()) {
+      if (h.id() != static_cast<int64_t>(metas.size()) ||
+          (!metas.empty() && h.previous_hash() != metas.back().hash)) {
+        linked = false;
+        break;
+      }
+      metas.push_back({h.id(), h.hash(), h.previous_hash(), h.merkle_root()});
+    }
+    for (auto& a : *chunk.mutable_audits()) audits.push_back(std::move(a));
+  }
+  if (!linked) {
+    ctx.TryCancel();
+    reader->Finish();
+    *err = "header " + std::to_string(metas.size()) + " breaks the chain";
+    return false;
+  }
+  auto status = reader->Finish();
+  if (!status.ok()) {
+    *err = status.error_message();
+    return false;
+  }
+  if (head == -2) {
+    *err = "empty snapshot";
+    return false;
+  }
+  if (static_cast<int64_t>(metas.size()) != head + 1) {
+    *err = "snapshot ends at block " +
+           std::to_string(static_cast<int64_t>(metas.size()) - 1) +
+           ", expected " + std::to_string(head);
+    return false;
+  }
+  if (metas.empty() && audits.empty()) {
+    *err = "peer has nothing to bootstrap from";
+    return false;
+  }
+
+  // 2) Verify the pending audits, sorting out bad ones on a failure
+  std::vector<std::string> payloads;
+  std::vector<VerificationPool::Item> items;
+  payloads.reserve(audits.size());
+  for (auto& a : audits) payloads.push_back(CanonicalPayload(a));
+  for (size_t i = 0; i < audits.size(); ++i) {
+    items.push_back({&payloads[i], &audits[i].signature(),
+                     &audits[i].public_key()});
+  }
+  bool all_valid = VerificationPool::Shared().VerifyAll(items) < 0;
+
+  // 3) Install
+  if (chain.getLastID() >= 0) {
+    *err = "local chain is not empty";
+    return false;
+  }
+  chain.appendBatch(metas);
+  size_t added = 0, invalid = 0;
+  for (size_t i = 0; i < audits.size(); ++i) {
+    auto& a = audits[i];
+    if (!all_valid &&
+        !VerifySignature(payloads[i], a.signature(), a.public_key())) {
+      ++invalid;
+      continue;
+    }
+    if (mempool.Append(a, SHA256Hex(payloads[i]))) ++added;
+  }
+  std::string dropped = invalid ? " (" + std::to_string(invalid) +
+                                   " with bad signatures dropped)" : "";
+  LOG_INFO("Snapshot") << "bootstrapped to block " << head << " with "
+                       << added << " pending audits" << dropped;
+  return true;
+}
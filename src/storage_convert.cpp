@@ -0,0 +1,127 @@
+// src/storage_convert.cpp
+//
+// One-shot storage maintenance tool.
+//
+//   storage_convert mempool <mempool.dat> <json|binary>
+//       Rewrite the mempool log in the given format.
+//   storage_convert import  <blocks dir>
+//       Move legacy block_<id>.{json,pb} files into the segment store.
+//   storage_convert export  <blocks dir> <id>
+//       Print one stored block as JSON (debugging/export).
+//
+// Conversion is in place. Run it while the node is stopped. If the data
+// directory (the parent of the given path) has a keys.dat, interned keys
+// are resolved and new records intern theirs, as in the node.
+
+#include "block_store.h"
+#include "key_registry.h"
+#include "mempool_manager.h"
+#include "storage_format.h"
+#include <google/protobuf/util/json_util.h>
+#include <charconv>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static int Usage() {
+  std::cerr << "usage: storage_convert mempool <mempool.dat> <json|binary>\n"
+            << "       storage_convert import  <blocks dir>\n"
+            << "       storage_convert export  <blocks dir> <id>\n";
+  return 2;
+}
+
+// Parse all of `s` as a block id; false for anything else
+static bool ParseId(const std::string& s, int64_t* id) {
+  auto res = std::from_chars(s.data(), s.data() + s.size(), *id);
+  return res.ec == std::errc() && res.ptr == s.data() + s.size();
+}
+
+// The node's KeyRegistry next to `path`, if it has one
+static std::shared_ptr<KeyRegistry> Keys(const std::string& path) {
+  auto p = fs::absolute(path);
+  if (!p.has_filename()) p = p.parent_path();   // "blocks/"
+  auto file = p.parent_path() / "keys.dat";
+  if (!fs::exists(file)) return nullptr;
+  return std::make_shared<KeyRegistry>(file.string());
+}
+
+// Append every legacy block file under `dir` to the store, then delete it.
+static int ImportBlocks(const std::string& dir) {
+  BlockStore store(dir, BlockStore::Options{}, Keys(dir));
+  std::vector<fs::path> imported;
+  size_t failed = 0;
+  for (auto& entry : fs::directory_iterator(dir)) {
+    auto name = entry.path().filename().string();
+    auto ext  = entry.path().extension().string();
+    if (name.rfind("block_", 0) != 0) continue;
+    if (ext != ".json" && ext != ".pb") continue;
+
+    int64_t id;
+    if (!ParseId(name.substr(6, name.size() - 6 - ext.size()), &id)) {
+      std::cerr << "[convert] skipping " << name << "\n";
+      continue;
+    }
+    blockchain::Block blk;
+    std::string err;
+    bool ok = ReadBlockFile(dir, id, &blk, &err);
+    if (ok && !store.Put(blk)) {
+      err = "could not append to the block store";
+      ok  = false;
+    }
+    if (!ok) {
+      std::cerr << "[convert] block " << id << " failed: " << err << "\n";
+      ++failed;
+      continue;
+    }
+    imported.push_back(entry.path());
+  }
+  store.Sync();
+  for (auto& p : imported) fs::remove(p);
+  std::cout << "[convert] " << imported.size() << " block files imported, "
+            << failed << " failed\n";
+  return failed ? 1 : 0;
+}
+
+static int ExportBlock(const std::string& dir, int64_t id) {
+  BlockStore store(dir, BlockStore::Options{}, Keys(dir));
+  blockchain::Block blk;
+  std::string err, json;
+  if (!store.Get(id, &blk, &err)) {
+    std::cerr << "[convert] block " << id << ": " << err << "\n";
+    return 1;
+  }
+  google::protobuf::util::JsonPrintOptions opts;
+  opts.add_whitespace = true;
+  google::protobuf::util::MessageToJsonString(blk, &json, opts);
+  std::cout << json << "\n";
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) return Usage();
+  std::string kind = argv[1], path = argv[2];
+
+  if (kind == "mempool" && argc == 4) {
+    StorageFormat format;
+    try {
+      format = ParseStorageFormat(argv[3]);
+    } catch (const std::exception& e) {
+      std::cerr << e.what() << "\n";
+      return Usage();
+    }
+    // Replay detects the on-disk format and rewrites it in `format`
+    MempoolManager mempool(path, format, Keys(path));
+    std::cout << "[convert] " << mempool.Size() << " pending audits in "
+              << path << " (" << StorageFormatName(format) << ")\n";
+    return 0;
+  }
+  if (kind == "import" && argc == 3) return ImportBlocks(path);
+  int64_t id;
+  if (kind == "export" && argc == 4 && ParseId(argv[3], &id)) {
+    return ExportBlock(path, id);
+  }
+  return Usage();
+}
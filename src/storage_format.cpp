@@ -0,0 +1,122 @@
+#include "storage_format.h"
+#include "merkle_tree.h"                    // DeterministicSerialize
+#include <google/protobuf/util/json_util.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+using google::protobuf::util::MessageToJsonString;
+using google::protobuf::util::JsonStringToMessage;
+
+StorageFormat ParseStorageFormat(const std::string& name) {
+  if (name == "json")   return StorageFormat::kJson;
+  if (name == "binary") return StorageFormat::kBinary;
+  throw std::runtime_error("unknown storage format: " + name);
+}
+
+const char* StorageFormatName(StorageFormat format) {
+  return format == StorageFormat::kBinary ? "binary" : "json";
+}
+
+void AppendDelimited(const std::string& bytes, std::string* out) {
+  uint32_t n = static_cast<uint32_t>(bytes.size());
+  while (n >= 0x80) {
+    out->push_back(static_cast<char>((n & 0x7f) | 0x80));
+    n >>= 7;
+  }
+  out->push_back(static_cast<char>(n));
+  out->append(bytes);
+}
+
+bool ReadDelimited(std::istream& in, std::string* bytes) {
+  uint32_t n = 0;
+  for (int shift = 0; ; shift += 7) {
+    int c = in.get();
+    if (c == EOF || shift > 28) return false;
+    n |= static_cast<uint32_t>(c & 0x7f) << shift;
+    if (!(c & 0x80)) break;
+  }
+  bytes->resize(n);
+  if (n == 0) return true;
+  in.read(&(*bytes)[0], n);
+  return static_cast<uint32_t>(in.gcount()) == n;
+}
+
+static bool SyncPath(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  bool ok = ::fsync(fd) == 0;
+  ::close(fd);
+  return ok;
+}
+
+bool ReplaceFile(const std::string& tmp, const std::string& path) {
+  if (!SyncPath(tmp) || std::rename(tmp.c_str(), path.c_str()) != 0) {
+    std::remove(tmp.c_str());
+    return false;
+  }
+  auto slash = path.find_last_of('/');
+  return SyncPath(slash == std::string::npos ? "." : path.substr(0, slash + 1));
+}
+
+static std::string BlockPath(const std::string& dir, int64_t id,
+                             StorageFormat format) {
+  return dir + "/block_" + std::to_string(id) +
+         (format == StorageFormat::kBinary ? ".pb" : ".json");
+}
+
+bool WriteBlockFile(const std::string& dir,
+                    const blockchain::Block& blk,
+                    StorageFormat format) {
+  fs::create_directories(dir);
+  std::string data;
+  if (format == StorageFormat::kBinary) {
+    AppendDelimited(DeterministicSerialize(blk), &data);
+  } else if (!MessageToJsonString(blk, &data).ok()) {
+    return false;
+  }
+  std::ofstream out(BlockPath(dir, blk.id(), format),
+                    std::ios::trunc | std::ios::binary);
+  if (!out) return false;
+  out << data;
+  return static_cast<bool>(out);
+}
+
+bool ReadBlockFile(const std::string& dir,
+                   int64_t id,
+                   blockchain::Block* blk,
+                   std::string* err) {
+  // Binary first: it is the default, and cheaper to reject when absent
+  {
+    std::ifstream in(BlockPath(dir, id, StorageFormat::kBinary),
+                     std::ios::binary);
+    if (in) {
+      std::string bytes;
+      if (!ReadDelimited(in, &bytes) || !blk->ParseFromString(bytes)) {
+        *err = "corrupt block file";
+        return false;
+      }
+      return true;
+    }
+  }
+
+  std::ifstream in(BlockPath(dir, id, StorageFormat::kJson));
+  if (!in) {
+    *err = "could not open block file";
+    return false;
+  }
+  std::stringstream buf;
+  buf << in.rdbuf();
+  auto st = JsonStringToMessage(buf.str(), blk);
+  if (!st.ok()) {
+    *err = "JSON parse error: " + st.ToString();
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,144 @@
+// src/verification_pool.cpp
+
+#include "verification_pool.h"
+#include "signature_verifier.h"   // VerifySignature
+#include <openssl/sha.h>
+#include <algorithm>
+
+// -- VerificationPool -------------------------------------------------------
+
+VerificationPool::VerificationPool(size_t threads) {
+  for (size_t i = 0; i < threads; ++i) {
+    workers_.emplace_back(&VerificationPool::workerLoop, this);
+  }
+}
+
+VerificationPool::~VerificationPool() {
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  for (auto& t : workers_) t.join();
+}
+
+VerificationPool& VerificationPool::Shared() {
+  static VerificationPool pool(
+    std::max(1u, std::thread::hardware_concurrency()));
+  return pool;
+}
+
+// Claim items until none are left; after a failure, claimed items are
+// only counted, not verified.
+void VerificationPool::work(Job& job) {
+  for (size_t i; (i = job.next.fetch_add(1)) < job.size; ) {
+    if (job.failed.load(std::memory_order_relaxed) < 0) {
+      const Item& it = (*job.items)[i];
+      if (!VerifySignature(*it.payload, *it.signature, *it.public_key,
+                           it.key_id ? *it.key_id : std::string())) {
+        long none = -1;
+        job.failed.compare_exchange_strong(none, static_cast<long>(i));
+      }
+    }
+    if (job.done.fetch_add(1) + 1 == job.size) {
+      std::lock_guard<std::mutex> lk(job.mu);
+      job.cv.notify_all();
+    }
+  }
+}
+
+long VerificationPool::VerifyAll(const std::vector<Item>& items) {
+  if (items.empty()) return -1;
+
+  auto job = std::make_shared<Job>();
+  job->items = &items;
+  job->size  = items.size();
+  if (items.size() > 1 && !workers_.empty()) {
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      jobs_.push_back(job);
+    }
+    cv_.notify_all();
+  }
+
+  // The caller works too, then waits for items claimed by the workers
+  work(*job);
+  std::unique_lock<std::mutex> lk(job->mu);
+  job->cv.wait(lk, [&]{ return job->done.load() == items.size(); });
+  return job->failed.load();
+}
+
+void VerificationPool::workerLoop() {
+  std::unique_lock<std::mutex> lk(mu_);
+  while (true) {
+    cv_.wait(lk, [&]{ return stopping_ || !jobs_.empty(); });
+    if (stopping_) return;
+
+    auto job = jobs_.front();
+    if (job->next.load() >= job->size) {
+      jobs_.pop_front();   // fully claimed
+      continue;
+    }
+    lk.unlock();
+    work(*job);
+    lk.lock();
+  }
+}
+
+// -- VerifiedAuditSet -------------------------------------------------------
+
+std::string VerifiedAuditSet::Digest(
+    const std::string& payload, const common::FileAudit& audit)
+{
+  // NUL never occurs in canonical JSON, Base64 or PEM
+  std::string buf;
+  buf.reserve(payload.size() + audit.signature().size() +
+              audit.public_key().size() + 2);
+  buf.append(payload).append(1, '\0')
+     .append(audit.signature()).append(1, '\0')
+     .append(audit.public_key());
+  std::string digest(SHA256_DIGEST_LENGTH, '\0');
+  SHA256(reinterpret_cast<const unsigned char*>(buf.data()), buf.size(),
+         reinterpret_cast<unsigned char*>(&digest[0]));
+  return digest;
+}
+
+bool VerifiedAuditSet::Contains(
+    const std::string& req_id, const std::string& digest) const
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  auto it = digests_.find(req_id);
+  return it != digests_.end() && it->second.digest == digest;
+}
+
+void VerifiedAuditSet::Add(const std::string& req_id, std::string digest) {
+  std::lock_guard<std::mutex> lk(mu_);
+  auto it = digests_.find(req_id);
+  if (it != digests_.end()) {
+    // Already present: take the new digest and count it as the newest
+    it->second.digest = std::move(digest);
+    order_.splice(order_.end(), order_, it->second.pos);
+    return;
+  }
+  order_.push_back(req_id);
+  digests_.emplace(req_id, Entry{std::move(digest), std::prev(order_.end())});
+  while (order_.size() > capacity_) {
+    digests_.erase(order_.front());
+    order_.pop_front();
+  }
+}
+
+void VerifiedAuditSet::Remove(const std::vector<std::string>& req_ids) {
+  std::lock_guard<std::mutex> lk(mu_);
+  for (auto& id : req_ids) {
+    auto it = digests_.find(id);
+    if (it == digests_.end()) continue;
+    order_.erase(it->second.pos);
+    digests_.erase(it);
+  }
+}
+
+size_t VerifiedAuditSet::Size() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  return digests_.size();
+}
@@ -0,0 +1,134 @@
+// test_admission_control.cpp
+
+#include "admission_control.h"
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+using namespace std::chrono;
+using Reason = AdmissionControl::Reason;
+
+static common::FileAudit Audit(int i, const std::string& key = "",
+                               const std::string& user = "u") {
+  common::FileAudit a;
+  a.set_req_id("req" + std::to_string(i));
+  a.set_public_key(key);
+  a.mutable_user_info()->set_user_id(user);
+  return a;
+}
+
+static std::string TempLog(const char* name) {
+  std::string path = "/tmp/test_admission_" + std::to_string(::getpid()) +
+                     "_" + name;
+  std::remove(path.c_str());
+  return path;
+}
+
+int main() {
+  // 1) Token bucket: burst up front, then `rate` per second
+  {
+    auto t = steady_clock::now();
+    TokenBucket b(10, 3, t);
+    milliseconds wait{0};
+    assert(b.Take(t, &wait) && b.Take(t, &wait) && b.Take(t, &wait));
+    assert(!b.Take(t, &wait));
+    assert(wait == milliseconds(100));
+    assert(b.Used(t) > 0.99);
+    assert(b.Take(t + milliseconds(100), &wait));
+    assert(b.Used(t + seconds(10)) == 0);   // never holds more than burst
+    std::cout << "[Test] token bucket OK\n";
+  }
+
+  // 2) Clients are refused at client_share of max_mempool, gossip at the max
+  {
+    std::string log = TempLog("depth");
+    auto pool = std::make_shared<MempoolManager>(log);
+    AdmissionControl::Options o;
+    o.max_mempool  = 10;
+    o.client_share = 0.5;
+    o.full_retry   = milliseconds(700);
+    AdmissionControl ac(o, pool);
+    for (int i = 0; i < 5; ++i) {
+      assert(ac.AdmitClient().ok());
+      pool->Append(Audit(i));
+    }
+    assert(ac.Pressure() == 100);
+    auto d = ac.AdmitClient();
+    assert(d.reason == Reason::kMempoolFull);
+    assert(d.retry_after == milliseconds(700) && d.message() == "mempool full");
+    assert(ac.AdmitGossip(5).ok());
+    assert(!ac.AdmitGossip(6).ok());
+    std::remove(log.c_str());
+    std::cout << "[Test] mempool depth limits OK\n";
+  }
+
+  // 3) Node-wide ingest rate
+  {
+    std::string log = TempLog("rate");
+    auto pool = std::make_shared<MempoolManager>(log);
+    AdmissionControl::Options o;
+    o.max_mempool     = 0;
+    o.max_ingest_rate = 4;
+    AdmissionControl ac(o, pool);
+    int admitted = 0;
+    for (int i = 0; i < 10; ++i) admitted += ac.AdmitClient().ok();
+    assert(admitted == 4);
+    auto d = ac.AdmitClient();
+    assert(d.reason == Reason::kIngestRate);
+    assert(d.retry_after > milliseconds(0) && d.retry_after <= milliseconds(250));
+    assert(ac.Pressure() >= 95);    // refills a little meanwhile
+    assert(ac.AdmitGossip(1000000).ok());   // no depth limit
+    std::remove(log.c_str());
+    std::cout << "[Test] ingest rate OK\n";
+  }
+
+  // 4) Per-client buckets: by public_key, else by user_id
+  {
+    std::string log = TempLog("client");
+    auto pool = std::make_shared<MempoolManager>(log);
+    AdmissionControl::Options o;
+    o.client_rate  = 1;
+    o.client_burst = 2;
+    AdmissionControl ac(o, pool);
+    assert(ac.AdmitFrom(Audit(1, "keyA")).ok());
+    assert(ac.AdmitFrom(Audit(2, "keyA", "other")).ok());
+    auto d = ac.AdmitFrom(Audit(3, "keyA"));
+    assert(d.reason == Reason::kClientRate && d.redirect.empty());
+    assert(ac.AdmitFrom(Audit(4, "keyB")).ok());        // another key
+    assert(ac.AdmitFrom(Audit(5, "", "alice")).ok());
+    assert(ac.AdmitFrom(Audit(6, "", "alice")).ok());
+    assert(!ac.AdmitFrom(Audit(7, "", "alice")).ok());
+    assert(ac.AdmitFrom(Audit(8, "", "bob")).ok());
+    assert(ac.AdmitClient().ok());   // no node-wide limits set
+    std::remove(log.c_str());
+    std::cout << "[Test] per-client rate OK\n";
+  }
+
+  // 5) Refusals point at the least loaded alive peer, if clearly less loaded
+  {
+    std::string log = TempLog("redirect");
+    auto pool  = std::make_shared<MempoolManager>(log);
+    auto table = std::make_shared<HeartbeatTable>(seconds(60));
+    table->update("self:1", "", 0, 4, 100);
+    table->update("busy:1", "", 0, 4, 90);
+    table->update("idle:1", "", 0, 0, 10);
+    table->update("calm:1", "", 0, 1, 30);
+    AdmissionControl::Options o;
+    o.max_mempool  = 4;
+    o.client_share = 1.0;
+    AdmissionControl ac(o, pool, table, "self:1");
+    assert(ac.LessLoadedPeer().empty());   // we are idle ourselves
+    for (int i = 0; i < 4; ++i) pool->Append(Audit(i));
+    auto d = ac.AdmitClient();
+    assert(!d.ok() && d.redirect == "idle:1");
+    table->update("idle:1", "", 0, 4, 95);
+    assert(ac.AdmitClient().redirect == "calm:1");
+    std::remove(log.c_str());
+    std::cout << "[Test] redirect OK\n";
+  }
+
+  std::cout << "🎉 All AdmissionControl tests passed\n";
+  return 0;
+}
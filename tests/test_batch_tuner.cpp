@@ -0,0 +1,104 @@
+// test_batch_tuner.cpp
+
+#include "batch_tuner.h"
+#include <cassert>
+#include <cmath>
+#include <iostream>
+
+using namespace std::chrono;
+
+// Feed `secs` of steady ingest at `rate` audits/s, sampled every 10 ms
+static void Ingest(BatchTuner& t, double rate, double secs,
+                   BatchTuner::Clock::time_point* now, uint64_t* total) {
+  t.ObserveIngest(*total, *now);
+  for (int i = 0; i < secs * 100; ++i) {
+    *now   += milliseconds(10);
+    *total += static_cast<uint64_t>(rate / 100);
+    t.ObserveIngest(*total, *now);
+  }
+}
+
+// Rounds that cost `fixed_ms` plus `per_audit_us` per audit
+static void Rounds(BatchTuner& t, double fixed_ms, double per_audit_us) {
+  for (size_t n = 100; n <= 1000; n += 100) {
+    t.ObserveRound(n, microseconds(static_cast<int64_t>(
+      fixed_ms * 1000 + per_audit_us * n)));
+  }
+}
+
+int main() {
+  // 1) The round cost is fitted from the window
+  {
+    BatchTuner t({});
+    Rounds(t, 4, 30);
+    assert(std::abs(t.FixedCost() - 0.004) < 1e-4);
+    assert(std::abs(t.PerAuditCost() - 30e-6) < 1e-6);
+    std::cout << "[Test] round cost fit OK\n";
+  }
+
+  // 2) Ingest rate follows the appended counter
+  {
+    BatchTuner t({});
+    auto now = BatchTuner::Clock::now();
+    uint64_t total = 0;
+    Ingest(t, 5000, 5, &now, &total);
+    assert(std::abs(t.IngestRate() - 5000) < 100);
+    Ingest(t, 500, 5, &now, &total);
+    assert(std::abs(t.IngestRate() - 500) < 50);
+    std::cout << "[Test] ingest rate OK\n";
+  }
+
+  // 3) Light load: small blocks, cut early enough to meet the target
+  {
+    BatchTuner::Options o;
+    o.target_latency = milliseconds(250);
+    BatchTuner t(o);
+    Rounds(t, 4, 30);
+    auto now = BatchTuner::Clock::now();
+    uint64_t total = 0;
+    Ingest(t, 20, 5, &now, &total);
+    auto p = t.Current();
+    assert(p.batch >= 1 && p.batch <= 10);
+    assert(p.interval <= milliseconds(250) && p.interval >= milliseconds(100));
+    std::cout << "[Test] light load OK\n";
+  }
+
+  // 4) Heavy load: blocks big enough to keep up, rounds under the deadline
+  {
+    BatchTuner::Options o;
+    o.round_deadline = milliseconds(150);
+    BatchTuner t(o);
+    Rounds(t, 4, 30);
+    auto now = BatchTuner::Clock::now();
+    uint64_t total = 0;
+    Ingest(t, 20000, 5, &now, &total);
+    auto p = t.Current();
+    double round = 0.004 + 30e-6 * p.batch;
+    assert(p.batch / round >= 20000);                // keeps up
+    assert(round <= 0.150 + 1e-3);                   // under the deadline
+    assert(p.interval <= milliseconds(250));
+    std::cout << "[Test] heavy load OK\n";
+  }
+
+  // 5) Peers too slow to keep up: the deadline wins, bounds hold
+  {
+    BatchTuner::Options o;
+    o.min_batch      = 5;
+    o.max_batch      = 80;
+    o.min_interval   = milliseconds(20);
+    o.round_deadline = milliseconds(150);
+    BatchTuner t(o);
+    Rounds(t, 10, 1000);   // 1 ms per audit
+    auto now = BatchTuner::Clock::now();
+    uint64_t total = 0;
+    Ingest(t, 50000, 3, &now, &total);
+    auto p = t.Current();
+    assert(p.batch >= 5 && p.batch <= 80);
+    assert(0.010 + 0.001 * p.batch <= 0.150 + 1e-3);
+    assert(p.interval >= milliseconds(20));
+    std::cout << "[Test] bounds OK\n";
+  }
+
+  std::cout << "🎉 All BatchTuner tests passed\n";
+  return 0;
+}
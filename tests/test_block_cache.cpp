@@ -0,0 +1,67 @@
+// test_block_cache.cpp
+
+#include "block_cache.h"
+#include "block_chain.grpc.pb.h"
+#include <cassert>
+#include <iostream>
+#include <string>
+
+static BlockCache::Bytes Blob(size_t n) {
+  return std::make_shared<const std::string>(n, 'x');
+}
+
+int main() {
+  // 1) Encoded reply parses back to the block
+  {
+    blockchain::Block blk;
+    blk.set_id(7);
+    blk.set_hash("h7");
+    blk.add_audits()->set_req_id("r1");
+    auto bytes = BlockCache::Encode(blk);
+    blockchain::GetBlockResponse resp;
+    assert(resp.ParseFromString(*bytes));
+    assert(resp.status() == "success");
+    assert(resp.block().id() == 7 && resp.block().audits(0).req_id() == "r1");
+    std::cout << "[Test] Encode OK\n";
+  }
+
+  // 2) Hits, misses and size-bounded LRU eviction
+  {
+    BlockCache cache(300);
+    assert(!cache.Get(1));
+    cache.Put(1, Blob(100));
+    cache.Put(2, Blob(100));
+    cache.Put(3, Blob(100));
+    assert(cache.Get(1));          // 1 is now most recently used
+    cache.Put(4, Blob(100));       // evicts 2
+    assert(!cache.Get(2));
+    assert(cache.Get(3) && cache.Get(4) && cache.Get(1));
+
+    auto st = cache.GetStats();
+    assert(st.entries == 3 && st.bytes == 300);
+    assert(st.hits == 4 && st.misses == 2 && st.evictions == 1);
+    assert(st.HitRate() > 0.66 && st.HitRate() < 0.67);
+    std::cout << "[Test] LRU OK\n";
+
+    cache.Put(3, Blob(50));        // replace shrinks the total
+    assert(cache.GetStats().bytes == 250);
+    cache.Put(9, Blob(301));       // larger than the cache: not kept
+    assert(!cache.Get(9));
+    assert(cache.GetStats().entries == 3);
+    std::cout << "[Test] Replace and oversize OK\n";
+  }
+
+  // 3) An evicted entry stays valid for holders
+  {
+    BlockCache cache(100);
+    cache.Put(1, Blob(100));
+    auto held = cache.Get(1);
+    cache.Put(2, Blob(100));
+    assert(!cache.Get(1));
+    assert(held && held->size() == 100);
+    std::cout << "[Test] Shared entries OK\n";
+  }
+
+  std::cout << "🎉 All BlockCache tests passed\n";
+  return 0;
+}
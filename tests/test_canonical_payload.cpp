@@ -0,0 +1,141 @@
+// test_canonical_payload.cpp
+
+#include "canonical_payload.h"
+#include "merkle_tree.h"
+#include <nlohmann/json.hpp>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+using ordered_json = nlohmann::ordered_json;
+
+// The reference encoding: exactly what the servers used to build
+static std::string ReferenceDump(const common::FileAudit& a) {
+  ordered_json j;
+  j["access_type"] = a.access_type();
+  j["file_info"]   = {{"file_id",   a.file_info().file_id()},
+                      {"file_name", a.file_info().file_name()}};
+  j["req_id"]      = a.req_id();
+  j["timestamp"]   = a.timestamp();
+  j["user_info"]   = {{"user_id",   a.user_info().user_id()},
+                      {"user_name", a.user_info().user_name()}};
+  return j.dump();
+}
+
+static common::FileAudit MakeAudit(const std::string& s, int64_t ts,
+                                   common::AccessType type) {
+  common::FileAudit a;
+  a.set_req_id("req-" + s);
+  a.mutable_file_info()->set_file_id("file" + s);
+  a.mutable_file_info()->set_file_name(s);
+  a.mutable_user_info()->set_user_id(s + "uid");
+  a.mutable_user_info()->set_user_name(s);
+  a.set_access_type(type);
+  a.set_timestamp(ts);
+  a.set_signature("ignored");
+  a.set_public_key("ignored");
+  return a;
+}
+
+// Both encoders must refuse the same strings
+static bool ReferenceThrows(const common::FileAudit& a) {
+  try {
+    ReferenceDump(a);
+    return false;
+  } catch (const nlohmann::json::type_error&) {
+    return true;
+  }
+}
+
+static bool Throws(const common::FileAudit& a) {
+  try {
+    CanonicalPayload(a);
+    return false;
+  } catch (const std::invalid_argument&) {
+    return true;
+  }
+}
+
+static void Check(const common::FileAudit& a) {
+  std::string expected = ReferenceDump(a);
+  std::string got = CanonicalPayload(a);
+  if (got != expected) {
+    std::cerr << "expected: " << expected << "\n"
+              << "got:      " << got << "\n";
+  }
+  assert(got == expected);
+  assert(CanonicalLeafHash(a) == SHA256Hex(expected));
+}
+
+int main() {
+  // 1) Plain values, every access type, edge timestamps
+  const int64_t timestamps[] = {0, 1, -1, 1700000000000LL,
+                                std::numeric_limits<int64_t>::max(),
+                                std::numeric_limits<int64_t>::min()};
+  for (int64_t ts : timestamps) {
+    for (int t = common::UNKNOWN; t <= common::DELETE; ++t) {
+      Check(MakeAudit("important.docx", ts,
+                      static_cast<common::AccessType>(t)));
+    }
+  }
+  Check(common::FileAudit{});   // all fields empty
+  std::cout << "[Test] Plain values OK\n";
+
+  // 2) Characters that need escaping
+  const char* tricky[] = {
+    "quote\"inside", "back\\slash", "slash/stays", "tab\there",
+    "new\nline", "cr\rlf", "\b\f", "del\x7f",
+    "caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x93\x81",   // valid UTF-8 passes through
+  };
+  for (const char* s : tricky) Check(MakeAudit(s, 42, common::WRITE));
+  for (int c = 0; c < 0x20; ++c) {
+    Check(MakeAudit(std::string("ctl") + static_cast<char>(c) + "end", 7,
+                    common::READ));
+  }
+  std::cout << "[Test] Escaping OK\n";
+
+  // 3) Random printable ASCII + control characters
+  std::mt19937 rng(12345);
+  for (int i = 0; i < 2000; ++i) {
+    std::string s(rng() % 40, ' ');
+    for (auto& ch : s) ch = static_cast<char>(rng() % 0x80);
+    Check(MakeAudit(s, static_cast<int64_t>(rng()) - (1LL << 31),
+                    static_cast<common::AccessType>(rng() % 5)));
+  }
+  std::cout << "[Test] Random strings OK\n";
+
+  // 4) Invalid UTF-8 is refused, as dump() refuses it
+  const char* invalid[] = {
+    "\x80", "lone\xc3", "\xc0\xaf", "\xe0\x80\xaf", "\xed\xa0\x80",
+    "\xf4\x90\x80\x80", "\xf5\x80\x80\x80", "\xff", "caf\xc3\x28",
+  };
+  for (const char* s : invalid) {
+    auto bad = MakeAudit(s, 1, common::READ);
+    assert(ReferenceThrows(bad) && Throws(bad));
+  }
+  for (int i = 0; i < 5000; ++i) {
+    std::string s(rng() % 12, ' ');
+    for (auto& ch : s) {
+      ch = static_cast<char>(rng() % 2 ? 0x80 + rng() % 0x80 : rng() % 0x80);
+    }
+    auto a = MakeAudit(s, 1, common::READ);
+    bool ref = ReferenceThrows(a);
+    assert(Throws(a) == ref);
+    if (!ref) Check(a);
+  }
+  std::cout << "[Test] Invalid UTF-8 OK\n";
+
+  // 5) Appending reuses the caller's buffer
+  std::string buf = "prefix";
+  auto a = MakeAudit("x", 1, common::READ);
+  AppendCanonicalPayload(a, &buf);
+  assert(buf == "prefix" + ReferenceDump(a));
+  std::cout << "[Test] Append OK\n";
+
+  std::cout << "🎉 All canonical payload tests passed\n";
+  return 0;
+}
@@ -3,42 +3,107 @@
 #include "chain_manager.h"
 #include <cassert>
 #include <iostream>
+#include <string>
 #include <cstdio>    // for std::remove()
 
+static void CleanUp(const char* path) {
+  std::remove(path);
+  std::remove((std::string(path) + ".log").c_str());
+  std::remove((std::string(path) + ".tmp").c_str());
+}
+
 int main() {
   const char* testpath = "test_chain.json";
 
   // Ensure clean slate
-  std::remove(testpath);
-
-  // 1) Empty start
-  ChainManager cm(testpath);
-  assert(cm.getLastID() == 0);
-  assert(cm.getLastHash().empty());
-  assert(cm.getLastMerkleRoot().empty());
-  assert(cm.getAll().empty());
-  std::cout << "[Test] Empty start OK\n";
-
-  // 2) Append one block
-  BlockMeta m1{1, "h1", "", "mr1"};
-  cm.append(m1);
-  assert(cm.getLastID() == 1);
-  assert(cm.getLastHash() == "h1");
-  assert(cm.getLastMerkleRoot() == "mr1");
-  auto all = cm.getAll();
-  assert(all.size() == 1);
-  assert(all[0].previous_hash.empty());
-  std::cout << "[Test] Append one block OK\n";
-
-  // 3) Append a second block
-  BlockMeta m2{2, "h2", "h1", "mr2"};
-  cm.append(m2);
-  assert(cm.getLastID() == 2);
-  assert(cm.getLastHash() == "h2");
-  all = cm.getAll();
-  assert(all.size() == 2);
-  assert(all[1].previous_hash == "h1");
-  std::cout << "[Test] Append second block OK\n";
+  CleanUp(testpath);
+
+  {
+    // 1) Empty start
+    ChainManager cm(testpath);
+    assert(!cm.getHead());
+    assert(cm.getLastID() == -1);
+    assert(cm.getLastHash().empty());
+    assert(cm.getLastMerkleRoot().empty());
+    assert(cm.getAll().empty());
+    std::cout << "[Test] Empty start OK\n";
+
+    // 2) Append one block
+    BlockMeta m1{1, "h1", "", "mr1"};
+    cm.append(m1);
+    assert(cm.getLastID() == 1);
+    assert(cm.getLastHash() == "h1");
+    assert(cm.getLastMerkleRoot() == "mr1");
+    auto all = cm.getAll();
+    assert(all.size() == 1);
+    assert(all[0].previous_hash.empty());
+    std::cout << "[Test] Append one block OK\n";
+
+    // 3) Append a second block
+    BlockMeta m2{2, "h2", "h1", "mr2"};
+    cm.append(m2);
+    assert(cm.getLastID() == 2);
+    assert(cm.getLastHash() == "h2");
+    all = cm.getAll();
+    assert(all.size() == 2);
+    assert(all[1].previous_hash == "h1");
+    std::cout << "[Test] Append second block OK\n";
+
+    // 4) Append a batch
+    cm.appendBatch({BlockMeta{3, "h3", "h2", "mr3"},
+                    BlockMeta{4, "h4", "h3", "mr4"}});
+    cm.appendBatch({});
+    assert(cm.getLastID() == 4);
+    assert(cm.getLastHash() == "h4");
+    assert(cm.getAll().size() == 4);
+    std::cout << "[Test] Append batch OK\n";
+
+    // 5) Head snapshot and ranges
+    auto head = cm.getHead();
+    assert(head && head->id == 4 && head->merkle_root == "mr4");
+    cm.append(BlockMeta{5, "h5", "h4", "mr5"});
+    assert(head->id == 4);               // old snapshot is unchanged
+    assert(cm.getHead()->id == 5);
+    auto range = cm.getRange(2, 3);
+    assert(range.size() == 2 && range[0].id == 2 && range[1].hash == "h3");
+    assert(cm.getRange(5, 100).size() == 1);
+    assert(cm.getRange(6, 9).empty());
+    std::cout << "[Test] Head and range OK\n";
+  }
+
+  // 6) Reload from checkpoint + log tail
+  {
+    ChainManager cm(testpath);
+    assert(cm.getLastID() == 5);
+    assert(cm.getHead()->hash == "h5");
+    auto all = cm.getAll();
+    assert(all.size() == 5);
+    assert(all[0].hash == "h1" && all[1].merkle_root == "mr2");
+    assert(all[3].previous_hash == "h3");
+    std::cout << "[Test] Reload OK\n";
+  }
+  CleanUp(testpath);
+
+  // 7) Enough blocks for a checkpoint, plus a log tail, survive a reload
+  //    (appending and reloading 1M blocks is BM_ChainReload in bench/)
+  {
+    const int64_t kBlocks = 10000;
+    const std::string h(64, 'a');
+    {
+      ChainManager cm(testpath);
+      for (int64_t id = 0; id < kBlocks; ++id) {
+        cm.append(BlockMeta{id, h, h, h});
+      }
+      assert(cm.getLastID() == kBlocks - 1);
+    }
+    ChainManager cm(testpath);
+    assert(cm.getLastID() == kBlocks - 1);
+    auto all = cm.getAll();
+    assert(all.size() == static_cast<size_t>(kBlocks));
+    assert(all.front().id == 0 && all.back().id == kBlocks - 1);
+    std::cout << "[Test] Checkpoint reload OK\n";
+  }
+  CleanUp(testpath);
 
   std::cout << "🎉 All ChainManager tests passed\n";
   return 0;
@@ -0,0 +1,87 @@
+// test_election_state.cpp
+
+#include "election_state.h"
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+int main() {
+  // 1) Setters publish, isLeader() follows the leader field
+  {
+    ElectionState st("a:1");
+    assert(st.getTerm() == 0 && st.getLeader().empty() && !st.isLeader());
+    st.setTerm(3);
+    st.setVotedFor("b:1");
+    st.setLeader("a:1");
+    auto snap = st.snapshot();
+    assert(snap->term == 3 && snap->voted_for == "b:1" && snap->leader == "a:1");
+    assert(st.isLeader());
+    st.setLeader("b:1");
+    assert(!st.isLeader());
+    std::cout << "[Test] setters OK\n";
+  }
+
+  // 2) setLeaderIfUnknown only fills an empty leader
+  {
+    ElectionState st("a:1");
+    assert(!st.setLeaderIfUnknown(""));
+    assert(st.setLeaderIfUnknown("b:1"));
+    assert(!st.setLeaderIfUnknown("c:1"));
+    assert(st.getLeader() == "b:1");
+    std::cout << "[Test] setLeaderIfUnknown OK\n";
+  }
+
+  // 3) Listeners see term and leader changes, not votes or no-ops
+  {
+    ElectionState st("a:1");
+    std::vector<std::pair<std::string, std::string>> seen;
+    st.subscribe([&](const ElectionState::Snapshot& before,
+                     const ElectionState::Snapshot& after) {
+      seen.emplace_back(before.leader, after.leader);
+    });
+    st.setLeader("a:1");
+    st.setLeader("a:1");       // unchanged
+    st.setVotedFor("b:1");     // not a term/leader change
+    st.setTerm(1);
+    st.setLeader("b:1");
+    assert(seen.size() == 3);
+    assert(seen[0].first.empty() && seen[0].second == "a:1");
+    assert(seen[1].first == "a:1" && seen[1].second == "a:1");
+    assert(seen[2].first == "a:1" && seen[2].second == "b:1");
+    std::cout << "[Test] listeners OK\n";
+  }
+
+  // 4) Readers always see a consistent snapshot while writers race
+  {
+    ElectionState st("n0");
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> writers;
+    for (int w = 0; w < 4; ++w) {
+      writers.emplace_back([&, w] {
+        for (int i = 0; i < 2000; ++i) {
+          std::string who = "n" + std::to_string((w + i) % 3);
+          st.setLeader(who);
+          st.setVotedFor(who);
+        }
+      });
+    }
+    std::thread reader([&] {
+      while (!stop) {
+        auto snap = st.snapshot();
+        assert(snap->leader.empty() || snap->leader[0] == 'n');
+        (void)st.isLeader();
+      }
+    });
+    for (auto& t : writers) t.join();
+    stop = true;
+    reader.join();
+    assert(st.isLeader() == (st.getLeader() == "n0"));
+    std::cout << "[Test] concurrent access OK\n";
+  }
+
+  std::cout << "🎉 All ElectionState tests passed\n";
+  return 0;
+}
@@ -0,0 +1,152 @@
+// test_key_registry.cpp
+
+#include "block_store.h"
+#include "key_registry.h"
+#include "mempool_manager.h"
+#include "signature_verifier.h"
+#include <cassert>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+static std::string Pem(int i) {
+  return "-----BEGIN PUBLIC KEY-----\n" + std::string(400, 'A' + i % 26) +
+         "\n-----END PUBLIC KEY-----\n";
+}
+
+static common::FileAudit Audit(int i, int key) {
+  common::FileAudit a;
+  a.set_req_id("req-" + std::to_string(i));
+  a.mutable_file_info()->set_file_id("file" + std::to_string(i));
+  a.mutable_user_info()->set_user_id("user" + std::to_string(key));
+  a.set_access_type(common::READ);
+  a.set_timestamp(1700000000000 + i);
+  a.set_signature(std::string(344, 's'));
+  a.set_public_key(Pem(key));
+  return a;
+}
+
+int main() {
+  fs::path dir = "/tmp/test_key_registry_" + std::to_string(::getpid());
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  const std::string keys_path = (dir / "keys.dat").string();
+
+  // 1) Intern is idempotent, and ids survive a reload
+  std::string id0;
+  {
+    KeyRegistry keys(keys_path);
+    id0 = keys.Intern(Pem(0));
+    assert(id0 == KeyFingerprint(Pem(0)) && id0.size() == 64);
+    assert(keys.Intern(Pem(0)) == id0);
+    keys.Intern(Pem(1));
+    assert(keys.Size() == 2);
+  }
+  {
+    KeyRegistry keys(keys_path);
+    assert(keys.Size() == 2);
+    std::string pem;
+    assert(keys.Lookup(id0, &pem) && pem == Pem(0));
+    assert(!keys.Lookup(KeyFingerprint(Pem(9)), &pem));
+    std::cout << "[Test] intern and reload OK\n";
+  }
+
+  // 2) Strip and Resolve round-trip; unknown ids do not resolve
+  {
+    KeyRegistry keys(keys_path);
+    auto full = Audit(1, 3);
+    auto a = full;
+    assert(keys.Strip(&a) && a.public_key().empty() && NeedsKey(a));
+    assert(a.key_id() == KeyFingerprint(Pem(3)));
+    assert(keys.Resolve(&a) && a.public_key() == full.public_key());
+    assert(keys.Resolve(&full));                  // has its PEM already
+
+    common::FileAudit stranger = Audit(2, 4);
+    stranger.clear_public_key();
+    stranger.set_key_id(KeyFingerprint(Pem(4)));
+    assert(!keys.Resolve(&stranger) && stranger.public_key().empty());
+    std::cout << "[Test] strip and resolve OK\n";
+  }
+
+  // 3) A full registry leaves new keys inline
+  {
+    KeyRegistry keys((dir / "small.dat").string(), 1);
+    assert(!keys.Intern(Pem(5)).empty());
+    auto a = Audit(3, 6);
+    assert(!keys.Strip(&a) && a.public_key() == Pem(6) && !NeedsKey(a));
+    assert(keys.Size() == 1);
+    std::cout << "[Test] capacity OK\n";
+  }
+
+  // 4) A torn last record is cut off, and later keys still load
+  {
+    { std::ofstream(keys_path, std::ios::binary | std::ios::app) << "\x90\x03x"; }
+    {
+      KeyRegistry keys(keys_path);
+      assert(keys.Size() == 3);                   // 0, 1 and 3
+      keys.Intern(Pem(7));
+    }
+    KeyRegistry keys(keys_path);
+    std::string pem;
+    assert(keys.Size() == 4 && keys.Lookup(KeyFingerprint(Pem(7)), &pem));
+    std::cout << "[Test] torn tail OK\n";
+  }
+
+  auto keys = std::make_shared<KeyRegistry>(keys_path);
+
+  // 5) The mempool log names keys by id and replays complete audits
+  {
+    const std::string plain = (dir / "plain.dat").string();
+    const std::string interned = (dir / "mempool.dat").string();
+    {
+      MempoolManager a(plain);
+      MempoolManager b(interned, StorageFormat::kBinary, keys);
+      for (int i = 0; i < 100; ++i) {
+        a.Append(Audit(i, i % 3));
+        b.Append(Audit(i, i % 3));
+      }
+    }
+    auto small = fs::file_size(interned), big = fs::file_size(plain);
+    assert(small * 10 < big * 6);                  // the PEM was half of it
+
+    MempoolManager b(interned, StorageFormat::kBinary, keys);
+    auto all = b.LoadAll();
+    assert(all.size() == 100);
+    for (int i = 0; i < 100; ++i) {
+      assert(all[i].SerializeAsString() == Audit(i, i % 3).SerializeAsString());
+    }
+    std::cout << "[Test] mempool log OK (" << big << " -> " << small
+              << " bytes)\n";
+  }
+
+  // 6) Stored blocks name keys by id and Get() restores them
+  {
+    blockchain::Block blk;
+    blk.set_id(1);
+    blk.set_hash(std::string(64, 'h'));
+    for (int i = 0; i < 50; ++i) *blk.add_audits() = Audit(i, i % 2);
+    {
+      BlockStore store((dir / "blocks").string(), BlockStore::Options{}, keys);
+      assert(store.Put(blk));
+      std::string bytes;
+      assert(store.GetSerialized(1, &bytes));
+      assert(bytes.size() * 10 < blk.ByteSizeLong() * 6);
+    }
+    BlockStore store((dir / "blocks").string(), BlockStore::Options{}, keys);
+    blockchain::Block out;
+    std::string err;
+    assert(store.Get(1, &out, &err));
+    assert(out.SerializeAsString() == blk.SerializeAsString());
+    assert(blk.audits(0).key_id().empty());       // Put() did not touch it
+    std::cout << "[Test] block store OK\n";
+  }
+
+  fs::remove_all(dir);
+  std::cout << "🎉 All key registry tests passed\n";
+  return 0;
+}
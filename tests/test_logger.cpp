@@ -0,0 +1,121 @@
+// test_logger.cpp
+
+#include "logger.h"
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+int main() {
+  // 1) Lines arrive in order, with their tag and level
+  {
+    std::vector<std::pair<LogLevel, std::string>> seen;
+    Logger::Options opts;
+    opts.sink = [&](LogLevel level, const std::string& line) {
+      seen.emplace_back(level, line);
+    };
+    Logger log(opts);
+    LogLine(log, LogLevel::kInfo, "Test") << "one " << 1;
+    LogLine(log, LogLevel::kError, "Test") << "two";
+    LogLine(log, LogLevel::kWarn, "Test", 4) << "three";
+    log.Flush();
+    assert(seen.size() == 3);
+    assert(seen[0].first == LogLevel::kInfo && seen[0].second == "[Test] one 1");
+    assert(seen[1].first == LogLevel::kError && seen[1].second == "[Test] two");
+    assert(seen[2].second == "[Test] three (4 similar suppressed)");
+    std::cout << "[Test] ordering OK\n";
+  }
+
+  // 2) Concurrent writers lose nothing while the ring has room
+  {
+    std::atomic<size_t> lines{0};
+    Logger::Options opts;
+    opts.capacity = 1 << 16;
+    opts.sink = [&](LogLevel, const std::string&) { ++lines; };
+    Logger log(opts);
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t) {
+      writers.emplace_back([&, t]{
+        for (int i = 0; i < 5000; ++i) {
+          LogLine(log, LogLevel::kInfo, "W") << t << ":" << i;
+        }
+      });
+    }
+    for (auto& w : writers) w.join();
+    log.Flush();
+    assert(lines == 20000 && log.Dropped() == 0);
+    std::cout << "[Test] concurrent writers OK\n";
+  }
+
+  // 3) A full ring drops lines instead of blocking, and says so
+  {
+    std::mutex gate;
+    std::vector<std::string> seen;
+    Logger::Options opts;
+    opts.capacity = 8;
+    opts.sink = [&](LogLevel, const std::string& line) {
+      std::lock_guard<std::mutex> lk(gate);
+      seen.push_back(line);
+    };
+    Logger log(opts);
+    {
+      std::unique_lock<std::mutex> stall(gate);   // sink can't finish
+      LogLine(log, LogLevel::kInfo, "F") << "first";
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      auto t0 = std::chrono::steady_clock::now();
+      for (int i = 0; i < 100; ++i) LogLine(log, LogLevel::kInfo, "F") << i;
+      assert(std::chrono::steady_clock::now() - t0 < std::chrono::seconds(1));
+    }
+    log.Flush();
+    LogLine(log, LogLevel::kInfo, "F") << "after";
+    log.Flush();
+    assert(log.Dropped() > 0);
+    bool reported = false;
+    for (auto& l : seen) {
+      reported |= l.find("dropped, log buffer full") != std::string::npos;
+    }
+    assert(reported && seen.back() == "[F] after");
+    std::cout << "[Test] overflow OK\n";
+  }
+
+  // 4) Rate limiting lets one line per interval through
+  {
+    LogRateLimit limit(std::chrono::milliseconds(50));
+    uint64_t skipped = 99;
+    assert(limit.Allow(&skipped) && skipped == 0);
+    for (int i = 0; i < 5; ++i) assert(!limit.Allow(&skipped));
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    assert(limit.Allow(&skipped) && skipped == 5);
+
+    int evaluated = 0;
+    for (int i = 0; i < 5; ++i) {
+      LOG_WARN_EVERY_MS("Test", 60000) << "rate limited " << ++evaluated;
+    }
+    assert(evaluated == 1);
+    std::cout << "[Test] rate limiting OK\n";
+  }
+
+  // 5) Disabled levels don't evaluate their operands
+  {
+    int evaluated = 0;
+    LOG_DEBUG("Test") << ++evaluated;
+    if (kMinLogLevel > LogLevel::kDebug) assert(evaluated == 0);
+    Logger::Shared().SetLevel(LogLevel::kError);
+    LOG_WARN("Test") << ++evaluated;
+    LOG_INFO("Test") << ++evaluated;
+    Logger::Shared().SetLevel(LogLevel::kInfo);
+    assert(evaluated <= 1);
+    LogLevel level;
+    assert(ParseLogLevel("warn", &level) && level == LogLevel::kWarn);
+    assert(!ParseLogLevel("verbose", &level));
+    std::cout << "[Test] level filtering OK\n";
+  }
+
+  Logger::Shared().Flush();
+  std::cout << "🎉 All Logger tests passed\n";
+  return 0;
+}
@@ -0,0 +1,80 @@
+// test_merkle_tree.cpp
+
+#include "merkle_tree.h"
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// The original string-based algorithm the chain's roots are defined by
+static std::string LegacyRoot(std::vector<std::string> level) {
+  if (level.empty()) return "";
+  while (level.size() > 1) {
+    std::vector<std::string> next;
+    for (size_t i = 0; i < level.size(); i += 2) {
+      const std::string& left  = level[i];
+      const std::string& right = (i + 1 < level.size() ? level[i + 1] : left);
+      next.push_back(SHA256Hex(left + right));
+    }
+    level.swap(next);
+  }
+  return level[0];
+}
+
+static std::vector<std::string> Leaves(size_t n) {
+  std::vector<std::string> out;
+  for (size_t i = 0; i < n; ++i) out.push_back(SHA256Hex("audit" + std::to_string(i)));
+  return out;
+}
+
+int main() {
+  // 1) Compat roots match the hex-concatenation algorithm
+  assert(ComputeMerkleRoot({}).empty());
+  for (size_t n = 1; n <= 70; ++n) {
+    auto leaves = Leaves(n);
+    assert(ComputeMerkleRoot(leaves) == LegacyRoot(leaves));
+  }
+  // non-hash leaves still use the string algorithm
+  std::vector<std::string> odd = {"a", "b", "c"};
+  assert(ComputeMerkleRoot(odd) == LegacyRoot(odd));
+  std::cout << "[Test] Compat roots OK\n";
+
+  // 2) Every leaf's proof verifies, in both modes; tampering fails
+  for (auto mode : {MerkleTree::Mode::kHexCompat, MerkleTree::Mode::kBinary}) {
+    for (size_t n = 1; n <= 33; ++n) {
+      MerkleTree tree(std::vector<MerkleTree::Digest>{});
+      assert(MerkleTree::FromHex(Leaves(n), mode, &tree));
+      assert(tree.LeafCount() == n);
+      for (size_t i = 0; i < n; ++i) {
+        MerkleTree::Digest leaf;
+        assert(MerkleTree::ParseHex(Leaves(n)[i], &leaf));
+        auto proof = tree.GetProof(i);
+        assert(MerkleTree::VerifyProof(leaf, proof, tree.Root(), mode));
+
+        leaf[0] ^= 1;
+        assert(!MerkleTree::VerifyProof(leaf, proof, tree.Root(), mode));
+        leaf[0] ^= 1;
+        if (!proof.empty()) {
+          proof[0].sibling_is_left = !proof[0].sibling_is_left;
+          bool self_paired = proof[0].sibling == leaf;
+          assert(self_paired ||
+                 !MerkleTree::VerifyProof(leaf, proof, tree.Root(), mode));
+        }
+      }
+      assert(tree.GetProof(n).empty());
+    }
+  }
+  std::cout << "[Test] Proofs OK\n";
+
+  // 3) Binary mode is a different tree
+  MerkleTree hex(std::vector<MerkleTree::Digest>{}), bin(hex);
+  assert(MerkleTree::FromHex(Leaves(5), MerkleTree::Mode::kHexCompat, &hex));
+  assert(MerkleTree::FromHex(Leaves(5), MerkleTree::Mode::kBinary, &bin));
+  assert(hex.RootHex() == LegacyRoot(Leaves(5)));
+  assert(bin.RootHex() != hex.RootHex());
+  assert(!MerkleTree::FromHex({"XYZ"}, MerkleTree::Mode::kBinary, &bin));
+  std::cout << "[Test] Binary mode OK\n";
+
+  std::cout << "🎉 All MerkleTree tests passed\n";
+  return 0;
+}
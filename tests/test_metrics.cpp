@@ -0,0 +1,120 @@
+// test_metrics.cpp
+
+#include "metrics.h"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::chrono::microseconds;
+
+static bool Contains(const std::string& text, const std::string& line) {
+  return text.find(line + "\n") != std::string::npos;
+}
+
+int main() {
+  // 1) Bucket bounds are contiguous and at most 25% wide
+  {
+    uint64_t lower = 0;
+    for (size_t b = 0; b < LatencyHistogram::kBuckets; ++b) {
+      uint64_t upper = LatencyHistogram::UpperBoundUs(b);
+      assert(upper > lower);
+      if (lower >= 4) assert((upper - lower) * 4 <= lower);
+      lower = upper;
+    }
+    assert(lower == (uint64_t{1} << 32));
+    std::cout << "[Test] bucket bounds OK\n";
+  }
+
+  // 2) Samples land below their bucket's upper bound
+  {
+    for (uint64_t us : {0ull, 1ull, 3ull, 4ull, 5ull, 7ull, 8ull, 1000ull,
+                        123456ull, 1ull << 31}) {
+      LatencyHistogram h;
+      h.Record(microseconds(us));
+      size_t b = 0;
+      while (h.BucketCount(b) == 0) ++b;
+      assert(us < LatencyHistogram::UpperBoundUs(b));
+      assert(b == 0 || us >= LatencyHistogram::UpperBoundUs(b - 1));
+    }
+    LatencyHistogram h;
+    for (int i = 1; i <= 100; ++i) h.Record(microseconds(i * 10));
+    assert(h.Count() == 100 && h.SumUs() == 50500);
+    assert(h.PercentileUs(50) >= 500 && h.PercentileUs(50) <= 640);
+    assert(h.PercentileUs(100) > 1000);
+    h.Record(microseconds(-5));                // clamped to 0
+    assert(h.BucketCount(0) == 1);
+    std::cout << "[Test] bucketing OK\n";
+  }
+
+  // 3) Same name and labels give the same metric
+  {
+    MetricsRegistry reg;
+    auto& a = reg.GetCounter("c_total", "help", {{"k", "v"}});
+    auto& b = reg.GetCounter("c_total", "help", {{"k", "v"}});
+    auto& c = reg.GetCounter("c_total", "help", {{"k", "w"}});
+    assert(&a == &b && &a != &c);
+    assert(&reg.GetHistogram("h", "help") == &reg.GetHistogram("h", "help"));
+    std::cout << "[Test] lookup OK\n";
+  }
+
+  // 4) Text exposition format
+  {
+    MetricsRegistry reg;
+    reg.GetCounter("req_total", "Requests", {{"code", "OK"}}).Inc(3);
+    reg.GetGauge("depth", "Queue depth").Set(-2);
+    reg.SetGaugeFn("ratio", "Computed", []{ return 0.5; });
+    reg.GetCounter("esc_total", "Escaping", {{"v", "a\"b\\c"}}).Inc();
+    auto& h = reg.GetHistogram("lat_seconds", "Latency", {{"m", "X"}});
+    h.Record(microseconds(2));
+    h.Record(microseconds(10));
+    h.Record(microseconds(3000));
+
+    auto text = reg.Render();
+    assert(Contains(text, "# HELP req_total Requests"));
+    assert(Contains(text, "# TYPE req_total counter"));
+    assert(Contains(text, "req_total{code=\"OK\"} 3"));
+    assert(Contains(text, "# TYPE depth gauge"));
+    assert(Contains(text, "depth -2"));
+    assert(Contains(text, "ratio 0.5"));
+    assert(Contains(text, "esc_total{v=\"a\\\"b\\\\c\"} 1"));
+    assert(Contains(text, "# TYPE lat_seconds histogram"));
+    assert(Contains(text, "lat_seconds_bucket{m=\"X\",le=\"1e-06\"} 0"));
+    assert(Contains(text, "lat_seconds_bucket{m=\"X\",le=\"4e-06\"} 1"));
+    assert(Contains(text, "lat_seconds_bucket{m=\"X\",le=\"1.6e-05\"} 2"));
+    assert(Contains(text, "lat_seconds_bucket{m=\"X\",le=\"0.001024\"} 2"));
+    assert(Contains(text, "lat_seconds_bucket{m=\"X\",le=\"0.004096\"} 3"));
+    assert(Contains(text, "lat_seconds_bucket{m=\"X\",le=\"+Inf\"} 3"));
+    assert(Contains(text, "lat_seconds_sum{m=\"X\"} 0.003012"));
+    assert(Contains(text, "lat_seconds_count{m=\"X\"} 3"));
+    std::cout << "[Test] render OK\n";
+  }
+
+  // 5) Concurrent updates are not lost
+  {
+    MetricsRegistry reg;
+    auto& c = reg.GetCounter("n_total", "help");
+    auto& h = reg.GetHistogram("h_seconds", "help");
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&, t]{
+        for (int i = 0; i < 10000; ++i) {
+          c.Inc();
+          h.Record(microseconds(t * 100 + i % 50));
+        }
+      });
+    }
+    std::thread scraper([&]{
+      for (int i = 0; i < 20; ++i) (void)reg.Render();
+    });
+    for (auto& t : threads) t.join();
+    scraper.join();
+    assert(c.Value() == 40000 && h.Count() == 40000);
+    std::cout << "[Test] concurrent updates OK\n";
+  }
+
+  std::cout << "🎉 All metrics tests passed\n";
+  return 0;
+}
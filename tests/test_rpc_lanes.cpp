@@ -0,0 +1,190 @@
+// test_rpc_lanes.cpp
+
+#include "rpc_lanes.h"
+#include "block_chain.grpc.pb.h"
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+using blockchain::BlockChainService;
+
+// Heartbeats answer at once (or throw, from "throw"); gossip batches
+// block until released.
+class LaneService final
+  : public BlockChainService::WithAsyncMethod_SendHeartbeat<
+      BlockChainService::WithAsyncMethod_WhisperAuditBatch<
+        BlockChainService::Service>> {
+public:
+  grpc::Status SendHeartbeat(grpc::ServerContext*,
+                             const blockchain::HeartbeatRequest* req,
+                             blockchain::HeartbeatResponse* resp) override {
+    if (req->from_address() == "throw") throw std::runtime_error("boom");
+    resp->set_status("hello " + req->from_address());
+    return grpc::Status::OK;
+  }
+
+  grpc::Status WhisperAuditBatch(grpc::ServerContext*,
+                                 const blockchain::AuditBatch* req,
+                                 blockchain::WhisperBatchResponse* resp) override {
+    std::unique_lock<std::mutex> lk(mu);
+    ++busy;
+    cv.notify_all();
+    cv.wait(lk, [&]{ return released; });
+    resp->set_accepted(req->audits_size());
+    return grpc::Status::OK;
+  }
+
+  void waitBusy(int n) {
+    std::unique_lock<std::mutex> lk(mu);
+    cv.wait(lk, [&]{ return busy >= n; });
+  }
+  void release() {
+    std::lock_guard<std::mutex> lk(mu);
+    released = true;
+    cv.notify_all();
+  }
+
+  std::mutex              mu;
+  std::condition_variable cv;
+  int                     busy = 0;
+  bool                    released = false;
+};
+
+struct Harness {
+  LaneService                   svc;
+  std::unique_ptr<RpcLane>      control;
+  std::unique_ptr<RpcLane>      ingest;
+  std::unique_ptr<grpc::Server> server;
+  std::unique_ptr<BlockChainService::Stub> stub;
+
+  Harness() {
+    grpc::ServerBuilder builder;
+    int port = 0;
+    builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(),
+                             &port);
+    builder.RegisterService(&svc);
+    control = std::make_unique<RpcLane>(
+      builder, RpcLane::Options{"control", 1, 4});
+    ingest  = std::make_unique<RpcLane>(
+      builder, RpcLane::Options{"ingest", 1, 4});
+    control->serve(&svc, &LaneService::RequestSendHeartbeat,
+                   &LaneService::SendHeartbeat);
+    ingest->serve(&svc, &LaneService::RequestWhisperAuditBatch,
+                  &LaneService::WhisperAuditBatch);
+    server = builder.BuildAndStart();
+    assert(server && port > 0);
+    control->start();
+    ingest->start();
+    stub = BlockChainService::NewStub(grpc::CreateChannel(
+      "127.0.0.1:" + std::to_string(port), grpc::InsecureChannelCredentials()));
+  }
+
+  ~Harness() {
+    svc.release();
+    server->Shutdown(std::chrono::system_clock::now() +
+                     std::chrono::seconds(1));
+    ingest->stop();
+    control->stop();
+  }
+
+  grpc::Status heartbeat(const std::string& from,
+                         blockchain::HeartbeatResponse* resp) {
+    grpc::ClientContext ctx;
+    ctx.set_deadline(std::chrono::system_clock::now() +
+                     std::chrono::seconds(2));
+    blockchain::HeartbeatRequest req;
+    req.set_from_address(from);
+    return stub->SendHeartbeat(&ctx, req, resp);
+  }
+};
+
+int main() {
+  // 1) A lane runs the service's own handler for its method
+  {
+    Harness h;
+    for (int i = 0; i < 20; ++i) {
+      blockchain::HeartbeatResponse resp;
+      auto status = h.heartbeat("n" + std::to_string(i), &resp);
+      assert(status.ok());
+      assert(resp.status() == "hello n" + std::to_string(i));
+    }
+    std::cout << "[Test] unary calls on a lane OK\n";
+  }
+
+  // 2) A busy ingest lane does not hold up heartbeats on the control lane
+  {
+    Harness h;
+    std::atomic<int> accepted{0};
+    std::thread gossip([&] {
+      grpc::ClientContext ctx;
+      blockchain::AuditBatch batch;
+      batch.add_audits()->set_req_id("r1");
+      batch.add_audits()->set_req_id("r2");
+      blockchain::WhisperBatchResponse resp;
+      auto status = h.stub->WhisperAuditBatch(&ctx, batch, &resp);
+      accepted = status.ok() ? resp.accepted() : -1;
+    });
+    h.svc.waitBusy(1);   // the ingest lane's only thread is now stuck
+
+    auto t0 = std::chrono::steady_clock::now();
+    blockchain::HeartbeatResponse resp;
+    auto status = h.heartbeat("leader", &resp);
+    assert(status.ok());
+    assert(std::chrono::steady_clock::now() - t0 < std::chrono::seconds(1));
+    assert(accepted == 0);
+
+    h.svc.release();
+    gossip.join();
+    assert(accepted == 2);
+    std::cout << "[Test] lanes are isolated OK\n";
+  }
+
+  // 3) Shutdown while a handler is still running is clean
+  {
+    auto h = std::make_unique<Harness>();
+    std::thread gossip([&] {
+      grpc::ClientContext ctx;
+      blockchain::AuditBatch batch;
+      blockchain::WhisperBatchResponse resp;
+      h->stub->WhisperAuditBatch(&ctx, batch, &resp);   // may be cancelled
+    });
+    h->svc.waitBusy(1);
+    std::thread releaser([&] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(300));
+      h->svc.release();
+    });
+    h->server->Shutdown(std::chrono::system_clock::now() +
+                        std::chrono::milliseconds(100));
+    releaser.join();
+    gossip.join();
+    h.reset();
+    std::cout << "[Test] shutdown OK\n";
+  }
+
+  // 4) A handler that throws fails its call, and the lane keeps serving
+  {
+    Harness h;
+    blockchain::HeartbeatResponse resp;
+    auto status = h.heartbeat("throw", &resp);
+    assert(status.error_code() == grpc::StatusCode::UNKNOWN);
+    assert(h.heartbeat("after", &resp).ok() && resp.status() == "hello after");
+    std::cout << "[Test] throwing handler OK\n";
+  }
+
+  // 5) A lane whose server never started can still be stopped
+  {
+    grpc::ServerBuilder builder;
+    RpcLane lane(builder, RpcLane::Options{"unused", 2, 1});
+    lane.stop();
+    lane.stop();
+    std::cout << "[Test] stop without start OK\n";
+  }
+
+  std::cout << "🎉 All RpcLane tests passed\n";
+  return 0;
+}
@@ -0,0 +1,59 @@
+// test_verification_pool.cpp
+
+#include "verification_pool.h"
+#include <cassert>
+#include <iostream>
+#include <string>
+
+static std::string Id(int i) { return "req-" + std::to_string(i); }
+
+int main() {
+  // 1) Only the exact digest that was added counts as verified
+  {
+    VerifiedAuditSet set(8);
+    set.Add(Id(1), "d1");
+    assert(set.Contains(Id(1), "d1"));
+    assert(!set.Contains(Id(1), "other"));
+    assert(!set.Contains(Id(2), "d1"));
+    set.Add(Id(1), "d1b");                       // re-verified with new bytes
+    assert(set.Contains(Id(1), "d1b") && !set.Contains(Id(1), "d1"));
+    assert(set.Size() == 1);
+    std::cout << "[Test] digests OK\n";
+  }
+
+  // 2) Re-adding an id does not take a second slot or get it evicted early
+  {
+    VerifiedAuditSet set(3);
+    set.Add(Id(1), "d");
+    set.Add(Id(2), "d");
+    set.Add(Id(1), "d");                         // now the newest
+    set.Add(Id(3), "d");
+    assert(set.Size() == 3);
+    set.Add(Id(4), "d");                         // evicts req-2, the oldest
+    assert(set.Size() == 3);
+    assert(!set.Contains(Id(2), "d"));
+    assert(set.Contains(Id(1), "d") && set.Contains(Id(3), "d") &&
+           set.Contains(Id(4), "d"));
+    std::cout << "[Test] re-add OK\n";
+  }
+
+  // 3) Removed ids free their slots wherever they are in the order
+  {
+    VerifiedAuditSet set(3);
+    set.Add(Id(1), "d");
+    set.Add(Id(2), "d");
+    set.Add(Id(3), "d");
+    set.Remove({Id(2), Id(3), Id(9)});
+    assert(set.Size() == 1);
+    set.Add(Id(4), "d");
+    set.Add(Id(5), "d");                         // fits without evicting
+    assert(set.Size() == 3);
+    assert(set.Contains(Id(1), "d") && set.Contains(Id(5), "d"));
+    set.Add(Id(6), "d");
+    assert(!set.Contains(Id(1), "d") && set.Size() == 3);
+    std::cout << "[Test] remove OK\n";
+  }
+
+  std::cout << "🎉 All verification pool tests passed\n";
+  return 0;
+}